@@ -5,6 +5,9 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <stdbool.h>
+#include <string.h>
+#include <tgmath.h>
+#include <threads.h>
 #include "webgpu.h"
 #include "GLFW/glfw3.h"
 #include "glfw3webgpu/glfw3webgpu.h"
@@ -12,44 +15,155 @@
 #include "linear/algebra.h"
 #include "./adapter.h"
 #include "./device.h"
+#include "./trace.h"
+#include "./stats.h"
+#include "./memory.h"
+#include "./limits.h"
+#include "./watch.h"
+#include "./dirty.h"
+#include "./bundle.h"
+#include "./jobs.h"
 #include "./RenderPass.h"
-#include "./Depth.h"
+#include "./Framebuffer.h"
 #include "./Lightning.h"
+#include "./Profiler.h"
 #include "./RenderTarget/RenderTarget.h"
 #include "./RenderTarget/Fourareen.h"
 #include "./RenderTarget/Mammoth.h"
 #include "./Camera.h"
 #include "./gui.h"
 
-#define TARGET_COUNT (3)
+#define TARGET_COUNT     (3)
+#define FRAMES_IN_FLIGHT (3) // most frames submitted and not completed by the GPU
+#define PACING_SPIN      (2e-3) // seconds spun before a deadline, sleeps overshoot
 
 typedef struct {
     struct {
         Matrix4f projection;
         Matrix4f view;
         Matrix4f model;
+        Matrix4f normal; // the inverse transpose of model, for the normals
     } matrices;
     Vector4f color;
     Vector3f cameraPosition;
     float time;
 } Uniforms;
 typedef struct {
+    bool inspect;
+    const char* profile; // path of the GPU timing report, profiling is off when null
+    const char* trace; // path of the Chrome trace written on exit and on F2
+    const char* memory; // path of the GPU memory report written on exit
+    uint64_t budget; // GPU memory budget in bytes, zero means unlimited
+    const char* cache; // directory of the pipeline cache, no caching when null
+    uint64_t cacheLimit; // bytes kept in the pipeline cache
+    bool watch; // reload the shaders when their files change
+    size_t lights; // point lights scattered over the scene
+    size_t threads; // of the job system, zero uses every core
+    size_t encoders; // slices of the render bundles, zero takes the threads of the jobs
+    size_t frames; // in flight, one syncs with the GPU before every frame
+    WGPUPresentMode presentMode; // Fifo when the surface does not support it
+    double frameLimit; // frames per second the loop is held to, zero does not limit
+    bool lowLatency; // input is polled once the GPU is done with the last frame
+    size_t script; // frames of scripted camera drags before closing, zero for none
+    bool storm; // the scripted run also resizes the window several times a frame
+} Application_Options;
+// the state a frame is encoded from while the next one is updated
+typedef struct {
+    Uniforms uniforms;
+    Application_dirty dirty;
+    double input; // when the events it reflects were polled, in seconds
+} Application_Frame;
+typedef struct Application_Pacing Application_Pacing;
+typedef struct {
+    Application_Pacing* pacing;
+    double input;
+} Application_Fence;
+// the latencies are summed in milliseconds from the input to the present call and to
+// the completion of the frame on the GPU
+struct Application_Pacing {
+    Application_Fence fences[FRAMES_IN_FLIGHT];
+    size_t submitted;
+    size_t completed;
+    size_t presented;
+    double presentLatency;
+    double completionLatency;
+    double completionLatencyMax;
+    double begin; // first submission and last completion, in seconds
+    double end;
+    double deadline; // of the frame limiter, in seconds
+    // between the presents, in milliseconds
+    double lastPresent;
+    double intervals;
+    double intervalSquares;
+    double intervalMax;
+};
+typedef struct {
+    Application_Options options;
+    Application_cache* cache;
+    Application_watch* watch;
     GLFWwindow* window;
     WGPUInstance instance;
     WGPUSurface surface;
     WGPUSurfaceCapabilities capabilities;
+    WGPUPresentMode presentMode;
     WGPUDevice device;
     WGPUQueue queue;
-    Application_Depth depth;
+    Application_Framebuffer framebuffer;
+    uint32_t width; // the surface is configured for
+    uint32_t height;
+    bool minimized; // nothing is drawn
+    struct {
+        uint32_t width; // of the latest callback, applied once before the frame
+        uint32_t height;
+        bool pending;
+        size_t callbacks;
+        size_t applied;
+    } resize;
+    Application_bundle* bundle; // the draws of the targets
     RenderTarget* targets[TARGET_COUNT];
+    // advanced by the update, on a worker while the previous frame is encoded
     Uniforms uniforms;
-    WGPUBuffer uniformBuffer;
+    Application_dirty uniformsDirty;
     Camera camera;
+    struct {
+        Application_jobs_Counter done;
+        double input;
+    } update;
+    Application_Frame frame;
+    Application_Pacing pacing;
+    Application_jobs* jobs;
+    WGPUBuffer uniformBuffer;
     Application_Lighting lightning;
+    Application_Profiler profiler;
+    bool overlay;
+    struct {
+        double firstFrame; // milliseconds since GLFW was initialized
+        double loaded; // when the last pending pipeline completed
+    } startup;
     // Application_Compute compute;
 } Application;
 
-Application* Application_create(const size_t width, const size_t height, bool inspect);
+// the limits are derived from the scene assets, the surface and the depth texture
+static WGPUDevice device_request(
+  WGPUAdapter adapter,
+  Application_cache* cache,
+  size_t width,
+  size_t height,
+  size_t lights,
+  bool profile) {
+  WGPULimits requirements = Application_limits_make();
+  Application_Lightning_require(&requirements, lights);
+  Fourareen_require(&requirements, sizeof(Application_Lighting_Uniforms), sizeof(Uniforms));
+  Mammoth_require(&requirements, sizeof(Application_Lighting_Uniforms), sizeof(Uniforms));
+  LIMITS_REQUIRE(
+    requirements.maxTextureDimension2D,
+    (uint32_t)(width > height ? width : height));
+  return Application_device_request(adapter, &requirements, cache, profile);
+}
+Application* Application_create(
+  const size_t width,
+  const size_t height,
+  Application_Options options);
 bool Application_shouldClose(Application application[static 1]);
 void Application_render(Application application[static 1]);
 void Application_destroy(Application* application);
@@ -62,33 +176,31 @@ static void surface_attach(Application application[static 1], size_t width, size
     .format = application->capabilities.formats[0],
     .viewFormatCount = 0,
     .viewFormats = 0,
-    .usage = WGPUTextureUsage_RenderAttachment,
+    .usage = WGPUTextureUsage_RenderAttachment
+             | (application->framebuffer.copyable ? WGPUTextureUsage_CopyDst : 0),
     .device = application->device,
-    .presentMode = WGPUPresentMode_Fifo,
+    .presentMode = application->presentMode,
     .alphaMode = WGPUCompositeAlphaMode_Auto,
   };
   wgpuSurfaceConfigure(application->surface, &configuration);
 }
 static void uniform_attach(Application application[static 1], double width, double height) {
-  application->camera.position.components[0] = -2.0f;
-  application->camera.position.components[1] = -3.0f;
-  application->camera.zoom = -1.2;
+  application->camera = Application_Camera_make(Vector3f_make(-2.0f, -3.0f, 2.0f));
+  application->camera.moved = false;
+  const Matrix4f model = Matrix4f_diagonal(1.0);
   Uniforms uniforms = {
-    .matrices.model = Matrix4f_transpose(Matrix4f_diagonal(1.0)),
-    .matrices.view = Matrix4f_transpose(Matrix4f_lookAt(
-      Vector3f_make(-2.0f, -3.0f, 2.0f),
-      Vector3f_fill(0.0f),
-      Vector3f_make(0, 0, 1.0f))),
+    .matrices.model = Matrix4f_transpose(model),
+    .matrices.normal = Matrix4f_transpose(Matrix4f_normal(model)),
+    .matrices.view = Matrix4f_transpose(Application_Camera_viewGet(application->camera)),
     .matrices.projection =
       Matrix4f_transpose(Matrix4f_perspective(45, width / height, 0.01f, 100.0f)),
     .time = 0.0f,
-    .cameraPosition = Vector3f_make(
-      application->camera.position.components[0],
-      application->camera.position.components[1],
-      1.0f),
+    .cameraPosition = application->camera.position,
     .color = Vector4f_make(0.0f, 1.0f, 0.4f, 1.0f),
   };
   application->uniforms = uniforms;
+  application->uniformsDirty = (Application_dirty){ 0 };
+  Application_dirty_mark(&application->uniformsDirty, 0, sizeof(Uniforms));
   WGPUBufferDescriptor descriptor = {
     .nextInChain = 0,
     .label = "uniform buffer",
@@ -96,30 +208,192 @@ static void uniform_attach(Application application[static 1], double width, doub
     .mappedAtCreation = false,
     .size = sizeof(Uniforms),
   };
-  application->uniformBuffer = wgpuDeviceCreateBuffer(application->device, &descriptor);
+  application->uniformBuffer = Application_memory_Buffer_create(
+    application->device,
+    &descriptor,
+    Application_memory_Uniform);
 }
 static void uniform_detach(Application application[static 1]) {
-  wgpuBufferDestroy(application->uniformBuffer);
-  wgpuBufferRelease(application->uniformBuffer);
+  Application_memory_Buffer_destroy(application->uniformBuffer);
+}
+// however many events moved the camera since the last frame, the view is built once
+static void camera_update(Application application[static 1]) {
+  if (application->camera.moved) {
+    application->uniforms.matrices.view =
+      Matrix4f_transpose(Application_Camera_viewGet(application->camera));
+    application->uniforms.cameraPosition = application->camera.position;
+    DIRTY_MARK(&application->uniformsDirty, application->uniforms, matrices.view);
+    DIRTY_MARK(&application->uniformsDirty, application->uniforms, cameraPosition);
+    application->camera.moved = false;
+  }
+}
+// the simulation step, it only touches the state the main thread leaves alone between
+// the polls of the events
+static void frame_update(void* context) {
+  TRACE_SCOPE("update");
+  Application* application = context;
+  camera_update(application);
+  application->uniforms.time = (float)glfwGetTime();
+  DIRTY_MARK(&application->uniformsDirty, application->uniforms, time);
+}
+static void frame_take(Application application[static 1]) {
+  application->frame.uniforms = application->uniforms;
+  application->frame.dirty = application->uniformsDirty;
+  application->frame.input = application->update.input;
+  application->uniformsDirty = (Application_dirty){ 0 };
+}
+static void fence_onDone(WGPUQueueWorkDoneStatus /* status */, void* userdata) {
+  const Application_Fence* fence = userdata;
+  Application_Pacing* pacing = fence->pacing;
+  const double latency = 1000.0 * ((pacing->end = glfwGetTime()) - fence->input);
+  pacing->completionLatency += latency;
+  if (latency > pacing->completionLatencyMax) {
+    pacing->completionLatencyMax = latency;
+  }
+  pacing->completed++;
+}
+// the frames complete in order, so a count of them is enough
+static void fence_wait(Application application[static 1], size_t inFlight) {
+  Application_Pacing* pacing = &application->pacing;
+  while (pacing->submitted - pacing->completed > inFlight) {
+    wgpuDeviceTick(application->device);
+  }
+}
+static void fence_signal(Application application[static 1]) {
+  Application_Pacing* pacing = &application->pacing;
+  Application_Fence* fence = &pacing->fences[pacing->submitted++ % FRAMES_IN_FLIGHT];
+  *fence = (Application_Fence){ .pacing = pacing, .input = application->frame.input };
+  pacing->begin = pacing->begin ? pacing->begin : glfwGetTime();
+  wgpuQueueOnSubmittedWorkDone(application->queue, fence_onDone, fence);
+}
+// held to the limit by sleeping most of the wait and spinning the rest, a missed
+// deadline starts the schedule over instead of rushing the next frames
+static void frame_limit(Application application[static 1]) {
+  if (!application->options.frameLimit) {
+    return;
+  }
+  TRACE_SCOPE("frame limiter");
+  Application_Pacing* pacing = &application->pacing;
+  const double deadline = pacing->deadline + 1.0 / application->options.frameLimit;
+  const double remaining = deadline - glfwGetTime();
+  pacing->deadline = 0 < remaining ? deadline : glfwGetTime();
+  if (PACING_SPIN < remaining) {
+    const double sleep = remaining - PACING_SPIN;
+    const struct timespec duration = {
+      .tv_sec = (time_t)sleep,
+      .tv_nsec = (long)(1e9 * (sleep - floor(sleep))),
+    };
+    thrd_sleep(&duration, 0);
+  }
+  while (pacing->deadline > glfwGetTime()) {}
+}
+// a drag back and forth across the window, the same on every run
+static void script_input(Application application[static 1]) {
+  const size_t frame = application->pacing.presented;
+  const float x = 640.0f + 300.0f * (float)sin(0.02 * (double)frame);
+  const float y = 480.0f;
+  if (!frame) {
+    Camera* camera = &application->camera;
+    Application_Camera_activate(camera, GLFW_MOUSE_BUTTON_LEFT, GLFW_PRESS, x, y);
+  }
+  Application_Camera_move(&application->camera, x, y);
+  // the sizes vary by a few pixels, as a dragged window edge
+  for (size_t i = 0; application->options.storm && 4 > i; i++) {
+    const double phase = 0.3 * (double)frame + (double)i;
+    glfwSetWindowSize(
+      application->window,
+      1280 + (int)(40.0 * sin(phase)),
+      960 + (int)(30.0 * cos(phase)));
+  }
+}
+static const char* presentModeStringify(WGPUPresentMode mode) {
+  switch (mode) {
+    case WGPUPresentMode_Fifo:
+      return "fifo";
+    case WGPUPresentMode_FifoRelaxed:
+      return "fifo relaxed";
+    case WGPUPresentMode_Immediate:
+      return "immediate";
+    case WGPUPresentMode_Mailbox:
+      return "mailbox";
+    default:
+      return "unknown";
+  }
+}
+// Fifo is the only mode every surface supports
+static WGPUPresentMode presentMode_choose(
+  const WGPUSurfaceCapabilities capabilities[static 1],
+  WGPUPresentMode requested) {
+  for (size_t i = 0; capabilities->presentModeCount > i; i++) {
+    if (capabilities->presentModes[i] == requested) {
+      return requested;
+    }
+  }
+  printf(
+    "The %s present mode is not supported, %s is used.\n",
+    presentModeStringify(requested),
+    presentModeStringify(WGPUPresentMode_Fifo));
+  return WGPUPresentMode_Fifo;
+}
+// the point lights are binned for the camera of the frame and the size of the surface
+static void lightning_update(
+  Application application[static 1],
+  const Uniforms uniforms[static 1]) {
+  Application_Lightning_update(
+    &application->lightning,
+    application->queue,
+    Matrix4f_transpose(uniforms->matrices.view),
+    Matrix4f_transpose(uniforms->matrices.projection),
+    Vector2f_make(application->width, application->height));
+}
+// the shader and every file it includes, adding a file twice watches it once
+static void watch_target(
+  Application application[static 1],
+  RenderTarget target[static 1]) {
+  for (size_t i = 0; target->includes.count > i; i++) {
+    Application_watch_add(application->watch, target->includes.paths[i]);
+  }
 }
+// a window being dragged calls back many times a frame, only the size is recorded
 static void onResize(GLFWwindow* window, int width, int height) {
   Application* application = (Application*)glfwGetWindowUserPointer(window);
   if (application) {
-    wgpuSurfaceUnconfigure(application->surface);
-    surface_attach(application, width, height);
-    Application_Depth_detach(application->depth);
-    application->depth = Application_Depth_attach(application->device, width, height);
-    application->uniforms.matrices.projection = Matrix4f_transpose(
-      Matrix4f_perspective(45, ((float)width / (float)height), 0.01f, 100.0f));
+    application->resize.width = (uint32_t)width;
+    application->resize.height = (uint32_t)height;
+    application->resize.pending = true;
+    application->resize.callbacks++;
   }
 }
+// the latest size, before the frame is drawn, the attachments are only allocated again
+// when they do not hold it, a minimized window keeps its surface
+static void resize_apply(Application application[static 1]) {
+  if (!application->resize.pending) {
+    return;
+  }
+  application->resize.pending = false;
+  const uint32_t width = application->resize.width;
+  const uint32_t height = application->resize.height;
+  application->minimized = !width || !height;
+  const bool same = width == application->width && height == application->height;
+  if (application->minimized || same) {
+    return;
+  }
+  TRACE_SCOPE("resize");
+  application->resize.applied++;
+  application->width = width;
+  application->height = height;
+  wgpuSurfaceUnconfigure(application->surface);
+  surface_attach(application, width, height);
+  Application_Framebuffer* framebuffer = &application->framebuffer;
+  Application_Framebuffer_fit(framebuffer, application->device, width, height);
+  application->uniforms.matrices.projection = Matrix4f_transpose(
+    Matrix4f_perspective(45, ((float)width / (float)height), 0.01f, 100.0f));
+  DIRTY_MARK(&application->uniformsDirty, application->uniforms, matrices.projection);
+}
 static void onMouseMove(GLFWwindow* window, double x, double y) {
   Application* application = (Application*)glfwGetWindowUserPointer(window);
   if (application) {
     Application_Camera_move(&application->camera, (float)x, (float)y);
-    application->uniforms.matrices.view =
-      Matrix4f_transpose(Application_Camera_viewGet(application->camera));
-    application->uniforms.cameraPosition = application->camera.position;
   }
 }
 static void onMouseButton(GLFWwindow* window, int button, int action, int /* mods*/) {
@@ -139,15 +413,14 @@ static void onMouseScroll(GLFWwindow* window, double x, double y) {
   Application* application = (Application*)glfwGetWindowUserPointer(window);
   if (application) {
     Application_Camera_zoom(&application->camera, (float)x, (float)y);
-    application->uniforms.matrices.view =
-      Matrix4f_transpose(Application_Camera_viewGet(application->camera));
-    application->uniforms.cameraPosition = application->camera.position;
   }
 }
-static WGPUTextureView nextView(WGPUSurface surface) {
+static WGPUTextureView nextView(WGPUSurface surface, WGPUTexture texture[static 1]) {
+  TRACE_SCOPE("acquire surface texture");
   WGPUTextureView result = 0;
   WGPUSurfaceTexture surfaceTexture = { 0 };
   wgpuSurfaceGetCurrentTexture(surface, &surfaceTexture);
+  *texture = surfaceTexture.texture;
   if (surfaceTexture.status == WGPUSurfaceGetCurrentTextureStatus_Success) {
     WGPUTextureViewDescriptor viewDescriptor = {
       .nextInChain = 0,
@@ -164,6 +437,22 @@ static WGPUTextureView nextView(WGPUSurface surface) {
   }
   return result;
 }
+static void onKey(
+  GLFWwindow* window,
+  int key,
+  int /* scancode */,
+  int action,
+  int /* mods */) {
+  Application* application = (Application*)glfwGetWindowUserPointer(window);
+  if (application && key == GLFW_KEY_F1 && action == GLFW_PRESS) {
+    application->overlay = !application->overlay;
+  }
+  if (
+    application && application->options.trace && key == GLFW_KEY_F2
+    && action == GLFW_PRESS) {
+    TRACE_DUMP(application->options.trace);
+  }
+}
 static bool setWindowHints() {
   glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
   glfwWindowHint(GLFW_RESIZABLE, GLFW_TRUE);
@@ -175,8 +464,15 @@ static void attachCallbacks(Application application[static 1]) {
   glfwSetCursorPosCallback(application->window, onMouseMove);
   glfwSetMouseButtonCallback(application->window, onMouseButton);
   glfwSetScrollCallback(application->window, onMouseScroll);
+  glfwSetKeyCallback(application->window, onKey);
 }
-Application* Application_create(const size_t width, const size_t height, bool inspect) {
+Application* Application_create(
+  const size_t width,
+  const size_t height,
+  Application_Options options) {
+  TRACE_THREAD_NAME("main");
+  Application_memory_budgetSet(options.budget);
+  TRACE_SCOPE("Application_create");
   WGPUInstanceDescriptor descriptor = { .nextInChain = 0 };
   Application* result = calloc(1, sizeof(*result));
   if (!result) {
@@ -209,6 +505,8 @@ Application* Application_create(const size_t width, const size_t height, bool in
     result = 0;
   }
   else {
+    result->options = options;
+    result->overlay = true;
     attachCallbacks(result);
     WGPURequestAdapterOptions adapterOptions = {
       .nextInChain = 0,
@@ -216,103 +514,391 @@ Application* Application_create(const size_t width, const size_t height, bool in
       .powerPreference = WGPUPowerPreference_HighPerformance,
     };
     WGPUAdapter adapter = Application_adapter_request(result->instance, &adapterOptions);
-    result->device = Application_device_request(adapter);
-    if (inspect) {
-      Application_device_inspect(result->device);
-      Application_adapter_inspect(adapter);
+    if (options.cache) {
+      result->cache = Application_cache_create(options.cache, options.cacheLimit);
     }
-    wgpuSurfaceGetCapabilities(result->surface, adapter, &result->capabilities);
-    surface_attach(result, width, height);
-    wgpuAdapterRelease(adapter);
-    result->queue = wgpuDeviceGetQueue(result->device);
-    result->depth = Application_Depth_attach(result->device, width, height);
-    result->lightning = Application_Lightning_create(result->device);
-    uniform_attach(result, width, height);
-    for (size_t i = 0; TARGET_COUNT - 1 > i; i++) {
-      result->targets[i] = (RenderTarget*)Fourareen_Create(
+    result->device =
+      device_request(
+        adapter,
+        result->cache,
+        width,
+        height,
+        options.lights,
+        options.profile != 0);
+    if (!result->device) {
+      printf("Could not get a device satisfying the scene requirements.\n");
+      Application_cache_destroy(result->cache);
+      wgpuAdapterRelease(adapter);
+      wgpuSurfaceRelease(result->surface);
+      glfwDestroyWindow(result->window);
+      wgpuInstanceRelease(result->instance);
+      glfwTerminate();
+      free(result);
+      result = 0;
+    }
+    else {
+      if (options.inspect) {
+        Application_device_inspect(result->device);
+        Application_adapter_inspect(adapter);
+      }
+      wgpuSurfaceGetCapabilities(result->surface, adapter, &result->capabilities);
+      result->framebuffer.copyable =
+        result->capabilities.usages & WGPUTextureUsage_CopyDst;
+      result->width = width;
+      result->height = height;
+      result->presentMode =
+        presentMode_choose(&result->capabilities, options.presentMode);
+      surface_attach(result, width, height);
+      wgpuAdapterRelease(adapter);
+      result->queue = wgpuDeviceGetQueue(result->device);
+      result->profiler =
+        Application_Profiler_create(result->device, options.profile != 0);
+      result->framebuffer = Application_Framebuffer_attach(
+        result->device,
+        result->capabilities.formats[0],
+        result->framebuffer.copyable,
+        width,
+        height);
+      result->jobs = Application_jobs_create(options.threads);
+      result->bundle = Application_bundle_create(
+        result->device,
+        result->jobs,
+        options.encoders,
+        result->capabilities.formats[0],
+        result->framebuffer.depth.format);
+      result->lightning = Application_Lightning_create(
+        result->device,
+        result->queue,
+        options.lights,
+        result->jobs);
+      uniform_attach(result, width, height);
+      // the update of a pipelined frame is a poll behind
+      if (options.lowLatency && 1 < options.frames) {
+        printf(
+          "Low latency keeps a single frame in flight instead of %zu.\n",
+          options.frames);
+      }
+      const size_t frames = options.frames && !options.lowLatency ? options.frames : 1;
+      result->options.frames = frames > FRAMES_IN_FLIGHT ? FRAMES_IN_FLIGHT : frames;
+      result->update.input = glfwGetTime();
+      for (size_t i = 0; TARGET_COUNT - 1 > i; i++) {
+        result->targets[i] = (RenderTarget*)Fourareen_Create(
+          0,
+          result->device,
+          result->queue,
+          result->framebuffer.depth.format,
+          &result->lightning,
+          result->uniformBuffer,
+          sizeof(Uniforms),
+          Vector3f_make(i * 5, 0, 0));
+      }
+      result->targets[TARGET_COUNT - 1] = (RenderTarget*)Mammoth_Create(
         0,
         result->device,
         result->queue,
-        result->depth.format,
-        result->lightning.buffer,
-        sizeof(Application_Lighting_Uniforms),
+        result->framebuffer.depth.format,
+        &result->lightning,
         result->uniformBuffer,
         sizeof(Uniforms),
-        Vector3f_make(i * 5, 0, 0));
-    }
-    result->targets[TARGET_COUNT - 1] = (RenderTarget*)Mammoth_Create(
-      0,
-      result->device,
-      result->queue,
-      result->depth.format,
-      result->lightning.buffer,
-      sizeof(Application_Lighting_Uniforms),
-      result->uniformBuffer,
-      sizeof(Uniforms),
-      Vector3f_make(0, 3, 0));
-    if (!Application_gui_attach(result->window, result->device, result->depth.format)) {
-      printf("gui problem!!\n");
+        Vector3f_make(0, 3, 0));
+      const WGPUTextureFormat depthFormat = result->framebuffer.depth.format;
+      if (!Application_gui_attach(result->window, result->device, depthFormat)) {
+        printf("gui problem!!\n");
+      }
+      lightning_update(result, &result->uniforms);
+      if (options.watch && (result->watch = Application_watch_create())) {
+        for (size_t i = 0; TARGET_COUNT > i; i++) {
+          watch_target(result, result->targets[i]);
+        }
+      }
     }
-    Application_Lightning_update(&result->lightning, result->queue);
   }
   return result;
 }
 bool Application_shouldClose(Application application[static 1]) {
-  return glfwWindowShouldClose(application->window);
+  const size_t script = application->options.script;
+  return glfwWindowShouldClose(application->window)
+         || (script && application->pacing.presented >= script);
 }
 void Application_render(Application application[static 1]) {
+  TRACE_SCOPE("frame");
+  const double begin = glfwGetTime();
+  // the update of the last call must be done before the events change its state
+  const bool pipelined = 1 < application->options.frames;
+  if (pipelined) {
+    TRACE_BEGIN("update wait");
+    Application_jobs_wait(application->jobs, &application->update.done);
+    TRACE_END();
+  }
+  frame_limit(application);
+  if (application->options.lowLatency) {
+    TRACE_BEGIN("frame fence");
+    fence_wait(application, 0);
+    TRACE_END();
+  }
+  TRACE_BEGIN("poll events");
   glfwPollEvents();
-  Application_Lightning_update(&application->lightning, application->queue);
-  WGPUTextureView nextTexture = nextView(application->surface);
+  if (application->options.script) {
+    script_input(application);
+  }
+  TRACE_END();
+  resize_apply(application);
+  if (application->minimized) {
+    glfwWaitEventsTimeout(0.1);
+    return;
+  }
+  Application_Framebuffer_settle(
+    &application->framebuffer,
+    application->device,
+    application->width,
+    application->height);
+  const double input = glfwGetTime();
+  if (application->watch) {
+    const char* changed[TARGET_COUNT];
+    const size_t count = Application_watch_poll(application->watch, changed, TARGET_COUNT);
+    // a target is reloaded once for any of its files, an edited include reloads every
+    // shader that includes it
+    for (size_t j = 0; TARGET_COUNT > j; j++) {
+      RenderTarget* target = application->targets[j];
+      bool reload = false;
+      for (size_t i = 0; !reload && count > i; i++) {
+        reload = Application_preprocessor_Files_contains(&target->includes, changed[i]);
+      }
+      if (reload) {
+        RenderTarget_reload(target, application->device);
+        watch_target(application, target);
+      }
+    }
+  }
+  for (size_t i = 0; TARGET_COUNT > i; i++) {
+    RenderTarget_update(application->targets[i]);
+  }
+  // this frame is encoded from the last update while the next one is computed
+  if (pipelined) {
+    frame_take(application);
+    application->update.input = input;
+    Application_jobs_submit(
+      application->jobs,
+      frame_update,
+      application,
+      0,
+      &application->update.done);
+  }
+  else {
+    application->update.input = input;
+    frame_update(application);
+    frame_take(application);
+  }
+  // a single frame in flight is a full CPU/GPU sync, the last frame has completed
+  // before this one is encoded
+  TRACE_BEGIN("frame fence");
+  fence_wait(application, application->options.frames - 1);
+  TRACE_END();
+  lightning_update(application, &application->frame.uniforms);
+  // written even when the frame is not drawn, the ranges are not kept
+  TRACE_BEGIN("uniform writes");
+  Application_dirty_flush(
+    &application->frame.dirty,
+    application->queue,
+    application->uniformBuffer,
+    &application->frame.uniforms);
+  TRACE_END();
+  WGPUTexture surfaceTexture = 0;
+  WGPUTextureView nextTexture = nextView(application->surface, &surfaceTexture);
+  const bool submitted = nextTexture;
   if (!nextTexture) {
     perror("Cannot acquire next swap chain texture\n");
   }
   else {
-    application->uniforms.time = (float)glfwGetTime();
-    wgpuQueueWriteBuffer(
-      application->queue,
-      application->uniformBuffer,
-      0,
-      &application->uniforms,
-      sizeof(Uniforms));
+    TRACE_BEGIN("bundle encoding");
+    Application_bundle_Draw draws[TARGET_COUNT];
+    size_t drawCount = 0;
+    for (size_t i = 0; TARGET_COUNT > i; i++) {
+      drawCount += RenderTarget_draw(application->targets[i], &draws[drawCount]);
+    }
+    Application_bundle_encode(application->bundle, drawCount, draws);
+    TRACE_END();
+    TRACE_BEGIN("encoding");
     WGPUCommandEncoderDescriptor commandEncoderDesc = {
       .nextInChain = 0,
       .label = "Command Encoder",
     };
     WGPUCommandEncoder encoder =
       wgpuDeviceCreateCommandEncoder(application->device, &commandEncoderDesc);
-    WGPURenderPassEncoder renderPass =
-      Application_RenderPassEncoder_make(encoder, nextTexture, application->depth.view);
-    for (size_t i = 0; TARGET_COUNT > i; i++) {
-      RenderTarget_render(application->targets[i], renderPass);
-    }
-    Application_gui_render(renderPass, &application->lightning);
+    Application_Profiler_begin(&application->profiler);
+    Application_Framebuffer* framebuffer = &application->framebuffer;
+    WGPURenderPassEncoder renderPass = Application_RenderPassEncoder_make(
+      encoder,
+      framebuffer->offscreen ? framebuffer->colorView : nextTexture,
+      framebuffer->depth.view,
+      Application_Profiler_RenderPassTimestampWrites(&application->profiler, "main"));
+    // the attachments may be larger than the surface
+    wgpuRenderPassEncoderSetViewport(
+      renderPass,
+      0,
+      0,
+      (float)application->width,
+      (float)application->height,
+      0,
+      1);
+    wgpuRenderPassEncoderSetScissorRect(
+      renderPass,
+      0,
+      0,
+      application->width,
+      application->height);
+    Application_bundle_execute(application->bundle, renderPass);
+    TRACE_BEGIN("gui");
+    Application_gui_render(
+      renderPass,
+      &application->lightning,
+      &application->profiler,
+      &application->overlay);
+    TRACE_END();
     wgpuRenderPassEncoderEnd(renderPass);
+    wgpuRenderPassEncoderRelease(renderPass);
+    if (framebuffer->offscreen) {
+      const size_t copy =
+        Application_Profiler_CommandsBegin(&application->profiler, encoder, "copy");
+      Application_Framebuffer_copy(framebuffer, encoder, surfaceTexture);
+      Application_Profiler_CommandsEnd(&application->profiler, encoder, copy);
+    }
     wgpuTextureViewRelease(nextTexture);
+    Application_Profiler_resolve(&application->profiler, encoder);
     WGPUCommandBufferDescriptor cmdBufferDescriptor = {
       .nextInChain = 0,
       .label = "command buffer",
     };
     WGPUCommandBuffer command = wgpuCommandEncoderFinish(encoder, &cmdBufferDescriptor);
     wgpuCommandEncoderRelease(encoder);
+    TRACE_END();
+    TRACE_BEGIN("submit");
     wgpuQueueSubmit(application->queue, 1, &command);
     wgpuCommandBufferRelease(command);
+    fence_signal(application);
+    Application_Profiler_collect(&application->profiler);
+    TRACE_END();
   }
+  TRACE_BEGIN("present");
   wgpuSurfacePresent(application->surface);
+  Application_Pacing* pacing = &application->pacing;
+  const double presented = glfwGetTime();
+  // a frame without a surface texture showed nothing new
+  if (submitted) {
+    pacing->presentLatency += 1000.0 * (presented - application->frame.input);
+    if (pacing->presented++) {
+      const double interval = 1000.0 * (presented - pacing->lastPresent);
+      pacing->intervals += interval;
+      pacing->intervalSquares += interval * interval;
+      pacing->intervalMax =
+        interval > pacing->intervalMax ? interval : pacing->intervalMax;
+    }
+    pacing->lastPresent = presented;
+  }
+  TRACE_END();
+  Application_stats_frame(
+    (float)(1000.0 * (presented - begin)),
+    (float)Application_Profiler_total(&application->profiler));
+  TRACE_BEGIN("device tick");
   wgpuDeviceTick(application->device);
+  TRACE_END();
+  if (!application->startup.firstFrame) {
+    application->startup.firstFrame = 1000.0 * glfwGetTime();
+    printf("First frame after %.2f ms.\n", application->startup.firstFrame);
+  }
+  if (!application->startup.loaded && !Application_device_pendingPipelines()) {
+    application->startup.loaded = 1000.0 * glfwGetTime();
+    printf("Fully loaded after %.2f ms.\n", application->startup.loaded);
+    // a warm start only hits the cache, compare with a run on an empty directory
+    printf(
+      "Shader and pipeline creation took %.2f ms.\n",
+      Application_device_compileTime());
+    printf(
+      "%zu shader modules came from the permutation cache.\n",
+      Application_device_ShaderModule_hits());
+    if (application->cache) {
+      Application_cache_report(application->cache, stdout);
+    }
+  }
 }
 void Application_destroy(Application* application) {
+  // the update and the fences write into the application
+  Application_jobs_wait(application->jobs, &application->update.done);
+  fence_wait(application, 0);
+  const Application_Pacing* pacing = &application->pacing;
+  if (1 < pacing->completed && 1 < pacing->presented) {
+    const double count = (double)(pacing->presented - 1);
+    const double mean = pacing->intervals / count;
+    char limit[64] = "unlimited";
+    if (application->options.frameLimit) {
+      snprintf(limit, sizeof(limit), "limited to %.0f", application->options.frameLimit);
+    }
+    printf(
+      "%s, %zu frames in flight%s, %s: frame time %.2f ms, standard deviation %.2f "
+      "and %.2f at most.\n",
+      presentModeStringify(application->presentMode),
+      application->options.frames,
+      application->options.lowLatency ? " with low latency" : "",
+      limit,
+      mean,
+      sqrt(fmax(0.0, pacing->intervalSquares / count - mean * mean)),
+      pacing->intervalMax);
+    printf(
+      "%.1f frames per second, %.2f ms from input to present, "
+      "%.2f ms to completion and %.2f at most.\n",
+      (double)(pacing->completed - 1) / (pacing->end - pacing->begin),
+      pacing->presentLatency / (double)pacing->presented,
+      pacing->completionLatency / (double)pacing->completed,
+      pacing->completionLatencyMax);
+  }
+  printf(
+    "%zu resize callbacks were applied as %zu resizes, %zu attachment textures were "
+    "allocated and %zu frames copied to the surface.\n",
+    application->resize.callbacks,
+    application->resize.applied,
+    application->framebuffer.allocations,
+    application->framebuffer.copies);
+  if (application->options.profile) {
+    FILE* report = fopen(application->options.profile, "w");
+    if (!report) {
+      perror("Could not write the profiling report");
+    }
+    else {
+      Application_Profiler_report(&application->profiler, report);
+      fclose(report);
+    }
+  }
+  if (application->options.trace) {
+    TRACE_DUMP(application->options.trace);
+  }
+  Application_watch_destroy(application->watch);
+  Application_Profiler_destroy(&application->profiler);
   Application_Lightning_destroy(application->lightning);
   Application_gui_detach();
-  Application_Depth_detach(application->depth);
+  Application_Framebuffer_detach(&application->framebuffer);
+  Application_bundle_destroy(application->bundle);
   for (size_t i = 0; TARGET_COUNT > i; i++) {
     RenderTarget_destroy(application->targets[i]);
   }
   uniform_detach(application);
+  if (application->options.memory) {
+    FILE* report = fopen(application->options.memory, "w");
+    if (!report) {
+      perror("Could not write the memory report");
+    }
+    else {
+      Application_memory_report(report);
+      fclose(report);
+    }
+  }
+  Application_memory_leaks(stdout);
+  Application_jobs_destroy(application->jobs);
   wgpuSurfaceUnconfigure(application->surface);
   wgpuSurfaceRelease(application->surface);
   wgpuQueueRelease(application->queue);
+  Application_device_ShaderModule_clear();
   wgpuDeviceRelease(application->device);
+  Application_cache_destroy(application->cache);
   wgpuInstanceRelease(application->instance);
   wgpuSurfaceRelease(application->surface);
   glfwDestroyWindow(application->window);
@@ -7,13 +7,19 @@
 #include "GLFW/glfw3.h"
 #include "linear/algebra.h"
 
+// An orbit around the origin: the orientation takes the x axis to the direction of the
+// position and the z axis to the up of the view, the drags rotate it by small
+// quaternions instead of rebuilding it from angles.
 typedef struct {
     Vector3f position;
-    Vector2f angles;
-    float zoom;
+    Quaternionf orientation;
+    Vector2f cursor; // at the last event of the drag
+    float zoom; // the distance is exp(-zoom)
     bool dragging;
+    bool moved; // since the view matrix was last built, the events only set this
 } Camera;
 
+Camera Application_Camera_make(Vector3f position);
 Matrix4f Application_Camera_viewGet(Camera camera);
 void Application_Camera_move(Camera camera[static 1], float x, float y);
 void Application_Camera_activate(
@@ -24,21 +30,50 @@ void Application_Camera_activate(
   float y);
 void Application_Camera_zoom(Camera camera[static 1], float x, float y);
 
-Matrix4f Application_Camera_viewGet(Camera camera) {
-  return Matrix4f_lookAt(camera.position, Vector3f_make(0, 0, 1.0f), Vector3f_fill(1.0f));
-}
 const float sensitivity = 0.01f;
 const float scrollSensitivity = 0.1f;
+static void position_update(Camera camera[static 1]) {
+  camera->position = Vector_scale(
+    exp(-camera->zoom), Quaternionf_rotate(camera->orientation, Vector3f_make(1, 0, 0)));
+  camera->moved = true;
+}
+// looking at the origin from position with z up
+Camera Application_Camera_make(Vector3f position) {
+  const float distance = Vector_norm(position);
+  const float yaw = atan2(position.components[1], position.components[0]);
+  const float pitch = asin(position.components[2] / distance);
+  return (Camera){
+    .position = position,
+    .orientation = Quaternionf_multiply(
+      Quaternionf_fromAxisAngle(Vector3f_make(0, 0, 1), yaw),
+      Quaternionf_fromAxisAngle(Vector3f_make(0, 1, 0), -pitch)),
+    .zoom = -log(distance),
+    .moved = true,
+  };
+}
+// the inverse of the rigid frame whose z axis points from the origin to the camera, the
+// orientation with its axes cycled so that x y z become y z x
+Matrix4f Application_Camera_viewGet(Camera camera) {
+  const Quaternionf cycle = { .components = { 0.5f, 0.5f, 0.5f, 0.5f } };
+  const Quaternionf frame = Quaternionf_multiply(camera.orientation, cycle);
+  Matrix4f result = Quaternionf_toMatrix(Quaternionf_conjugate(frame));
+  result.elements[11] = -exp(-camera.zoom);
+  return result;
+}
+// horizontal drags turn about the world z axis, vertical ones about the camera's own
+// horizontal axis
 void Application_Camera_move(Camera camera[static 1], float x, float y) {
   if (camera->dragging) {
-    camera->angles.components[0] = sensitivity * (-x - camera->position.components[0]);
-    camera->angles.components[1] = sensitivity * (y - camera->position.components[1]);
-    float cx = cos(camera->angles.components[0]);
-    float sx = sin(camera->angles.components[0]);
-    float cy = cos(camera->angles.components[1]);
-    float sy = sin(camera->angles.components[1]);
-    camera->position =
-      Vector_scale(exp(-camera->zoom), Vector3f_make(cx * cy, sx * cy, sy));
+    const float dx = x - camera->cursor.components[0];
+    const float dy = y - camera->cursor.components[1];
+    camera->cursor = Vector2f_make(x, y);
+    const Quaternionf yaw =
+      Quaternionf_fromAxisAngle(Vector3f_make(0, 0, 1), -sensitivity * dx);
+    const Quaternionf pitch =
+      Quaternionf_fromAxisAngle(Vector3f_make(0, 1, 0), -sensitivity * dy);
+    camera->orientation = Quaternionf_normalize(
+      Quaternionf_multiply(yaw, Quaternionf_multiply(camera->orientation, pitch)));
+    position_update(camera);
   }
 }
 void Application_Camera_activate(
@@ -51,8 +86,7 @@ void Application_Camera_activate(
     switch (action) {
       case GLFW_PRESS:
         camera->dragging = true;
-        camera->position.components[0] = -x;
-        camera->position.components[1] = y;
+        camera->cursor = Vector2f_make(x, y);
         break;
       case GLFW_RELEASE:
         camera->dragging = false;
@@ -62,12 +96,7 @@ void Application_Camera_activate(
 }
 void Application_Camera_zoom(Camera camera[static 1], float /*x*/, float y) {
   camera->zoom += scrollSensitivity * y;
-  float cx = cos(camera->angles.components[0]);
-  float sx = sin(camera->angles.components[0]);
-  float cy = cos(camera->angles.components[1]);
-  float sy = sin(camera->angles.components[1]);
-  camera->position =
-    Vector_scale(exp(-camera->zoom), Vector3f_make(cx * cy, sx * cy, sy));
+  position_update(camera);
 }
 
 #endif // Camera_H_
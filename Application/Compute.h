@@ -16,30 +16,37 @@ typedef struct {
 
 static WGPUBindGroupLayout bindGroupLayout_attach(WGPUDevice device);
 static WGPUBindGroup bindGroup_attach(WGPUDevice device, WGPUBindGroupLayout layout);
-static WGPUComputePipeline computePipeline_attach(WGPUDevice device);
+static void computePipeline_attach(WGPUDevice device, WGPUComputePipeline pipeline[static 1]);
 static void Compute_buffers_attach(Application_Compute compute[static 1]);
 
-Application_Compute Application_Compute_create(WGPUDevice device) {
+// the pipeline is compiled asynchronously, so the result has to stay where it is
+void Application_Compute_create(WGPUDevice device, Application_Compute result[static 1]) {
   const WGPUBindGroupLayout layout = bindGroupLayout_attach(device);
-  Application_Compute result = {
+  *result = (Application_Compute){
     .bindGroup = bindGroup_attach(device, layout),
-    .pipeline = computePipeline_attach(device),
   };
-  Compute_buffers_attach(&result);
-  return result;
+  computePipeline_attach(device, &result->pipeline);
+  Compute_buffers_attach(result);
 }
-void Application_Compute_destroy(Application_Compute compute) {
-  wgpuComputePipelineRelease(compute.pipeline);
-  wgpuBindGroupRelease(compute.bindGroup);
-  wgpuBufferDestroy(compute.buffer.input);
-  wgpuBufferRelease(compute.buffer.input);
-  wgpuBufferDestroy(compute.buffer.output);
-  wgpuBufferRelease(compute.buffer.output);
+void Application_Compute_destroy(Application_Compute compute[static 1]) {
+  Application_device_Pipeline_cancel(&compute->pipeline);
+  if (compute->pipeline) {
+    wgpuComputePipelineRelease(compute->pipeline);
+  }
+  wgpuBindGroupRelease(compute->bindGroup);
+  wgpuBufferDestroy(compute->buffer.input);
+  wgpuBufferRelease(compute->buffer.input);
+  wgpuBufferDestroy(compute->buffer.output);
+  wgpuBufferRelease(compute->buffer.output);
 }
 void Application_Compute_compute(
   Application_Compute compute,
   WGPUDevice device,
-  WGPUQueue queue) {
+  WGPUQueue queue,
+  const WGPUComputePassTimestampWrites* timestampWrites) {
+  if (!compute.pipeline) {
+    return;
+  }
   // Initialize a command encoder
   WGPUCommandEncoderDescriptor commandEncoderDesc = {
     .nextInChain = 0,
@@ -52,7 +59,7 @@ void Application_Compute_compute(
   WGPUComputePassDescriptor descriptor = {
     .nextInChain = 0,
     .label = "compute pass",
-    .timestampWrites = 0,
+    .timestampWrites = timestampWrites,
   };
   WGPUComputePassEncoder pass = wgpuCommandEncoderBeginComputePass(encoder, &descriptor);
 
@@ -124,7 +131,7 @@ static WGPUBindGroup bindGroup_attach(WGPUDevice device, WGPUBindGroupLayout lay
   WGPUBindGroup result = wgpuDeviceCreateBindGroup(device, &descriptor);
   return result;
 }
-static WGPUComputePipeline computePipeline_attach(WGPUDevice device) {
+static void computePipeline_attach(WGPUDevice device, WGPUComputePipeline pipeline[static 1]) {
   WGPUShaderModule shader =
     Application_device_ShaderModule(device, RESOURCE_DIR "/compute/pipeline.wgsl");
   WGPUBindGroupLayout bindGroupLayout = bindGroupLayout_attach(device);
@@ -144,8 +151,7 @@ static WGPUComputePipeline computePipeline_attach(WGPUDevice device) {
     .compute.constantCount = 0,
     .compute.constants = 0,
   };
-  WGPUComputePipeline pipeline = wgpuDeviceCreateComputePipeline(device, &descriptor);
-  return pipeline;
+  Application_device_ComputePipeline_request(device, &descriptor, pipeline);
 }
 static void Compute_buffers_attach(Application_Compute compute[static 1]) {
 }
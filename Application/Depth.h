@@ -2,6 +2,7 @@
 #define DepthBuffer_H_
 
 #include "webgpu.h"
+#include "./memory.h"
 
 typedef struct {
     WGPUTextureFormat format;
@@ -12,6 +13,7 @@ typedef struct {
 Application_Depth Application_Depth_attach(WGPUDevice device, int width, int height) {
   Application_Depth result = { .format = WGPUTextureFormat_Depth24Plus };
   WGPUTextureDescriptor depthTextureDescriptor = {
+    .label = "depth texture",
     .dimension = WGPUTextureDimension_2D,
     .format = result.format,
     .mipLevelCount = 1,
@@ -21,7 +23,10 @@ Application_Depth Application_Depth_attach(WGPUDevice device, int width, int hei
     .viewFormatCount = 1,
     .viewFormats = &result.format,
   };
-  result.texture = wgpuDeviceCreateTexture(device, &depthTextureDescriptor);
+  result.texture = Application_memory_Texture_create(
+    device,
+    &depthTextureDescriptor,
+    Application_memory_RenderTarget);
   WGPUTextureViewDescriptor depthTextureViewDescriptor = {
     .aspect = WGPUTextureAspect_DepthOnly,
     .baseArrayLayer = 0,
@@ -35,8 +40,7 @@ Application_Depth Application_Depth_attach(WGPUDevice device, int width, int hei
   return result;
 }
 void Application_Depth_detach(Application_Depth depth) {
-  wgpuTextureDestroy(depth.texture);
-  wgpuTextureRelease(depth.texture);
+  Application_memory_Texture_destroy(depth.texture);
   wgpuTextureViewRelease(depth.view);
 }
 
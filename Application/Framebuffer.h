@@ -0,0 +1,160 @@
+#ifndef Framebuffer_H_
+#define Framebuffer_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "webgpu.h"
+#include "./memory.h"
+#include "./Depth.h"
+
+// While the window is resized the attachments of the main pass are allocated in buckets
+// of sizes, it mostly keeps drawing into the textures it has through the viewport and
+// the region drawn is copied to the surface. Once the size has held for a few frames the
+// pass draws into the surface again with a depth of its exact size, a window that is not
+// resized pays no copy. Attachments must have the same size, so without copies to the
+// surface the pass always draws into it directly.
+#define FRAMEBUFFER_BUCKET (128) // pixels the sizes are rounded up to
+#define FRAMEBUFFER_SETTLE (30) // frames at the same size before the copies stop
+
+typedef struct {
+    bool copyable; // the surface can be copied to
+    bool offscreen; // drawing into the color texture, only while resizing
+    size_t settled; // frames drawn since the last resize
+    WGPUTextureFormat colorFormat;
+    WGPUTexture color; // null when drawing into the surface
+    WGPUTextureView colorView;
+    Application_Depth depth;
+    uint32_t width; // allocated
+    uint32_t height;
+    size_t allocations; // textures created
+    size_t copies; // frames drawn offscreen
+} Application_Framebuffer;
+
+static uint32_t framebuffer_bucket(uint32_t size) {
+  return (size + FRAMEBUFFER_BUCKET - 1) / FRAMEBUFFER_BUCKET * FRAMEBUFFER_BUCKET;
+}
+static void framebuffer_release(Application_Framebuffer framebuffer[static 1]) {
+  if (framebuffer->color) {
+    wgpuTextureViewRelease(framebuffer->colorView);
+    Application_memory_Texture_destroy(framebuffer->color);
+    framebuffer->color = 0;
+  }
+  if (framebuffer->depth.texture) {
+    Application_Depth_detach(framebuffer->depth);
+    framebuffer->depth.texture = 0;
+  }
+}
+// offscreen textures are kept while they hold the size and are not twice as large as
+// needed, returns whether they were allocated again
+static bool framebuffer_fit(
+  Application_Framebuffer framebuffer[static 1],
+  WGPUDevice device,
+  uint32_t width,
+  uint32_t height) {
+  const bool offscreen = framebuffer->offscreen;
+  const uint32_t bucketWidth = offscreen ? framebuffer_bucket(width) : width;
+  const uint32_t bucketHeight = offscreen ? framebuffer_bucket(height) : height;
+  const bool fits =
+    offscreen ? framebuffer->color && framebuffer->width >= width
+                  && framebuffer->height >= height && 2 * bucketWidth > framebuffer->width
+                  && 2 * bucketHeight > framebuffer->height
+              : !framebuffer->color && framebuffer->width == width
+                  && framebuffer->height == height;
+  if (framebuffer->depth.texture && fits) {
+    return false;
+  }
+  framebuffer_release(framebuffer);
+  framebuffer->width = bucketWidth;
+  framebuffer->height = bucketHeight;
+  framebuffer->depth = Application_Depth_attach(device, bucketWidth, bucketHeight);
+  framebuffer->allocations++;
+  if (framebuffer->offscreen) {
+    const WGPUTextureDescriptor descriptor = {
+      .nextInChain = 0,
+      .label = "color texture",
+      .usage = WGPUTextureUsage_RenderAttachment | WGPUTextureUsage_CopySrc,
+      .dimension = WGPUTextureDimension_2D,
+      .size = {bucketWidth, bucketHeight, 1},
+      .format = framebuffer->colorFormat,
+      .mipLevelCount = 1,
+      .sampleCount = 1,
+      .viewFormatCount = 0,
+      .viewFormats = 0,
+    };
+    framebuffer->color = Application_memory_Texture_create(
+      device,
+      &descriptor,
+      Application_memory_RenderTarget);
+    framebuffer->colorView = wgpuTextureCreateView(framebuffer->color, 0);
+    framebuffer->allocations++;
+  }
+  return true;
+}
+// a resize draws offscreen when it can, returns whether the textures were allocated again
+bool Application_Framebuffer_fit(
+  Application_Framebuffer framebuffer[static 1],
+  WGPUDevice device,
+  uint32_t width,
+  uint32_t height) {
+  framebuffer->offscreen = framebuffer->copyable;
+  framebuffer->settled = 0;
+  return framebuffer_fit(framebuffer, device, width, height);
+}
+// once a frame, back to the surface at the exact size when the size has held
+bool Application_Framebuffer_settle(
+  Application_Framebuffer framebuffer[static 1],
+  WGPUDevice device,
+  uint32_t width,
+  uint32_t height) {
+  if (!framebuffer->offscreen || FRAMEBUFFER_SETTLE > ++framebuffer->settled) {
+    return false;
+  }
+  framebuffer->offscreen = false;
+  return framebuffer_fit(framebuffer, device, width, height);
+}
+Application_Framebuffer Application_Framebuffer_attach(
+  WGPUDevice device,
+  WGPUTextureFormat colorFormat,
+  bool copyable,
+  uint32_t width,
+  uint32_t height) {
+  Application_Framebuffer result = {
+    .copyable = copyable,
+    .colorFormat = colorFormat,
+    .depth = { .format = WGPUTextureFormat_Depth24Plus },
+  };
+  framebuffer_fit(&result, device, width, height);
+  return result;
+}
+void Application_Framebuffer_detach(Application_Framebuffer framebuffer[static 1]) {
+  framebuffer_release(framebuffer);
+}
+// the region drawn into the offscreen color, to the surface texture of the same format
+void Application_Framebuffer_copy(
+  Application_Framebuffer framebuffer[static 1],
+  WGPUCommandEncoder encoder,
+  WGPUTexture surface) {
+  const WGPUImageCopyTexture source = {
+    .texture = framebuffer->color,
+    .mipLevel = 0,
+    .origin = {0, 0, 0},
+    .aspect = WGPUTextureAspect_All,
+  };
+  const WGPUImageCopyTexture destination = {
+    .texture = surface,
+    .mipLevel = 0,
+    .origin = {0, 0, 0},
+    .aspect = WGPUTextureAspect_All,
+  };
+  const uint32_t width = wgpuTextureGetWidth(surface);
+  const uint32_t height = wgpuTextureGetHeight(surface);
+  const WGPUExtent3D size = {
+    .width = width < framebuffer->width ? width : framebuffer->width,
+    .height = height < framebuffer->height ? height : framebuffer->height,
+    .depthOrArrayLayers = 1,
+  };
+  wgpuCommandEncoderCopyTextureToTexture(encoder, &source, &destination, &size);
+  framebuffer->copies++;
+}
+
+#endif // Framebuffer_H_
@@ -2,60 +2,191 @@
 #define Application_Lightning_H_
 
 // #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include <stdbool.h>
 #include "webgpu.h"
 #include "linear/algebra.h"
+#include "./stats.h"
+#include "./memory.h"
+#include "./preprocessor.h"
+#include "./limits.h"
+#include "./trace.h"
+#include "./cluster.h"
+#include "./dirty.h"
+
+// the shaders are specialized for the light count, it has to stay a plain number
+#define LIGHTING_COUNT             2
+#define LIGHTING_STRINGIFY(value)  #value
+#define LIGHTING_DEFINE(count)     { .name = "LIGHT_COUNT", .value = LIGHTING_STRINGIFY(count) }
 
 typedef struct {
-    Vector4f directions[2];
-    Vector4f colors[2];
+    Vector4f directions[LIGHTING_COUNT];
+    Vector4f colors[LIGHTING_COUNT];
     float hardness;
     float diffusivity;
     float specularity;
-    float _pad[1];
+    // the depth range and the framebuffer size the clusters were binned for
+    float near;
+    float far;
+    uint32_t pointCount;
+    Vector2f viewport;
 } Application_Lighting_Uniforms;
 
 typedef struct {
-    bool update;
+    Application_dirty dirty; // of the uniforms
     WGPUBuffer buffer;
     Application_Lighting_Uniforms uniforms;
+    // point lights, binned again when the camera moves
+    Application_cluster* cluster;
+    struct {
+        Matrix4f view;
+        Matrix4f projection;
+        bool done;
+    } binned;
+    Application_cluster_Light* points;
+    WGPUBuffer pointBuffer;
+    WGPUBuffer clusterBuffer;
 } Application_Lighting;
 
-Application_Lighting Application_Lightning_create(WGPUDevice device) {
+static size_t points_size(size_t count) {
+  // an empty storage binding is not allowed
+  return (count ? count : 1) * sizeof(Application_cluster_Light);
+}
+// what the storage buffers of the point lights need from the device
+void Application_Lightning_require(WGPULimits limits[static 1], size_t pointCount) {
+  LIMITS_REQUIRE(limits->maxStorageBuffersPerShaderStage, 2u);
+  LIMITS_REQUIRE(limits->maxStorageBufferBindingSize, (uint64_t)points_size(pointCount));
+  LIMITS_REQUIRE(
+    limits->maxStorageBufferBindingSize,
+    (uint64_t)(CLUSTER_WORDS * sizeof(uint32_t)));
+}
+// scattered over the scene with a fixed seed, so runs compare
+static float points_random(uint32_t state[static 1]) {
+  *state = *state * 1664525u + 1013904223u;
+  return (float)(*state >> 8) / (float)(1u << 24);
+}
+static void points_attach(
+  Application_Lighting lightning[static 1],
+  WGPUDevice device,
+  WGPUQueue queue,
+  size_t count) {
+  lightning->points = calloc(count ? count : 1, sizeof(*lightning->points));
+  uint32_t state = 1;
+  for (size_t i = 0; lightning->points && count > i; i++) {
+    lightning->points[i] = (Application_cluster_Light){
+      .position = Vector3f_make(
+        -2.0f + 9.0f * points_random(&state),
+        -2.0f + 7.0f * points_random(&state),
+        3.0f * points_random(&state)),
+      .radius = 0.5f + points_random(&state),
+      .color = Vector3f_make(
+        points_random(&state),
+        points_random(&state),
+        points_random(&state)),
+      .intensity = 1.0f,
+    };
+  }
+  lightning->uniforms.pointCount = lightning->points ? count : 0;
+  WGPUBufferDescriptor descriptor = {
+    .label = "point light buffer",
+    .size = points_size(count),
+    .usage = WGPUBufferUsage_CopyDst | WGPUBufferUsage_Storage,
+    .mappedAtCreation = false,
+  };
+  lightning->pointBuffer =
+    Application_memory_Buffer_create(device, &descriptor, Application_memory_Storage);
+  if (lightning->points) {
+    wgpuQueueWriteBuffer(queue, lightning->pointBuffer, 0, lightning->points, descriptor.size);
+    Application_stats_add(Application_stats_UploadBytes, descriptor.size);
+  }
+  descriptor.label = "light cluster buffer";
+  descriptor.size = CLUSTER_WORDS * sizeof(uint32_t);
+  lightning->clusterBuffer =
+    Application_memory_Buffer_create(device, &descriptor, Application_memory_Storage);
+}
+
+// the point lights are binned on the job system, one task per thread
+Application_Lighting Application_Lightning_create(
+  WGPUDevice device,
+  WGPUQueue queue,
+  size_t pointCount,
+  Application_jobs* jobs) {
   WGPUBufferDescriptor bufferDescriptor = {
+    .label = "lighting buffer",
     .size = sizeof(Application_Lighting_Uniforms),
     .usage = WGPUBufferUsage_CopyDst | WGPUBufferUsage_Uniform,
     .mappedAtCreation = false
   };
   Application_Lighting result = {
-    .update = true,
-    .buffer = wgpuDeviceCreateBuffer(device, &bufferDescriptor),
+    .buffer = Application_memory_Buffer_create(
+      device,
+      &bufferDescriptor,
+      Application_memory_Uniform),
     .uniforms.colors = { Vector4f_make(0.5f, -0.9f, 0.1f, 1.0f), Vector4f_make(1.0f, 0.4f, 0.3f, 1.0f), },
 		.uniforms.directions = { Vector4f_make(1.0f, 0.9f, 0.6f, 1.0f), Vector4f_make(0.6f, 0.9f, 1.0f, 1.0f), },
 		.uniforms.diffusivity = 1.0f,
 		.uniforms.specularity = 0.5f,
-		.uniforms.hardness = 1.0f
+		.uniforms.hardness = 1.0f,
+    .cluster = Application_cluster_create(jobs, 0),
   };
+  points_attach(&result, device, queue, pointCount);
+  Application_dirty_mark(&result.dirty, 0, sizeof(Application_Lighting_Uniforms));
   // maybe check if the created buffer is null?
   return result;
 }
 void Application_Lightning_destroy(Application_Lighting lightning) {
-  wgpuBufferDestroy(lightning.buffer);
-  wgpuBufferRelease(lightning.buffer);
+  Application_memory_Buffer_destroy(lightning.buffer);
+  Application_memory_Buffer_destroy(lightning.pointBuffer);
+  Application_memory_Buffer_destroy(lightning.clusterBuffer);
+  Application_cluster_destroy(lightning.cluster);
+  free(lightning.points);
 }
+// the matrices are the untransposed ones, the viewport the framebuffer size
 void Application_Lightning_update(
   Application_Lighting lightning[static 1],
-  WGPUQueue queue) {
-  if (lightning->update) {
-    wgpuQueueWriteBuffer(
-      queue,
-      lightning->buffer,
-      0,
-      &lightning->uniforms,
-      sizeof(Application_Lighting_Uniforms));
-    // printf("update lightning\n");
-    lightning->update = false;
+  WGPUQueue queue,
+  Matrix4f view,
+  Matrix4f projection,
+  Vector2f viewport) {
+  // the lights do not move, so neither do their clusters while the camera stays
+  const bool moved =
+    !lightning->binned.done || memcmp(&view, &lightning->binned.view, sizeof(view))
+    || memcmp(&projection, &lightning->binned.projection, sizeof(projection));
+  if (lightning->cluster && moved) {
+    TRACE_SCOPE("light binning");
+    lightning->binned.view = view;
+    lightning->binned.projection = projection;
+    lightning->binned.done = true;
+    size_t size = 0;
+    const uint32_t* grid = Application_cluster_bin(
+      lightning->cluster,
+      lightning->uniforms.pointCount,
+      lightning->points,
+      view,
+      projection,
+      &size);
+    wgpuQueueWriteBuffer(queue, lightning->clusterBuffer, 0, grid, size);
+    Application_stats_add(Application_stats_UploadBytes, size);
+  }
+  const float* p = projection.elements;
+  const float near = p[11] / (p[10] - 1);
+  const float far = p[11] / (p[10] + 1);
+  if (lightning->uniforms.near != near || lightning->uniforms.far != far) {
+    lightning->uniforms.near = near;
+    lightning->uniforms.far = far;
+    DIRTY_MARK(&lightning->dirty, lightning->uniforms, near);
+    DIRTY_MARK(&lightning->dirty, lightning->uniforms, far);
+  }
+  if (!Vector_areEqual(lightning->uniforms.viewport, viewport)) {
+    lightning->uniforms.viewport = viewport;
+    DIRTY_MARK(&lightning->dirty, lightning->uniforms, viewport);
   }
+  Application_dirty_flush(
+    &lightning->dirty,
+    queue,
+    lightning->buffer,
+    &lightning->uniforms);
 }
 
 #endif // Application_Lightning_H_
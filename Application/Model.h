@@ -6,6 +6,7 @@
 #define TINYOBJ_LOADER_C_IMPLEMENTATION
 #include "tinyobj_loader_c.h"
 #include "linear/algebra.h"
+#include "./trace.h"
 
 typedef struct {
     Vector3f position;
@@ -43,6 +44,7 @@ static void loadFile(
   *length = read_size;
 }
 Model Model_load(const char* const file, Vector3f offset) {
+  TRACE_SCOPE("Model_load");
   tinyobj_shape_t* shapes = 0;
   tinyobj_material_t* materials = 0;
   tinyobj_attrib_t attributes;
@@ -0,0 +1,283 @@
+#ifndef Application_Profiler_H_
+#define Application_Profiler_H_
+
+#include <stdio.h>
+#include <stdint.h>
+#include <float.h>
+#include <stdbool.h>
+#include <string.h>
+#include "webgpu.h"
+#include "./memory.h"
+
+#define PROFILER_PASS_CAPACITY (8)
+// readback buffers in flight, a frame is skipped rather than waited on when all are busy
+#define PROFILER_READBACK_COUNT (3)
+
+typedef struct {
+    const char* name;
+    double milliseconds;
+    double average;
+    double minimum;
+    double maximum;
+    size_t samples;
+} Application_Profiler_Pass;
+
+typedef struct Application_Profiler Application_Profiler;
+typedef struct {
+    Application_Profiler* profiler;
+    WGPUBuffer buffer;
+    const char* names[PROFILER_PASS_CAPACITY];
+    size_t passCount;
+    bool pending;
+} Application_Profiler_Readback;
+struct Application_Profiler {
+    bool enabled;
+    bool encoderWrites; // timestamps between the passes, as around copies
+    bool recording;
+    WGPUQuerySet querySet;
+    WGPUBuffer resolve;
+    Application_Profiler_Readback readbacks[PROFILER_READBACK_COUNT];
+    size_t current;
+    size_t frames;
+    size_t skipped;
+    WGPURenderPassTimestampWrites renderWrites[PROFILER_PASS_CAPACITY];
+    WGPUComputePassTimestampWrites computeWrites[PROFILER_PASS_CAPACITY];
+    Application_Profiler_Pass passes[PROFILER_PASS_CAPACITY];
+    size_t passCount;
+};
+
+Application_Profiler Application_Profiler_create(WGPUDevice device, bool enabled) {
+  Application_Profiler result = {
+    .enabled = enabled && wgpuDeviceHasFeature(device, WGPUFeatureName_TimestampQuery),
+  };
+  if (enabled && !result.enabled) {
+    printf("Timestamp queries are not supported, GPU profiling disabled.\n");
+  }
+  result.encoderWrites =
+    result.enabled
+    && wgpuDeviceHasFeature(
+      device,
+      WGPUFeatureName_ChromiumExperimentalTimestampQueryInsidePasses);
+  if (result.enabled) {
+    WGPUQuerySetDescriptor querySetDescriptor = {
+      .nextInChain = 0,
+      .label = "profiler query set",
+      .type = WGPUQueryType_Timestamp,
+      .count = 2 * PROFILER_PASS_CAPACITY,
+    };
+    result.querySet = wgpuDeviceCreateQuerySet(device, &querySetDescriptor);
+    WGPUBufferDescriptor descriptor = {
+      .nextInChain = 0,
+      .label = "profiler resolve buffer",
+      .usage = WGPUBufferUsage_QueryResolve | WGPUBufferUsage_CopySrc,
+      .mappedAtCreation = false,
+      .size = 2 * PROFILER_PASS_CAPACITY * sizeof(uint64_t),
+    };
+    result.resolve =
+      Application_memory_Buffer_create(device, &descriptor, Application_memory_Readback);
+    descriptor.label = "profiler readback buffer";
+    descriptor.usage = WGPUBufferUsage_MapRead | WGPUBufferUsage_CopyDst;
+    for (size_t i = 0; PROFILER_READBACK_COUNT > i; i++) {
+      result.readbacks[i].buffer =
+        Application_memory_Buffer_create(device, &descriptor, Application_memory_Readback);
+    }
+  }
+  return result;
+}
+void Application_Profiler_destroy(Application_Profiler profiler[static 1]) {
+  if (profiler->enabled) {
+    for (size_t i = 0; PROFILER_READBACK_COUNT > i; i++) {
+      Application_memory_Buffer_destroy(profiler->readbacks[i].buffer);
+    }
+    Application_memory_Buffer_destroy(profiler->resolve);
+    wgpuQuerySetDestroy(profiler->querySet);
+    wgpuQuerySetRelease(profiler->querySet);
+    profiler->enabled = false;
+  }
+}
+// picks the next readback buffer, if it is still being mapped this frame is not recorded
+void Application_Profiler_begin(Application_Profiler profiler[static 1]) {
+  if (profiler->enabled) {
+    profiler->current = (profiler->current + 1) % PROFILER_READBACK_COUNT;
+    Application_Profiler_Readback* readback = &profiler->readbacks[profiler->current];
+    profiler->recording = !readback->pending;
+    if (profiler->recording) {
+      readback->passCount = 0;
+      readback->profiler = profiler;
+    }
+    else {
+      profiler->skipped++;
+    }
+  }
+}
+static size_t Profiler_passAdd(Application_Profiler profiler[static 1], const char* name) {
+  Application_Profiler_Readback* readback = &profiler->readbacks[profiler->current];
+  size_t result = PROFILER_PASS_CAPACITY;
+  if (profiler->recording && PROFILER_PASS_CAPACITY > readback->passCount) {
+    result = readback->passCount++;
+    readback->names[result] = name;
+  }
+  return result;
+}
+// the returned pointer is null when profiling is disabled, it can be assigned to the pass descriptor as is
+const WGPURenderPassTimestampWrites* Application_Profiler_RenderPassTimestampWrites(
+  Application_Profiler profiler[static 1],
+  const char* name) {
+  const WGPURenderPassTimestampWrites* result = 0;
+  const size_t index = Profiler_passAdd(profiler, name);
+  if (PROFILER_PASS_CAPACITY > index) {
+    profiler->renderWrites[index] = (WGPURenderPassTimestampWrites){
+      .querySet = profiler->querySet,
+      .beginningOfPassWriteIndex = 2 * index,
+      .endOfPassWriteIndex = 2 * index + 1,
+    };
+    result = &profiler->renderWrites[index];
+  }
+  return result;
+}
+const WGPUComputePassTimestampWrites* Application_Profiler_ComputePassTimestampWrites(
+  Application_Profiler profiler[static 1],
+  const char* name) {
+  const WGPUComputePassTimestampWrites* result = 0;
+  const size_t index = Profiler_passAdd(profiler, name);
+  if (PROFILER_PASS_CAPACITY > index) {
+    profiler->computeWrites[index] = (WGPUComputePassTimestampWrites){
+      .querySet = profiler->querySet,
+      .beginningOfPassWriteIndex = 2 * index,
+      .endOfPassWriteIndex = 2 * index + 1,
+    };
+    result = &profiler->computeWrites[index];
+  }
+  return result;
+}
+// timestamps around the commands encoded between the begin and the end, outside of the
+// passes, nothing is written when the device cannot, the begin returns the index to end
+size_t Application_Profiler_CommandsBegin(
+  Application_Profiler profiler[static 1],
+  WGPUCommandEncoder encoder,
+  const char* name) {
+  const size_t result =
+    profiler->encoderWrites ? Profiler_passAdd(profiler, name) : PROFILER_PASS_CAPACITY;
+  if (PROFILER_PASS_CAPACITY > result) {
+    wgpuCommandEncoderWriteTimestamp(encoder, profiler->querySet, 2 * result);
+  }
+  return result;
+}
+void Application_Profiler_CommandsEnd(
+  Application_Profiler profiler[static 1],
+  WGPUCommandEncoder encoder,
+  size_t index) {
+  if (PROFILER_PASS_CAPACITY > index) {
+    wgpuCommandEncoderWriteTimestamp(encoder, profiler->querySet, 2 * index + 1);
+  }
+}
+// has to be encoded after the last profiled pass and before the encoder is finished
+void Application_Profiler_resolve(
+  Application_Profiler profiler[static 1],
+  WGPUCommandEncoder encoder) {
+  Application_Profiler_Readback* readback = &profiler->readbacks[profiler->current];
+  if (profiler->recording && readback->passCount) {
+    const uint32_t queryCount = 2 * readback->passCount;
+    wgpuCommandEncoderResolveQuerySet(
+      encoder,
+      profiler->querySet,
+      0,
+      queryCount,
+      profiler->resolve,
+      0);
+    wgpuCommandEncoderCopyBufferToBuffer(
+      encoder,
+      profiler->resolve,
+      0,
+      readback->buffer,
+      0,
+      queryCount * sizeof(uint64_t));
+  }
+}
+static Application_Profiler_Pass* Profiler_passGet(
+  Application_Profiler profiler[static 1],
+  const char* name) {
+  Application_Profiler_Pass* result = 0;
+  for (size_t i = 0; !result && profiler->passCount > i; i++) {
+    if (!strcmp(profiler->passes[i].name, name)) {
+      result = &profiler->passes[i];
+    }
+  }
+  if (!result && PROFILER_PASS_CAPACITY > profiler->passCount) {
+    result = &profiler->passes[profiler->passCount++];
+    *result = (Application_Profiler_Pass){ .name = name, .minimum = DBL_MAX };
+  }
+  return result;
+}
+static void Profiler_onMap(WGPUBufferMapAsyncStatus status, void* userdata) {
+  Application_Profiler_Readback* readback = (Application_Profiler_Readback*)userdata;
+  Application_Profiler* profiler = readback->profiler;
+  if (status == WGPUBufferMapAsyncStatus_Success) {
+    const size_t size = 2 * readback->passCount * sizeof(uint64_t);
+    const uint64_t* timestamps =
+      (const uint64_t*)wgpuBufferGetConstMappedRange(readback->buffer, 0, size);
+    for (size_t i = 0; timestamps && readback->passCount > i; i++) {
+      Application_Profiler_Pass* pass = Profiler_passGet(profiler, readback->names[i]);
+      // timestamps are in nanoseconds, an end before the beginning means the counter was reset
+      if (pass && timestamps[2 * i + 1] >= timestamps[2 * i]) {
+        pass->milliseconds = (double)(timestamps[2 * i + 1] - timestamps[2 * i]) / 1e6;
+        pass->average = pass->samples
+                          ? 0.95 * pass->average + 0.05 * pass->milliseconds
+                          : pass->milliseconds;
+        pass->minimum = pass->milliseconds < pass->minimum ? pass->milliseconds
+                                                           : pass->minimum;
+        pass->maximum = pass->milliseconds > pass->maximum ? pass->milliseconds
+                                                           : pass->maximum;
+        pass->samples++;
+      }
+    }
+    wgpuBufferUnmap(readback->buffer);
+    profiler->frames++;
+  }
+  readback->pending = false;
+}
+// has to be called after the submit, the results arrive during a later device tick
+void Application_Profiler_collect(Application_Profiler profiler[static 1]) {
+  Application_Profiler_Readback* readback = &profiler->readbacks[profiler->current];
+  if (profiler->recording && readback->passCount) {
+    readback->pending = true;
+    wgpuBufferMapAsync(
+      readback->buffer,
+      WGPUMapMode_Read,
+      0,
+      2 * readback->passCount * sizeof(uint64_t),
+      Profiler_onMap,
+      readback);
+  }
+  profiler->recording = false;
+}
+double Application_Profiler_total(Application_Profiler profiler[static 1]) {
+  double result = 0;
+  for (size_t i = 0; profiler->passCount > i; i++) {
+    result += profiler->passes[i].milliseconds;
+  }
+  return result;
+}
+void Application_Profiler_report(Application_Profiler profiler[static 1], FILE* output) {
+  fprintf(output, "{\n  \"enabled\": %s,\n", profiler->enabled ? "true" : "false");
+  fprintf(output, "  \"frames\": %zu,\n", profiler->frames);
+  fprintf(output, "  \"skipped\": %zu,\n", profiler->skipped);
+  fprintf(output, "  \"passes\": [");
+  for (size_t i = 0; profiler->passCount > i; i++) {
+    const Application_Profiler_Pass pass = profiler->passes[i];
+    fprintf(
+      output,
+      "%s\n    {\"name\": \"%s\", \"samples\": %zu, \"last\": %.6f, \"average\": %.6f, "
+      "\"min\": %.6f, \"max\": %.6f}",
+      i ? "," : "",
+      pass.name,
+      pass.samples,
+      pass.milliseconds,
+      pass.average,
+      pass.samples ? pass.minimum : 0.0,
+      pass.maximum);
+  }
+  fprintf(output, "\n  ]\n}\n");
+}
+
+#endif // Application_Profiler_H_
@@ -6,7 +6,8 @@
 WGPURenderPassEncoder Application_RenderPassEncoder_make(
   WGPUCommandEncoder encoder,
   WGPUTextureView texture,
-  WGPUTextureView depth) {
+  WGPUTextureView depth,
+  const WGPURenderPassTimestampWrites* timestampWrites) {
   WGPURenderPassColorAttachment renderPassColorAttachment = {
     .view = texture,
     .resolveTarget = 0,
@@ -31,7 +32,7 @@ WGPURenderPassEncoder Application_RenderPassEncoder_make(
     .colorAttachmentCount = 1,
     .colorAttachments = &renderPassColorAttachment,
     .depthStencilAttachment = &depthStencilAttachment,
-    .timestampWrites = 0,
+    .timestampWrites = timestampWrites,
   };
   WGPURenderPassEncoder renderPass =
     wgpuCommandEncoderBeginRenderPass(encoder, &renderPassDesc);
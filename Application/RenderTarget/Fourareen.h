@@ -5,6 +5,7 @@
 #include "webgpu.h"
 #include "linear/algebra.h"
 #include "./RenderTarget.h"
+#include "../Lightning.h"
 
 #define EXTEND(B, T) \
   struct {           \
@@ -16,13 +17,35 @@
 
 typedef EXTEND(RenderTarget, { int placeholder; }) Fourareen;
 
+#define FOURAREEN_SHADER  RESOURCE_DIR "/lightning/specularity.wgsl"
+#define FOURAREEN_MODEL   RESOURCE_DIR "/fourareen/fourareen.obj"
+#define FOURAREEN_TEXTURE RESOURCE_DIR "/fourareen/fourareen2K_albedo.jpg"
+
+// the permutation of the shader, the same defines share a compiled module
+static const Application_preprocessor_Define Fourareen_defines[] = {
+  LIGHTING_DEFINE(LIGHTING_COUNT),
+  CLUSTER_DEFINES,
+  { .name = "TEXTURED", .value = "1" },
+};
+
+void Fourareen_require(
+  WGPULimits limits[static 1],
+  size_t lightningBufferSize,
+  size_t uniformBufferSize) {
+  RenderTarget_require(
+    limits,
+    lightningBufferSize,
+    uniformBufferSize,
+    FOURAREEN_MODEL,
+    FOURAREEN_TEXTURE);
+}
+
 Fourareen* Fourareen_Create(
   Fourareen* result,
   WGPUDevice device,
   WGPUQueue queue,
   WGPUTextureFormat depthFormat,
-  WGPUBuffer lightningBuffer,
-  size_t lightningBufferSize,
+  const Application_Lighting lightning[static 1],
   WGPUBuffer uniformBuffer,
   size_t uniformBufferSize,
   Vector3f offset) {
@@ -32,14 +55,15 @@ Fourareen* Fourareen_Create(
       device,
       queue,
       depthFormat,
-      lightningBuffer,
-      lightningBufferSize,
+      lightning,
       uniformBuffer,
       uniformBufferSize,
       offset,
-      RESOURCE_DIR "/lightning/specularity.wgsl",
-      RESOURCE_DIR "/fourareen/fourareen.obj",
-      RESOURCE_DIR "/fourareen/fourareen2K_albedo.jpg");
+      FOURAREEN_SHADER,
+      sizeof(Fourareen_defines) / sizeof(*Fourareen_defines),
+      Fourareen_defines,
+      FOURAREEN_MODEL,
+      FOURAREEN_TEXTURE);
   }
   return result;
 }
@@ -5,6 +5,7 @@
 #include "webgpu.h"
 #include "linear/algebra.h"
 #include "./RenderTarget.h"
+#include "../Lightning.h"
 
 #define EXTEND(B, T) \
   struct {           \
@@ -16,13 +17,35 @@
 
 typedef EXTEND(RenderTarget, { int placeholder; }) Mammoth;
 
+#define MAMMOTH_SHADER  RESOURCE_DIR "/lightning/specularity.wgsl"
+#define MAMMOTH_MODEL   RESOURCE_DIR "/meshes/mammoth.obj"
+#define MAMMOTH_TEXTURE RESOURCE_DIR "/fourareen/fourareen2K_albedo.jpg"
+
+// the permutation of the shader, the same defines share a compiled module
+static const Application_preprocessor_Define Mammoth_defines[] = {
+  LIGHTING_DEFINE(LIGHTING_COUNT),
+  CLUSTER_DEFINES,
+  { .name = "TEXTURED", .value = "1" },
+};
+
+void Mammoth_require(
+  WGPULimits limits[static 1],
+  size_t lightningBufferSize,
+  size_t uniformBufferSize) {
+  RenderTarget_require(
+    limits,
+    lightningBufferSize,
+    uniformBufferSize,
+    MAMMOTH_MODEL,
+    MAMMOTH_TEXTURE);
+}
+
 Mammoth* Mammoth_Create(
   Mammoth* result,
   WGPUDevice device,
   WGPUQueue queue,
   WGPUTextureFormat depthFormat,
-  WGPUBuffer lightningBuffer,
-  size_t lightningBufferSize,
+  const Application_Lighting lightning[static 1],
   WGPUBuffer uniformBuffer,
   size_t uniformBufferSize,
   Vector3f offset) {
@@ -32,14 +55,15 @@ Mammoth* Mammoth_Create(
       device,
       queue,
       depthFormat,
-      lightningBuffer,
-      lightningBufferSize,
+      lightning,
       uniformBuffer,
       uniformBufferSize,
       offset,
-      RESOURCE_DIR "/lightning/specularity.wgsl",
-      RESOURCE_DIR "/meshes/mammoth.obj",
-      RESOURCE_DIR "/fourareen/fourareen2K_albedo.jpg");
+      MAMMOTH_SHADER,
+      sizeof(Mammoth_defines) / sizeof(*Mammoth_defines),
+      Mammoth_defines,
+      MAMMOTH_MODEL,
+      MAMMOTH_TEXTURE);
   }
   return result;
 }
@@ -5,11 +5,34 @@
 #include <stdlib.h>
 #include "linear/algebra.h"
 #include "../device.h"
+#include "../stats.h"
+#include "../memory.h"
+#include "../limits.h"
 #include "../Model.h"
+#include "../Lightning.h"
+#include "../bundle.h"
 #include "./DepthStencilState.h"
 #include "./BindGroupLayoutEntry.h"
 
+// overrides of the shaders, applied when the pipeline is created
+#define RENDERTARGET_GAMMA (2.2)
+
+// a shader being recompiled, it outlives its target when callbacks are still pending
+typedef struct {
+    WGPUShaderModule shader;
+    WGPURenderPipeline pipeline;
+    size_t errors; // reported by the compilation info and the error scope
+    size_t callbacks;
+    bool abandoned;
+} RenderTarget_Reload;
 typedef struct {
+    const char* shaderPath;
+    size_t defineCount;
+    const Application_preprocessor_Define* defines;
+    Application_preprocessor_Files includes; // the shader was expanded from, to watch
+    WGPUTextureFormat depthFormat;
+    WGPUPipelineLayout layout;
+    RenderTarget_Reload* reload;
     WGPUShaderModule shader;
     struct {
         WGPUSampler sampler;
@@ -35,11 +58,11 @@ static void buffers_attach(
     .mappedAtCreation = false,
     .size = vertexCount * sizeof(Model_Vertex),
   };
-  target->vertex.buffer = wgpuDeviceCreateBuffer(device, &descriptor);
+  target->vertex.buffer =
+    Application_memory_Buffer_create(device, &descriptor, Application_memory_Vertex);
 }
 static void buffers_detach(RenderTarget target[static 1]) {
-  wgpuBufferDestroy(target->vertex.buffer);
-  wgpuBufferRelease(target->vertex.buffer);
+  Application_memory_Buffer_destroy(target->vertex.buffer);
 }
 static void texture_attach(
   RenderTarget target[static 1],
@@ -62,72 +85,160 @@ static void texture_attach(
   target->texture.sampler = wgpuDeviceCreateSampler(device, &samplerDescriptor);
 }
 static void texture_detach(RenderTarget target[static 1]) {
-  wgpuTextureDestroy(target->texture.texture);
-  wgpuTextureRelease(target->texture.texture);
+  Application_memory_Texture_destroy(target->texture.texture);
   wgpuTextureViewRelease(target->texture.view);
   wgpuSamplerRelease(target->texture.sampler);
 }
+// what the pipeline created below and its assets need from the device
+void RenderTarget_require(
+  WGPULimits limits[static 1],
+  size_t lightningBufferSize,
+  size_t uniformBufferSize,
+  const char* const modelPath,
+  const char* const texturePath) {
+  Application_device_Mesh_require(limits, modelPath, sizeof(Model_Vertex));
+  Application_device_Texture_require(limits, texturePath);
+  LIMITS_REQUIRE(limits->maxVertexBuffers, 1u);
+  LIMITS_REQUIRE(limits->maxVertexAttributes, 4u);
+  LIMITS_REQUIRE(limits->maxVertexBufferArrayStride, (uint32_t)sizeof(Model_Vertex));
+  LIMITS_REQUIRE(limits->maxBindGroups, 1u);
+  LIMITS_REQUIRE(limits->maxBindingsPerBindGroup, 6u);
+  LIMITS_REQUIRE(limits->maxUniformBuffersPerShaderStage, 2u);
+  LIMITS_REQUIRE(limits->maxUniformBufferBindingSize, (uint64_t)uniformBufferSize);
+  LIMITS_REQUIRE(limits->maxUniformBufferBindingSize, (uint64_t)lightningBufferSize);
+  LIMITS_REQUIRE(limits->maxSampledTexturesPerShaderStage, 1u);
+  LIMITS_REQUIRE(limits->maxSamplersPerShaderStage, 1u);
+  // color, normal, uv and view direction of the vertex output
+  LIMITS_REQUIRE(limits->maxInterStageShaderComponents, 11u);
+  LIMITS_REQUIRE(limits->maxInterStageShaderVariables, 4u);
+}
+// compiled in the background, the handle stays null until the pipeline is ready
+static void pipeline_request(
+  RenderTarget target[static 1],
+  WGPUDevice device,
+  WGPUShaderModule shader,
+  WGPURenderPipeline pipeline[static 1]) {
+  WGPUBlendState blendState = {
+    .color.srcFactor = WGPUBlendFactor_SrcAlpha,
+    .color.dstFactor = WGPUBlendFactor_OneMinusSrcAlpha,
+    .color.operation = WGPUBlendOperation_Add,
+    .alpha.srcFactor = WGPUBlendFactor_Zero,
+    .alpha.dstFactor = WGPUBlendFactor_One,
+    .alpha.operation = WGPUBlendOperation_Add
+  };
+  WGPUColorTargetState colorTarget = {
+    .nextInChain = 0,
+    .format = WGPUTextureFormat_BGRA8Unorm,
+    .blend = &blendState,
+    .writeMask = WGPUColorWriteMask_All,
+  };
+  WGPUConstantEntry constants[] = {
+    {
+     .nextInChain = 0,
+     .key = "gamma",
+     .value = RENDERTARGET_GAMMA,
+     },
+  };
+  WGPUFragmentState fragmentState = {
+    .nextInChain = 0,
+    .module = shader,
+    .entryPoint = "fs_main",
+    .constantCount = sizeof(constants) / sizeof(*constants),
+    .constants = constants,
+    .targetCount = 1,
+    .targets = &colorTarget,
+  };
+  WGPUDepthStencilState depthStencilState = Application_DepthStencilState_make();
+  depthStencilState.depthCompare = WGPUCompareFunction_Less;
+  depthStencilState.depthWriteEnabled = true;
+  depthStencilState.format = target->depthFormat;
+  depthStencilState.stencilReadMask = 0;
+  depthStencilState.stencilWriteMask = 0;
+  WGPUVertexAttribute vertexAttributes[] = {
+    {
+     // position
+      .shaderLocation = 0,
+     .format = WGPUVertexFormat_Float32x3,
+     .offset = 0,
+     },
+    {
+     // normal
+      .shaderLocation = 1,
+     .format = WGPUVertexFormat_Float32x3,
+     .offset = offsetof(Model_Vertex, normal),
+     },
+    {
+     // color
+      .shaderLocation = 2,
+     .format = WGPUVertexFormat_Float32x3,
+     .offset = offsetof(Model_Vertex, color),
+     },
+    {
+     // uv coordinates
+      .shaderLocation = 3,
+     .format = WGPUVertexFormat_Float32x2,
+     .offset = offsetof(Model_Vertex, uv),
+     }
+  };
+  WGPUVertexBufferLayout bufferLayout = {
+    .attributeCount = 4,
+    .attributes = vertexAttributes,
+    .arrayStride = sizeof(Model_Vertex),
+    .stepMode = WGPUVertexStepMode_Vertex,
+  };
+  WGPURenderPipelineDescriptor pipelineDesc = {
+    .nextInChain = 0,
+    .fragment = &fragmentState,
+    .vertex.bufferCount = 1,
+    .vertex.buffers = &bufferLayout,
+    .vertex.module = shader,
+    .vertex.entryPoint = "vs_main",
+    .vertex.constantCount = 0,
+    .vertex.constants = 0,
+    .primitive.topology = WGPUPrimitiveTopology_TriangleList,
+    .primitive.stripIndexFormat = WGPUIndexFormat_Undefined,
+    .primitive.frontFace = WGPUFrontFace_CCW,
+    .primitive.cullMode = WGPUCullMode_None,
+    .depthStencil = &depthStencilState,
+    .multisample.count = 1,
+    .multisample.mask = ~0u,
+    .multisample.alphaToCoverageEnabled = false,
+    .layout = target->layout,
+  };
+  Application_device_RenderPipeline_request(device, &pipelineDesc, pipeline);
+}
 RenderTarget* RenderTarget_create(
   RenderTarget* result,
   WGPUDevice device,
   WGPUQueue queue,
   WGPUTextureFormat depthFormat,
-  WGPUBuffer lightningBuffer,
-  size_t lightningBufferSize,
+  const Application_Lighting lightning[static 1],
   WGPUBuffer uniformBuffer,
   size_t uniformBufferSize,
   Vector3f offset,
   const char* const shaderPath,
+  size_t defineCount,
+  const Application_preprocessor_Define defines[],
   const char* const modelPath,
   const char* const texturePath) {
   if (result || (result = calloc(1, sizeof(*result)))) {
-    result->shader = Application_device_ShaderModule(device, shaderPath);
-    texture_attach(result, device, texturePath);
-    Model model = Model_load(modelPath, offset);
-    result->vertex.count = model.vertexCount;
-    buffers_attach(result, device, result->vertex.count);
-    wgpuQueueWriteBuffer(
-      queue,
-      result->vertex.buffer,
-      0,
-      model.vertices,
-      result->vertex.count * sizeof(Model_Vertex));
-    Model_unload(&model);
-    // pipeline
-    WGPUBlendState blendState = {
-      .color.srcFactor = WGPUBlendFactor_SrcAlpha,
-      .color.dstFactor = WGPUBlendFactor_OneMinusSrcAlpha,
-      .color.operation = WGPUBlendOperation_Add,
-      .alpha.srcFactor = WGPUBlendFactor_Zero,
-      .alpha.dstFactor = WGPUBlendFactor_One,
-      .alpha.operation = WGPUBlendOperation_Add
-    };
-    WGPUColorTargetState colorTarget = {
-      .nextInChain = 0,
-      .format = WGPUTextureFormat_BGRA8Unorm,
-      .blend = &blendState,
-      .writeMask = WGPUColorWriteMask_All,
-    };
-    WGPUFragmentState fragmentState = {
-      .nextInChain = 0,
-      .module = result->shader,
-      .entryPoint = "fs_main",
-      .constantCount = 0,
-      .constants = 0,
-      .targetCount = 1,
-      .targets = &colorTarget,
-    };
-    WGPUDepthStencilState depthStencilState = Application_DepthStencilState_make();
-    depthStencilState.depthCompare = WGPUCompareFunction_Less;
-    depthStencilState.depthWriteEnabled = true;
-    depthStencilState.format = depthFormat;
-    depthStencilState.stencilReadMask = 0;
-    depthStencilState.stencilWriteMask = 0;
+    result->shaderPath = shaderPath;
+    result->defineCount = defineCount;
+    result->defines = defines;
+    result->depthFormat = depthFormat;
+    result->shader = Application_device_ShaderModule_permutation(
+      device,
+      shaderPath,
+      defineCount,
+      defines,
+      &result->includes);
     WGPUBindGroupLayoutEntry bindingLayouts[] = {
       Application_BindGroupLayoutEntry_make(),
       Application_BindGroupLayoutEntry_make(),
       Application_BindGroupLayoutEntry_make(),
       Application_BindGroupLayoutEntry_make(),
+      Application_BindGroupLayoutEntry_make(),
+      Application_BindGroupLayoutEntry_make(),
     };
     bindingLayouts[0].buffer.type = WGPUBufferBindingType_Uniform;
     bindingLayouts[0].buffer.minBindingSize = uniformBufferSize;
@@ -141,10 +252,16 @@ RenderTarget* RenderTarget_create(
     bindingLayouts[3].binding = 3;
     bindingLayouts[3].visibility = WGPUShaderStage_Fragment;
     bindingLayouts[3].buffer.type = WGPUBufferBindingType_Uniform;
-    bindingLayouts[3].buffer.minBindingSize = lightningBufferSize;
+    bindingLayouts[3].buffer.minBindingSize = sizeof(Application_Lighting_Uniforms);
+    bindingLayouts[4].binding = 4;
+    bindingLayouts[4].visibility = WGPUShaderStage_Fragment;
+    bindingLayouts[4].buffer.type = WGPUBufferBindingType_ReadOnlyStorage;
+    bindingLayouts[5].binding = 5;
+    bindingLayouts[5].visibility = WGPUShaderStage_Fragment;
+    bindingLayouts[5].buffer.type = WGPUBufferBindingType_ReadOnlyStorage;
     WGPUBindGroupLayoutDescriptor bindGroupLayoutDescriptor = {
       .nextInChain = 0,
-      .entryCount = 4,
+      .entryCount = 6,
       .entries = bindingLayouts,
     };
     WGPUBindGroupLayout bindGroupLayout =
@@ -154,59 +271,23 @@ RenderTarget* RenderTarget_create(
       .bindGroupLayoutCount = 1,
       .bindGroupLayouts = &bindGroupLayout,
     };
-    WGPUPipelineLayout layout = wgpuDeviceCreatePipelineLayout(device, &layoutDescriptor);
-    WGPUVertexAttribute vertexAttributes[] = {
-      {
-       // position
-        .shaderLocation = 0,
-       .format = WGPUVertexFormat_Float32x3,
-       .offset = 0,
-       },
-      {
-       // normal
-        .shaderLocation = 1,
-       .format = WGPUVertexFormat_Float32x3,
-       .offset = offsetof(Model_Vertex, normal),
-       },
-      {
-       // color
-        .shaderLocation = 2,
-       .format = WGPUVertexFormat_Float32x3,
-       .offset = offsetof(Model_Vertex, color),
-       },
-      {
-       // uv coordinates
-        .shaderLocation = 3,
-       .format = WGPUVertexFormat_Float32x2,
-       .offset = offsetof(Model_Vertex, uv),
-       }
-    };
-    WGPUVertexBufferLayout bufferLayout = {
-      .attributeCount = 4,
-      .attributes = vertexAttributes,
-      .arrayStride = sizeof(Model_Vertex),
-      .stepMode = WGPUVertexStepMode_Vertex,
-    };
-    WGPURenderPipelineDescriptor pipelineDesc = {
-      .nextInChain = 0,
-      .fragment = &fragmentState,
-      .vertex.bufferCount = 1,
-      .vertex.buffers = &bufferLayout,
-      .vertex.module = result->shader,
-      .vertex.entryPoint = "vs_main",
-      .vertex.constantCount = 0,
-      .vertex.constants = 0,
-      .primitive.topology = WGPUPrimitiveTopology_TriangleList,
-      .primitive.stripIndexFormat = WGPUIndexFormat_Undefined,
-      .primitive.frontFace = WGPUFrontFace_CCW,
-      .primitive.cullMode = WGPUCullMode_None,
-      .depthStencil = &depthStencilState,
-      .multisample.count = 1,
-      .multisample.mask = ~0u,
-      .multisample.alphaToCoverageEnabled = false,
-      .layout = layout,
-    };
-    result->pipeline = wgpuDeviceCreateRenderPipeline(device, &pipelineDesc);
+    result->layout = wgpuDeviceCreatePipelineLayout(device, &layoutDescriptor);
+    // the assets load while the pipeline compiles, drawing is skipped until then
+    pipeline_request(result, device, result->shader, &result->pipeline);
+    texture_attach(result, device, texturePath);
+    Model model = Model_load(modelPath, offset);
+    result->vertex.count = model.vertexCount;
+    buffers_attach(result, device, result->vertex.count);
+    wgpuQueueWriteBuffer(
+      queue,
+      result->vertex.buffer,
+      0,
+      model.vertices,
+      result->vertex.count * sizeof(Model_Vertex));
+    Application_stats_add(
+      Application_stats_UploadBytes,
+      result->vertex.count * sizeof(Model_Vertex));
+    Model_unload(&model);
     // bind group
     WGPUBindGroupEntry bindings[] = {
       {
@@ -229,9 +310,23 @@ RenderTarget* RenderTarget_create(
       {
        .nextInChain = 0,
        .binding = 3,
-       .buffer = lightningBuffer,
+       .buffer = lightning->buffer,
+       .offset = 0,
+       .size = sizeof(Application_Lighting_Uniforms),
+       },
+      {
+       .nextInChain = 0,
+       .binding = 4,
+       .buffer = lightning->pointBuffer,
        .offset = 0,
-       .size = lightningBufferSize,
+       .size = wgpuBufferGetSize(lightning->pointBuffer),
+       },
+      {
+       .nextInChain = 0,
+       .binding = 5,
+       .buffer = lightning->clusterBuffer,
+       .offset = 0,
+       .size = wgpuBufferGetSize(lightning->clusterBuffer),
        }
     };
     WGPUBindGroupDescriptor bindGroupDescriptor = {
@@ -244,24 +339,133 @@ RenderTarget* RenderTarget_create(
   }
   return result;
 }
+static void reload_release(RenderTarget_Reload reload[static 1]) {
+  if (reload->abandoned && !reload->callbacks) {
+    Application_device_Pipeline_cancel(&reload->pipeline);
+    if (reload->pipeline) {
+      wgpuRenderPipelineRelease(reload->pipeline);
+    }
+    if (reload->shader) {
+      wgpuShaderModuleRelease(reload->shader);
+    }
+    free(reload);
+  }
+}
+static void reload_onCompilation(
+  WGPUCompilationInfoRequestStatus status,
+  const WGPUCompilationInfo* info,
+  void* userdata) {
+  RenderTarget_Reload* reload = userdata;
+  reload->errors += status != WGPUCompilationInfoRequestStatus_Success;
+  for (size_t i = 0; info && info->messageCount > i; i++) {
+    reload->errors += info->messages[i].type == WGPUCompilationMessageType_Error;
+  }
+  reload->callbacks--;
+  reload_release(reload);
+}
+static void reload_onError(WGPUErrorType type, const char* message, void* userdata) {
+  RenderTarget_Reload* reload = userdata;
+  if (type != WGPUErrorType_NoError) {
+    fprintf(stderr, "Shader reload error: %s\n", message ? message : "");
+    reload->errors++;
+  }
+  reload->callbacks--;
+  reload_release(reload);
+}
+// recompiles the shader in the background, the current pipeline is kept until the new one
+// is ready and for good when the new shader does not compile
+void RenderTarget_reload(RenderTarget target[static 1], WGPUDevice device) {
+  if (target->reload) {
+    target->reload->abandoned = true;
+    reload_release(target->reload);
+  }
+  RenderTarget_Reload* reload = target->reload = calloc(1, sizeof(*reload));
+  if (!reload) {
+    perror("Shader reload allocation failed");
+    return;
+  }
+  // invalid WGSL is a validation error, uncaptured it would abort
+  wgpuDevicePushErrorScope(device, WGPUErrorFilter_Validation);
+  // the includes may have changed with the edit, the old ones are kept when the shader
+  // could not be read
+  Application_preprocessor_Files includes = { 0 };
+  reload->shader = Application_device_ShaderModule_permutation(
+    device,
+    target->shaderPath,
+    target->defineCount,
+    target->defines,
+    &includes);
+  if (includes.count) {
+    Application_preprocessor_Files_free(&target->includes);
+    target->includes = includes;
+  }
+  if (reload->shader) {
+    reload->callbacks++;
+    wgpuShaderModuleGetCompilationInfo(reload->shader, reload_onCompilation, reload);
+    pipeline_request(target, device, reload->shader, &reload->pipeline);
+  }
+  else {
+    reload->errors++;
+  }
+  reload->callbacks++;
+  wgpuDevicePopErrorScope(device, reload_onError, reload);
+}
+// swaps a completed reload in, to be called between frames
+void RenderTarget_update(RenderTarget target[static 1]) {
+  RenderTarget_Reload* reload = target->reload;
+  if (reload && !reload->callbacks
+      && !Application_device_Pipeline_pending(&reload->pipeline)) {
+    if (!reload->errors && reload->pipeline) {
+      if (target->pipeline) {
+        wgpuRenderPipelineRelease(target->pipeline);
+      }
+      wgpuShaderModuleRelease(target->shader);
+      target->pipeline = reload->pipeline;
+      target->shader = reload->shader;
+      free(reload);
+      printf("Reloaded %s.\n", target->shaderPath);
+    }
+    else {
+      printf("%s does not compile, the previous pipeline is kept.\n", target->shaderPath);
+      reload->abandoned = true;
+      reload_release(reload);
+    }
+    target->reload = 0;
+  }
+}
 void RenderTarget_destroy(RenderTarget* target) {
+  if (target->reload) {
+    target->reload->abandoned = true;
+    reload_release(target->reload);
+  }
+  wgpuPipelineLayoutRelease(target->layout);
   buffers_detach(target);
   texture_detach(target);
   wgpuBindGroupRelease(target->bindGroup);
-  wgpuRenderPipelineRelease(target->pipeline);
+  Application_device_Pipeline_cancel(&target->pipeline);
+  if (target->pipeline) {
+    wgpuRenderPipelineRelease(target->pipeline);
+  }
   wgpuShaderModuleRelease(target->shader);
+  Application_preprocessor_Files_free(&target->includes);
   free(target);
 }
-void RenderTarget_render(RenderTarget target[static 1], WGPURenderPassEncoder renderPass) {
-  wgpuRenderPassEncoderSetPipeline(renderPass, target->pipeline);
-  wgpuRenderPassEncoderSetVertexBuffer(
-    renderPass,
-    0,
-    target->vertex.buffer,
-    0,
-    target->vertex.count * sizeof(Model_Vertex));
-  wgpuRenderPassEncoderSetBindGroup(renderPass, 0, target->bindGroup, 0, 0);
-  wgpuRenderPassEncoderDraw(renderPass, target->vertex.count, 1, 0, 0);
+// the draw of the target, none while its pipeline is compiling
+bool RenderTarget_draw(
+  RenderTarget target[static 1],
+  Application_bundle_Draw draw[static 1]) {
+  if (!target->pipeline) {
+    return false;
+  }
+  *draw = (Application_bundle_Draw){
+    .pipeline = target->pipeline,
+    .bindGroup = target->bindGroup,
+    .vertexBuffer = target->vertex.buffer,
+    .vertexSize = target->vertex.count * sizeof(Model_Vertex),
+    .vertexCount = (uint32_t)target->vertex.count,
+    .instanceCount = 1,
+  };
+  return true;
 }
 
 #endif // RenderTarget_H_
@@ -0,0 +1,132 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <time.h>
+#include "linear/algebra.h"
+#include "cluster.h"
+#include "jobs.h"
+
+#define BENCHMARK_ITERATIONS (100)
+#define BENCHMARK_SPAWNERS   (64)
+#define BENCHMARK_CHILDREN   (1024)
+
+// point lights in front of the camera, binned on more and more threads
+static float uniform(uint32_t state[static 1]) {
+  *state = *state * 1664525u + 1013904223u;
+  return (float)(*state >> 8) / (float)(1u << 24);
+}
+static double now() {
+  struct timespec time = { 0 };
+  clock_gettime(CLOCK_MONOTONIC, &time);
+  return (double)time.tv_sec * 1e3 + (double)time.tv_nsec / 1e6;
+}
+// the jobs are submitted by other jobs as a renderer would, so that the workers steal
+typedef struct {
+    Application_jobs* jobs;
+    Application_jobs_Function child;
+    Application_jobs_Counter* counter;
+} Spawner;
+static void empty(void* /* context */) {}
+static void small(void* /* context */) {
+  for (volatile size_t i = 0; 64 > i; i++) {}
+}
+static void spawn(void* context) {
+  const Spawner* spawner = context;
+  for (size_t i = 0; BENCHMARK_CHILDREN > i; i++) {
+    Application_jobs_submit(spawner->jobs, spawner->child, 0, 0, spawner->counter);
+  }
+}
+static void jobs() {
+  const size_t threads[] = { 1, 2, 4, 8, 16, 32, 64 };
+  const struct {
+      const char* name;
+      Application_jobs_Function function;
+  } workloads[] = {
+    {"empty", empty},
+    {"small", small},
+  };
+  printf("threads, jobs, jobs per millisecond, stolen, overflowed\n");
+  for (size_t i = 0; sizeof(threads) / sizeof(*threads) > i; i++) {
+    Application_jobs* jobs = Application_jobs_create(threads[i]);
+    for (size_t j = 0; jobs && sizeof(workloads) / sizeof(*workloads) > j; j++) {
+      const Application_jobs_Stats before = Application_jobs_stats(jobs);
+      double milliseconds = 0;
+      for (size_t k = 0; 10 > k; k++) {
+        Application_jobs_Counter counter = { 0 };
+        Spawner spawner = {
+          .jobs = jobs,
+          .child = workloads[j].function,
+          .counter = &counter,
+        };
+        const double begin = now();
+        for (size_t n = 0; BENCHMARK_SPAWNERS > n; n++) {
+          Application_jobs_submit(jobs, spawn, &spawner, 0, &counter);
+        }
+        Application_jobs_wait(jobs, &counter);
+        milliseconds += now() - begin;
+      }
+      const Application_jobs_Stats stats = Application_jobs_stats(jobs);
+      const uint64_t executed = stats.executed - before.executed;
+      printf(
+        "%zu, %s, %.0f, %.3f, %.3f\n",
+        stats.threads,
+        workloads[j].name,
+        (double)executed / milliseconds,
+        (double)(stats.stolen - before.stolen) / (double)executed,
+        (double)(stats.overflowed - before.overflowed) / (double)executed);
+    }
+    Application_jobs_destroy(jobs);
+  }
+}
+int main() {
+  const size_t counts[] = { 2, 16, 128, 1024, 4096, 10000 };
+  const size_t threads[] = { 1, 2, 4, 8, 0 };
+  const size_t largest = counts[sizeof(counts) / sizeof(*counts) - 1];
+  Application_cluster_Light* lights = malloc(largest * sizeof(*lights));
+  if (!lights) {
+    perror("Benchmark allocation failed");
+    return EXIT_FAILURE;
+  }
+  uint32_t state = 1;
+  for (size_t i = 0; largest > i; i++) {
+    lights[i] = (Application_cluster_Light){
+      .position = Vector3f_make(
+        -10.0f + 20.0f * uniform(&state),
+        -10.0f + 20.0f * uniform(&state),
+        -1.0f - 40.0f * uniform(&state)),
+      .radius = 0.5f + uniform(&state),
+      .color = Vector3f_fill(1.0f),
+      .intensity = 1.0f,
+    };
+  }
+  const Matrix4f view = Matrix4f_diagonal(1.0f);
+  const Matrix4f projection = Matrix4f_perspective(45, 16.0f / 9.0f, 0.01f, 100.0f);
+  printf("lights, threads, milliseconds per binning, references, dropped\n");
+  for (size_t i = 0; sizeof(threads) / sizeof(*threads) > i; i++) {
+    // one task per thread of the job system
+    Application_jobs* jobs = Application_jobs_create(threads[i]);
+    Application_cluster* cluster = jobs ? Application_cluster_create(jobs, 0) : 0;
+    for (size_t j = 0; cluster && sizeof(counts) / sizeof(*counts) > j; j++) {
+      double milliseconds = 0;
+      size_t size = 0;
+      for (size_t k = 0; BENCHMARK_ITERATIONS > k; k++) {
+        Application_cluster_bin(cluster, counts[j], lights, view, projection, &size);
+        milliseconds += Application_cluster_stats(cluster).milliseconds;
+      }
+      const Application_cluster_Stats stats = Application_cluster_stats(cluster);
+      printf(
+        "%zu, %zu, %.3f, %zu, %zu\n",
+        counts[j],
+        stats.threads,
+        milliseconds / BENCHMARK_ITERATIONS,
+        stats.references,
+        stats.dropped);
+    }
+    Application_cluster_destroy(cluster);
+    Application_jobs_destroy(jobs);
+  }
+  free(lights);
+  jobs();
+  return EXIT_SUCCESS;
+}
+// gcc-13 -std=gnu2x -O2 -I ../library benchmarks.c cluster.c jobs.c ../library/linear/*.c -lm
@@ -0,0 +1,201 @@
+#include "bundle.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "stats.h"
+#include "trace.h"
+
+// what a slice adds to the frame counters each time it is executed
+typedef struct {
+    uint64_t pipelines;
+    uint64_t bindGroups;
+    uint64_t triangles;
+} Counts;
+typedef struct {
+    Application_bundle* bundle;
+    size_t index;
+} Slice;
+struct Application_bundle {
+    WGPUDevice device;
+    WGPUTextureFormat colorFormat;
+    WGPURenderBundleEncoderDescriptor descriptor;
+    Application_jobs* jobs; // null when the slices are recorded on the calling thread
+    Slice tasks[BUNDLE_SLICES];
+    Application_bundle_Draw* draws;
+    size_t count;
+    size_t capacity;
+    WGPURenderBundle bundles[BUNDLE_SLICES];
+    Counts counts[BUNDLE_SLICES];
+    size_t slices;
+    bool valid;
+    Application_bundle_Stats stats;
+};
+
+static double now() {
+  struct timespec time = { 0 };
+  clock_gettime(CLOCK_MONOTONIC, &time);
+  return (double)time.tv_sec * 1e3 + (double)time.tv_nsec / 1e6;
+}
+Application_bundle* Application_bundle_create(
+  WGPUDevice device,
+  Application_jobs* jobs,
+  size_t workers,
+  WGPUTextureFormat colorFormat,
+  WGPUTextureFormat depthFormat) {
+  Application_bundle* result = calloc(1, sizeof(*result));
+  if (!result) {
+    perror("Bundle allocation failed");
+    return 0;
+  }
+  result->device = device;
+  result->colorFormat = colorFormat;
+  result->descriptor = (WGPURenderBundleEncoderDescriptor){
+    .nextInChain = 0,
+    .label = "draw slice",
+    .colorFormatCount = 1,
+    .colorFormats = &result->colorFormat,
+    .depthStencilFormat = depthFormat,
+    .sampleCount = 1,
+    .depthReadOnly = false,
+    .stencilReadOnly = true, // as the passes of RenderPass.h
+  };
+  // without the device lock the encoders of other threads would race on the device
+  workers = workers ? workers : jobs ? Application_jobs_stats(jobs).threads : 1;
+  if (1 < workers
+      && wgpuDeviceHasFeature(device, WGPUFeatureName_ImplicitDeviceSynchronization)) {
+    result->jobs = jobs;
+  }
+  result->stats.workers = result->jobs ? workers : 1;
+  for (size_t i = 0; BUNDLE_SLICES > i; i++) {
+    result->tasks[i] = (Slice){ .bundle = result, .index = i };
+  }
+  return result;
+}
+static void bundles_release(Application_bundle bundle[static 1]) {
+  for (size_t i = 0; bundle->slices > i; i++) {
+    wgpuRenderBundleRelease(bundle->bundles[i]);
+    bundle->bundles[i] = 0;
+  }
+  bundle->slices = 0;
+  bundle->valid = false;
+}
+void Application_bundle_destroy(Application_bundle* bundle) {
+  if (bundle) {
+    bundles_release(bundle);
+    free(bundle->draws);
+    free(bundle);
+  }
+}
+// the bindings are only set when they change within the slice, a bundle starts with
+// none of them set
+static void slice_record(Application_bundle bundle[static 1], size_t slice) {
+  TRACE_SCOPE("record slice");
+  const size_t begin = bundle->count * slice / bundle->slices;
+  const size_t end = bundle->count * (slice + 1) / bundle->slices;
+  WGPURenderBundleEncoder encoder =
+    wgpuDeviceCreateRenderBundleEncoder(bundle->device, &bundle->descriptor);
+  Counts counts = { 0 };
+  WGPURenderPipeline pipeline = 0;
+  WGPUBindGroup bindGroup = 0;
+  WGPUBuffer vertexBuffer = 0;
+  uint64_t vertexSize = 0;
+  for (size_t i = begin; end > i; i++) {
+    const Application_bundle_Draw* draw = &bundle->draws[i];
+    if (draw->pipeline != pipeline) {
+      wgpuRenderBundleEncoderSetPipeline(encoder, pipeline = draw->pipeline);
+      counts.pipelines++;
+    }
+    if (draw->bindGroup != bindGroup) {
+      wgpuRenderBundleEncoderSetBindGroup(encoder, 0, bindGroup = draw->bindGroup, 0, 0);
+      counts.bindGroups++;
+    }
+    if (draw->vertexBuffer != vertexBuffer || draw->vertexSize != vertexSize) {
+      vertexBuffer = draw->vertexBuffer;
+      vertexSize = draw->vertexSize;
+      wgpuRenderBundleEncoderSetVertexBuffer(encoder, 0, vertexBuffer, 0, vertexSize);
+    }
+    wgpuRenderBundleEncoderDraw(encoder, draw->vertexCount, draw->instanceCount, 0, 0);
+    counts.triangles += (uint64_t)draw->vertexCount / 3 * draw->instanceCount;
+  }
+  const WGPURenderBundleDescriptor descriptor = { .nextInChain = 0, .label = "draws" };
+  bundle->bundles[slice] = wgpuRenderBundleEncoderFinish(encoder, &descriptor);
+  bundle->counts[slice] = counts;
+  wgpuRenderBundleEncoderRelease(encoder);
+}
+static void slice_run(void* context) {
+  Slice* slice = context;
+  slice_record(slice->bundle, slice->index);
+}
+void Application_bundle_encode(
+  Application_bundle* bundle,
+  size_t count,
+  const Application_bundle_Draw draws[count]) {
+  const double begin = now();
+  const size_t size = count * sizeof(*draws);
+  bundle->stats.reused = bundle->valid && count == bundle->count
+                         && (!count || !memcmp(draws, bundle->draws, size));
+  if (!bundle->stats.reused) {
+    bundles_release(bundle);
+    if (count > bundle->capacity) {
+      Application_bundle_Draw* grown = realloc(bundle->draws, size);
+      if (!grown) {
+        perror("Bundle allocation failed");
+        bundle->count = 0;
+        return;
+      }
+      bundle->draws = grown;
+      bundle->capacity = count;
+    }
+    if (count) {
+      memcpy(bundle->draws, draws, size);
+    }
+    bundle->count = count;
+    // one slice a worker, fewer when they would be short
+    const size_t workers = bundle->stats.workers;
+    size_t slices = (count + BUNDLE_GRAIN - 1) / BUNDLE_GRAIN;
+    slices = slices > workers ? workers : slices;
+    bundle->slices = slices > BUNDLE_SLICES ? BUNDLE_SLICES : slices;
+    // the calling thread records the last slice and runs the others while it waits
+    if (bundle->slices) {
+      Application_jobs_Counter done = { 0 };
+      for (size_t i = 0; bundle->slices - 1 > i; i++) {
+        if (bundle->jobs) {
+          Application_jobs_submit(bundle->jobs, slice_run, &bundle->tasks[i], 0, &done);
+        }
+        else {
+          slice_run(&bundle->tasks[i]);
+        }
+      }
+      slice_run(&bundle->tasks[bundle->slices - 1]);
+      if (bundle->jobs) {
+        Application_jobs_wait(bundle->jobs, &done);
+      }
+    }
+    bundle->valid = true;
+  }
+  bundle->stats.draws = count;
+  bundle->stats.slices = bundle->slices;
+  bundle->stats.milliseconds = now() - begin;
+}
+void Application_bundle_invalidate(Application_bundle* bundle) {
+  bundle->valid = false;
+}
+void Application_bundle_execute(
+  Application_bundle* bundle,
+  WGPURenderPassEncoder renderPass) {
+  if (!bundle->slices) {
+    return;
+  }
+  wgpuRenderPassEncoderExecuteBundles(renderPass, bundle->slices, bundle->bundles);
+  Application_stats_add(Application_stats_DrawCalls, bundle->count);
+  for (size_t i = 0; bundle->slices > i; i++) {
+    const Counts counts = bundle->counts[i];
+    Application_stats_add(Application_stats_PipelineSwitches, counts.pipelines);
+    Application_stats_add(Application_stats_BindGroupSwitches, counts.bindGroups);
+    Application_stats_add(Application_stats_Triangles, counts.triangles);
+  }
+}
+Application_bundle_Stats Application_bundle_stats(const Application_bundle* bundle) {
+  return bundle->stats;
+}
@@ -0,0 +1,58 @@
+#ifndef bundle_H_
+#define bundle_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "webgpu.h"
+#include "jobs.h"
+
+// Parallel encoding of the draws of a render pass: the draw list is cut in contiguous
+// slices, each slice is recorded into its own render bundle by a job and the pass
+// executes the bundles in the order of the slices. Jobs only call into the device when
+// it was created with implicit synchronization, otherwise every slice is recorded on the
+// calling thread. The bundles are replayed as long as the draw list is the same.
+#define BUNDLE_SLICES (64)
+#define BUNDLE_GRAIN  (256) // draws a slice at least, a bundle has a fixed cost
+
+typedef struct {
+    WGPURenderPipeline pipeline;
+    WGPUBindGroup bindGroup;
+    WGPUBuffer vertexBuffer;
+    uint64_t vertexSize; // bound from the start of the buffer
+    uint32_t vertexCount;
+    uint32_t instanceCount;
+} Application_bundle_Draw;
+typedef struct {
+    size_t draws; // in the last encoding
+    size_t slices;
+    size_t workers;
+    bool reused; // the last call kept the bundles of the one before
+    double milliseconds; // spent in the last call
+} Application_bundle_Stats;
+
+typedef struct Application_bundle Application_bundle;
+
+// the formats of the attachments of the passes the bundles are executed in, zero workers
+// takes the threads of the job system and a null one records on the calling thread,
+// which must be the main thread of the job system
+Application_bundle* Application_bundle_create(
+  WGPUDevice device,
+  Application_jobs* jobs,
+  size_t workers,
+  WGPUTextureFormat colorFormat,
+  WGPUTextureFormat depthFormat);
+void Application_bundle_destroy(Application_bundle* bundle);
+// records the draws in order, the list is copied
+void Application_bundle_encode(
+  Application_bundle* bundle,
+  size_t count,
+  const Application_bundle_Draw draws[count]);
+// the next encoding records again even when the draws are the same
+void Application_bundle_invalidate(Application_bundle* bundle);
+void Application_bundle_execute(
+  Application_bundle* bundle,
+  WGPURenderPassEncoder renderPass);
+Application_bundle_Stats Application_bundle_stats(const Application_bundle* bundle);
+
+#endif // bundle_H_
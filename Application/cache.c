@@ -0,0 +1,275 @@
+#include "cache.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <threads.h>
+#include <dirent.h>
+#include <utime.h>
+#include <sys/stat.h>
+#include "webgpu.h"
+
+#define CACHE_PATH_SIZE (4096)
+
+typedef struct {
+    uint64_t hash;
+    uint64_t size; // of the file, key included
+    uint64_t used; // recency stamp, the smallest is evicted first
+} Entry;
+struct Application_cache {
+    char directory[CACHE_PATH_SIZE - 32]; // room for the file names
+    uint64_t limit;
+    mtx_t lock;
+    Entry* entries;
+    size_t capacity;
+    uint64_t clock;
+    Application_cache_Stats stats;
+};
+
+// FNV-1a, only used to name the files, the key itself is stored and compared on load
+static uint64_t hash(const void* data, size_t size) {
+  const uint8_t* bytes = data;
+  uint64_t result = 0xcbf29ce484222325;
+  for (size_t i = 0; size > i; i++) {
+    result = (result ^ bytes[i]) * 0x100000001b3;
+  }
+  return result;
+}
+static void entryPath(
+  const Application_cache* cache,
+  uint64_t key,
+  char path[static CACHE_PATH_SIZE]) {
+  snprintf(
+    path,
+    CACHE_PATH_SIZE,
+    "%s/%016llx.blob",
+    cache->directory,
+    (unsigned long long)key);
+}
+static Entry* entryFind(Application_cache* cache, uint64_t key) {
+  Entry* result = 0;
+  for (size_t i = 0; !result && cache->stats.entries > i; i++) {
+    if (cache->entries[i].hash == key) {
+      result = &cache->entries[i];
+    }
+  }
+  return result;
+}
+static Entry* entryAdd(Application_cache* cache, uint64_t key) {
+  Entry* result = 0;
+  if (cache->stats.entries == cache->capacity) {
+    const size_t capacity = cache->capacity ? 2 * cache->capacity : 64;
+    Entry* entries = realloc(cache->entries, capacity * sizeof(*entries));
+    if (entries) {
+      cache->entries = entries;
+      cache->capacity = capacity;
+    }
+  }
+  if (cache->capacity > cache->stats.entries) {
+    result = &cache->entries[cache->stats.entries++];
+    *result = (Entry){ .hash = key };
+  }
+  return result;
+}
+static void entryRemove(Application_cache* cache, Entry entry[static 1]) {
+  char path[CACHE_PATH_SIZE];
+  entryPath(cache, entry->hash, path);
+  remove(path);
+  cache->stats.bytes -= entry->size;
+  *entry = cache->entries[--cache->stats.entries];
+}
+static void evict(Application_cache* cache) {
+  while (cache->stats.bytes > cache->limit && cache->stats.entries) {
+    Entry* oldest = &cache->entries[0];
+    for (size_t i = 1; cache->stats.entries > i; i++) {
+      oldest = cache->entries[i].used < oldest->used ? &cache->entries[i] : oldest;
+    }
+    entryRemove(cache, oldest);
+    cache->stats.evictions++;
+  }
+}
+static int byModification(const void* a, const void* b) {
+  const Entry* left = a;
+  const Entry* right = b;
+  return (left->used > right->used) - (left->used < right->used);
+}
+// the recency of the previous runs is recovered from the modification times
+static void scan(Application_cache* cache) {
+  DIR* directory = opendir(cache->directory);
+  if (!directory) {
+    return;
+  }
+  struct dirent* file = 0;
+  while ((file = readdir(directory))) {
+    unsigned long long key = 0;
+    char extension[8] = { 0 };
+    if (sscanf(file->d_name, "%16llx%7s", &key, extension) != 2
+        || strcmp(extension, ".blob")) {
+      continue;
+    }
+    char path[CACHE_PATH_SIZE];
+    struct stat status = { 0 };
+    entryPath(cache, key, path);
+    Entry* entry = 0;
+    if (!stat(path, &status) && (entry = entryAdd(cache, key))) {
+      entry->size = status.st_size;
+      entry->used = (uint64_t)status.st_mtim.tv_sec * 1000000000 + status.st_mtim.tv_nsec;
+      cache->stats.bytes += entry->size;
+    }
+  }
+  closedir(directory);
+  // the entries are still null in an empty directory
+  if (cache->stats.entries) {
+    qsort(cache->entries, cache->stats.entries, sizeof(*cache->entries), byModification);
+  }
+  for (size_t i = 0; cache->stats.entries > i; i++) {
+    cache->entries[i].used = ++cache->clock;
+  }
+}
+Application_cache* Application_cache_create(const char* directory, uint64_t limit) {
+  Application_cache* result = calloc(1, sizeof(*result));
+  if (!result) {
+    perror("Cache allocation failed");
+  }
+  else if (mkdir(directory, 0755) && errno != EEXIST) {
+    fprintf(stderr, "Could not create the cache %s: %s\n", directory, strerror(errno));
+    free(result);
+    result = 0;
+  }
+  else {
+    snprintf(result->directory, sizeof(result->directory), "%s", directory);
+    result->limit = limit;
+    mtx_init(&result->lock, mtx_plain);
+    scan(result);
+    evict(result);
+  }
+  return result;
+}
+void Application_cache_destroy(Application_cache* cache) {
+  if (cache) {
+    mtx_destroy(&cache->lock);
+    free(cache->entries);
+    free(cache);
+  }
+}
+// called twice by Dawn, first without a value to query the size, then to copy it
+static size_t load(
+  const void* key,
+  size_t keySize,
+  void* value,
+  size_t valueSize,
+  void* userdata) {
+  Application_cache* cache = userdata;
+  size_t result = 0;
+  const uint64_t name = hash(key, keySize);
+  mtx_lock(&cache->lock);
+  Entry* entry = entryFind(cache, name);
+  char path[CACHE_PATH_SIZE];
+  entryPath(cache, name, path);
+  FILE* input = entry ? fopen(path, "rb") : 0;
+  uint64_t storedKeySize = 0;
+  if (input && fread(&storedKeySize, sizeof(storedKeySize), 1, input) == 1
+      && storedKeySize == keySize && entry->size >= sizeof(storedKeySize) + keySize) {
+    void* storedKey = malloc(keySize);
+    if (storedKey && fread(storedKey, 1, keySize, input) == keySize
+        && !memcmp(storedKey, key, keySize)) {
+      result = entry->size - sizeof(storedKeySize) - keySize;
+      if (value) {
+        result = valueSize >= result && fread(value, 1, result, input) == result ? result
+                                                                                 : 0;
+      }
+    }
+    free(storedKey);
+  }
+  if (input) {
+    fclose(input);
+  }
+  if (result && value) {
+    entry->used = ++cache->clock;
+    utime(path, 0);
+    cache->stats.hits++;
+  }
+  else if (!result) {
+    cache->stats.misses++;
+  }
+  mtx_unlock(&cache->lock);
+  return result;
+}
+static void store(
+  const void* key,
+  size_t keySize,
+  const void* value,
+  size_t valueSize,
+  void* userdata) {
+  Application_cache* cache = userdata;
+  const uint64_t name = hash(key, keySize);
+  const uint64_t storedKeySize = keySize;
+  char path[CACHE_PATH_SIZE];
+  char temporary[CACHE_PATH_SIZE + 4];
+  mtx_lock(&cache->lock);
+  entryPath(cache, name, path);
+  snprintf(temporary, sizeof(temporary), "%s.tmp", path);
+  // written aside and renamed so an interrupted run never leaves a truncated blob
+  FILE* output = fopen(temporary, "wb");
+  bool written = output && fwrite(&storedKeySize, sizeof(storedKeySize), 1, output) == 1
+                 && fwrite(key, 1, keySize, output) == keySize
+                 && fwrite(value, 1, valueSize, output) == valueSize;
+  if (output) {
+    written = !fclose(output) && written;
+  }
+  if (written && !rename(temporary, path)) {
+    Entry* entry = entryFind(cache, name);
+    if (entry) {
+      cache->stats.bytes -= entry->size;
+    }
+    else {
+      entry = entryAdd(cache, name);
+    }
+    if (entry) {
+      entry->size = sizeof(storedKeySize) + keySize + valueSize;
+      entry->used = ++cache->clock;
+      cache->stats.bytes += entry->size;
+    }
+    cache->stats.stores++;
+    evict(cache);
+  }
+  else {
+    fprintf(stderr, "Could not write the cache entry %s: %s\n", path, strerror(errno));
+    remove(temporary);
+  }
+  mtx_unlock(&cache->lock);
+}
+WGPUDawnCacheDeviceDescriptor Application_cache_descriptor(
+  Application_cache* cache,
+  const char* isolationKey) {
+  return (WGPUDawnCacheDeviceDescriptor){
+    .chain.next = 0,
+    .chain.sType = WGPUSType_DawnCacheDeviceDescriptor,
+    .isolationKey = isolationKey,
+    .loadDataFunction = load,
+    .storeDataFunction = store,
+    .functionUserdata = cache,
+  };
+}
+Application_cache_Stats Application_cache_stats(Application_cache* cache) {
+  mtx_lock(&cache->lock);
+  const Application_cache_Stats result = cache->stats;
+  mtx_unlock(&cache->lock);
+  return result;
+}
+void Application_cache_report(Application_cache* cache, FILE* output) {
+  const Application_cache_Stats stats = Application_cache_stats(cache);
+  fprintf(
+    output,
+    "Pipeline cache %s: %zu hits, %zu misses, %zu stores, %zu evictions, "
+    "%zu entries, %.2f of %.2f MiB\n",
+    cache->directory,
+    stats.hits,
+    stats.misses,
+    stats.stores,
+    stats.evictions,
+    stats.entries,
+    (double)stats.bytes / (1024.0 * 1024.0),
+    (double)cache->limit / (1024.0 * 1024.0));
+}
@@ -0,0 +1,31 @@
+#ifndef cache_H_
+#define cache_H_
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stddef.h>
+#include "webgpu.h"
+
+// On disk store for Dawn's blob cache. Dawn keys the blobs by the shader source and the
+// pipeline descriptor, every blob is a file named after the hash of its key. Files are
+// touched on every hit and the least recently used are evicted above the size limit.
+typedef struct Application_cache Application_cache;
+typedef struct {
+    size_t hits;
+    size_t misses;
+    size_t stores;
+    size_t evictions;
+    size_t entries;
+    uint64_t bytes;
+} Application_cache_Stats;
+
+Application_cache* Application_cache_create(const char* directory, uint64_t limit);
+void Application_cache_destroy(Application_cache* cache);
+// to be chained into the device descriptor, the cache has to outlive the device
+WGPUDawnCacheDeviceDescriptor Application_cache_descriptor(
+  Application_cache* cache,
+  const char* isolationKey);
+Application_cache_Stats Application_cache_stats(Application_cache* cache);
+void Application_cache_report(Application_cache* cache, FILE* output);
+
+#endif // cache_H_
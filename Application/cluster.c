@@ -0,0 +1,236 @@
+#include "cluster.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <string.h>
+#include <tgmath.h>
+#include <time.h>
+
+// more threads than depth slices would have nothing to do in the second pass
+#define CLUSTER_THREADS (CLUSTER_Z)
+
+// the clusters touched by a light, inclusive, empty when first > last in depth
+typedef struct {
+    uint16_t first[3];
+    uint16_t last[3];
+} Bounds;
+typedef struct {
+    Application_cluster* cluster;
+    const Application_cluster_Light* lights;
+    size_t count;
+    Matrix4f view;
+    float scale[2];
+    float near;
+    float far;
+    // lights in the first pass and depth slices in the second
+    size_t begin;
+    size_t end;
+    size_t dropped;
+} Task;
+struct Application_cluster {
+    Application_jobs* jobs;
+    size_t threads;
+    Task tasks[CLUSTER_THREADS];
+    Bounds* bounds;
+    size_t capacity;
+    uint32_t counts[CLUSTER_COUNT];
+    uint32_t* slots; // CLUSTER_LIGHTS per cluster
+    uint32_t* grid;
+    Application_cluster_Stats stats;
+};
+
+static double now() {
+  struct timespec time = { 0 };
+  clock_gettime(CLOCK_MONOTONIC, &time);
+  return (double)time.tv_sec * 1e3 + (double)time.tv_nsec / 1e6;
+}
+Application_cluster* Application_cluster_create(Application_jobs* jobs, size_t threads) {
+  Application_cluster* result = calloc(1, sizeof(*result));
+  if (result) {
+    threads = threads ? threads : jobs ? Application_jobs_stats(jobs).threads : 1;
+    result->jobs = jobs;
+    result->threads = threads > CLUSTER_THREADS ? CLUSTER_THREADS : threads;
+    result->slots = malloc(CLUSTER_COUNT * CLUSTER_LIGHTS * sizeof(*result->slots));
+    result->grid = malloc(CLUSTER_WORDS * sizeof(*result->grid));
+    result->stats.threads = result->threads;
+  }
+  if (!result || !result->slots || !result->grid) {
+    perror("Cluster allocation failed");
+    Application_cluster_destroy(result);
+    result = 0;
+  }
+  return result;
+}
+void Application_cluster_destroy(Application_cluster* cluster) {
+  if (cluster) {
+    free(cluster->bounds);
+    free(cluster->slots);
+    free(cluster->grid);
+    free(cluster);
+  }
+}
+static uint16_t clamp(float value, uint16_t count) {
+  return value < 0 ? 0 : value >= count ? count - 1 : (uint16_t)value;
+}
+// the slices are exponential in depth so that clusters stay roughly cubic
+static uint16_t slice(const Task task[static 1], float depth) {
+  const float position = log(depth / task->near) / log(task->far / task->near);
+  return clamp(position * CLUSTER_Z, CLUSTER_Z);
+}
+// the view space box around the light projected on the screen, its corners bound the
+// projection since x / depth is monotonic in both
+static void bounds_run(void* argument) {
+  Task* task = argument;
+  const float* v = task->view.elements;
+  for (size_t i = task->begin; task->end > i; i++) {
+    const Application_cluster_Light* light = &task->lights[i];
+    const float* p = light->position.components;
+    const float r = light->radius;
+    const float x = v[0] * p[0] + v[1] * p[1] + v[2] * p[2] + v[3];
+    const float y = v[4] * p[0] + v[5] * p[1] + v[6] * p[2] + v[7];
+    const float depth = -(v[8] * p[0] + v[9] * p[1] + v[10] * p[2] + v[11]);
+    Bounds* bounds = &task->cluster->bounds[i];
+    *bounds = (Bounds){ .first = { 0, 0, 1 }, .last = { 0, 0, 0 } };
+    const float near = fmax(depth - r, task->near);
+    const float far = fmin(depth + r, task->far);
+    if (near > far) {
+      continue;
+    }
+    float low[2] = { INFINITY, INFINITY };
+    float high[2] = { -INFINITY, -INFINITY };
+    const float center[2] = { x, y };
+    for (size_t axis = 0; 2 > axis; axis++) {
+      for (size_t corner = 0; 4 > corner; corner++) {
+        const float offset = corner & 1 ? r : -r;
+        const float z = corner & 2 ? far : near;
+        const float projected = task->scale[axis] * (center[axis] + offset) / z;
+        low[axis] = fmin(low[axis], projected);
+        high[axis] = fmax(high[axis], projected);
+      }
+    }
+    if (high[0] < -1 || low[0] > 1 || high[1] < -1 || low[1] > 1) {
+      continue;
+    }
+    // the rows of the framebuffer go down while y goes up
+    *bounds = (Bounds){
+      .first = {
+        clamp((low[0] + 1) / 2 * CLUSTER_X, CLUSTER_X),
+        clamp((1 - high[1]) / 2 * CLUSTER_Y, CLUSTER_Y),
+        slice(task, near),
+        },
+      .last = {
+        clamp((high[0] + 1) / 2 * CLUSTER_X, CLUSTER_X),
+        clamp((1 - low[1]) / 2 * CLUSTER_Y, CLUSTER_Y),
+        slice(task, far),
+        },
+    };
+  }
+}
+// each thread owns a range of depth slices, so no two write the same cluster
+static void slices_run(void* argument) {
+  Task* task = argument;
+  Application_cluster* cluster = task->cluster;
+  task->dropped = 0;
+  for (size_t i = 0; task->count > i; i++) {
+    const Bounds* bounds = &cluster->bounds[i];
+    const size_t first = bounds->first[2] > task->begin ? bounds->first[2] : task->begin;
+    const size_t end = (size_t)bounds->last[2] + 1;
+    const size_t last = end < task->end ? end : task->end;
+    for (size_t z = first; last > z; z++) {
+      for (size_t y = bounds->first[1]; bounds->last[1] >= y; y++) {
+        for (size_t x = bounds->first[0]; bounds->last[0] >= x; x++) {
+          const size_t index = x + CLUSTER_X * (y + CLUSTER_Y * z);
+          if (CLUSTER_LIGHTS > cluster->counts[index]) {
+            cluster->slots[index * CLUSTER_LIGHTS + cluster->counts[index]++] = i;
+          }
+          else {
+            task->dropped++;
+          }
+        }
+      }
+    }
+  }
+}
+// the calling thread takes the last part and runs the others while it waits
+static void run(Application_cluster cluster[static 1], Application_jobs_Function function) {
+  Application_jobs_Counter done = { 0 };
+  for (size_t i = 0; cluster->threads - 1 > i; i++) {
+    if (cluster->jobs) {
+      Application_jobs_submit(cluster->jobs, function, &cluster->tasks[i], 0, &done);
+    }
+    else {
+      function(&cluster->tasks[i]);
+    }
+  }
+  function(&cluster->tasks[cluster->threads - 1]);
+  if (cluster->jobs) {
+    Application_jobs_wait(cluster->jobs, &done);
+  }
+}
+const uint32_t* Application_cluster_bin(
+  Application_cluster* cluster,
+  size_t count,
+  const Application_cluster_Light lights[],
+  Matrix4f view,
+  Matrix4f projection,
+  size_t size[static 1]) {
+  const double begin = now();
+  if (count > cluster->capacity) {
+    Bounds* bounds = realloc(cluster->bounds, count * sizeof(*bounds));
+    if (!bounds) {
+      perror("Cluster allocation failed");
+      count = cluster->capacity;
+    }
+    else {
+      cluster->bounds = bounds;
+      cluster->capacity = count;
+    }
+  }
+  // near and far back from the depth terms of the perspective
+  const float* p = projection.elements;
+  const Task task = {
+    .cluster = cluster,
+    .lights = lights,
+    .count = count,
+    .view = view,
+    .scale = { p[0], p[5] },
+    .near = p[11] / (p[10] - 1),
+    .far = p[11] / (p[10] + 1),
+  };
+  const size_t threads = cluster->threads;
+  for (size_t i = 0; threads > i; i++) {
+    cluster->tasks[i] = task;
+    cluster->tasks[i].begin = count * i / threads;
+    cluster->tasks[i].end = count * (i + 1) / threads;
+  }
+  run(cluster, bounds_run);
+  memset(cluster->counts, 0, sizeof(cluster->counts));
+  for (size_t i = 0; threads > i; i++) {
+    cluster->tasks[i].begin = CLUSTER_Z * i / threads;
+    cluster->tasks[i].end = CLUSTER_Z * (i + 1) / threads;
+  }
+  run(cluster, slices_run);
+  // packed for the upload, the offsets count words from the start of the grid
+  size_t offset = 2 * CLUSTER_COUNT;
+  for (size_t i = 0; CLUSTER_COUNT > i; i++) {
+    cluster->grid[2 * i] = offset;
+    cluster->grid[2 * i + 1] = cluster->counts[i];
+    memcpy(
+      &cluster->grid[offset],
+      &cluster->slots[i * CLUSTER_LIGHTS],
+      cluster->counts[i] * sizeof(*cluster->grid));
+    offset += cluster->counts[i];
+  }
+  cluster->stats.lights = count;
+  cluster->stats.references = offset - 2 * CLUSTER_COUNT;
+  cluster->stats.dropped = 0;
+  for (size_t i = 0; threads > i; i++) {
+    cluster->stats.dropped += cluster->tasks[i].dropped;
+  }
+  cluster->stats.milliseconds = now() - begin;
+  *size = offset * sizeof(*cluster->grid);
+  return cluster->grid;
+}
+Application_cluster_Stats Application_cluster_stats(const Application_cluster* cluster) {
+  return cluster->stats;
+}
@@ -0,0 +1,61 @@
+#ifndef cluster_H_
+#define cluster_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include "linear/algebra.h"
+#include "jobs.h"
+
+// Clustered forward lighting: the view frustum is cut in a grid of tiles on the screen
+// and exponential slices in depth, the point lights are binned on the CPU into the
+// clusters they touch so that a fragment only shades the lights of its cluster. The grid
+// dimensions are given to the shaders as defines, so they stay plain numbers.
+#define CLUSTER_X      16
+#define CLUSTER_Y      9
+#define CLUSTER_Z      24
+#define CLUSTER_COUNT  (CLUSTER_X * CLUSTER_Y * CLUSTER_Z)
+#define CLUSTER_LIGHTS (64) // per cluster, further lights are dropped
+// the grid of offsets and counts followed by the light indices, in 32 bit words
+#define CLUSTER_WORDS  (2 * CLUSTER_COUNT + CLUSTER_COUNT * CLUSTER_LIGHTS)
+
+#define CLUSTER_STRING_(value) #value
+#define CLUSTER_STRING(value)  CLUSTER_STRING_(value)
+#define CLUSTER_DEFINES                                        \
+  { .name = "CLUSTER_X", .value = CLUSTER_STRING(CLUSTER_X) }, \
+    { .name = "CLUSTER_Y", .value = CLUSTER_STRING(CLUSTER_Y) }, \
+    { .name = "CLUSTER_Z", .value = CLUSTER_STRING(CLUSTER_Z) }
+
+// laid out as the PointLight of the shaders
+typedef struct {
+    Vector3f position;
+    float radius;
+    Vector3f color;
+    float intensity;
+} Application_cluster_Light;
+typedef struct {
+    size_t lights; // binned in the last call
+    size_t references; // light indices written to the grid
+    size_t dropped; // references lost to full clusters
+    size_t threads; // tasks a call is cut in
+    double milliseconds; // spent in the last call
+} Application_cluster_Stats;
+
+typedef struct Application_cluster Application_cluster;
+
+// the binning is cut in as many tasks as threads, zero takes the threads of the job
+// system, the tasks run on it or on the calling thread without one
+Application_cluster* Application_cluster_create(Application_jobs* jobs, size_t threads);
+void Application_cluster_destroy(Application_cluster* cluster);
+// the matrices are the row major ones of linear/algebra.h, the projection a perspective,
+// returns the grid and its size in bytes, it stays valid until the next call. With a job
+// system it is called from one of its threads.
+const uint32_t* Application_cluster_bin(
+  Application_cluster* cluster,
+  size_t count,
+  const Application_cluster_Light lights[],
+  Matrix4f view,
+  Matrix4f projection,
+  size_t size[static 1]);
+Application_cluster_Stats Application_cluster_stats(const Application_cluster* cluster);
+
+#endif // cluster_H_
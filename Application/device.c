@@ -5,7 +5,15 @@
 #include <string.h>
 #include <assert.h>
 #include <tgmath.h>
+#include <time.h>
+#include <threads.h>
 #include "webgpu.h"
+#include "trace.h"
+#include "stats.h"
+#include "memory.h"
+#include "limits.h"
+#include "cache.h"
+#include "preprocessor.h"
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb_image.h"
 
@@ -14,27 +22,56 @@ typedef struct {
     bool done;
 } Response;
 
-static void limitsSet(
-  WGPURequiredLimits required[static 1],
-  WGPUSupportedLimits supported) {
-  required->limits.maxVertexAttributes = 4;
-  required->limits.maxVertexBuffers = 2;
-  required->limits.maxBufferSize = 150000 * 44; // FIXME
-  required->limits.maxVertexBufferArrayStride = 44; // FIXME
-  required->limits.minStorageBufferOffsetAlignment =
-    supported.limits.minStorageBufferOffsetAlignment;
-  required->limits.minUniformBufferOffsetAlignment =
-    supported.limits.minUniformBufferOffsetAlignment;
-  required->limits.maxInterStageShaderComponents = 11;
-  required->limits.maxBindGroups = 1;
-  required->limits.maxUniformBuffersPerShaderStage = 1;
-  required->limits.maxUniformBufferBindingSize = 16 * 4 * sizeof(float);
-  required->limits.maxTextureDimension1D = 2048;
-  required->limits.maxTextureDimension2D = 2048;
-  required->limits.maxTextureArrayLayers = 1;
-  required->limits.maxSampledTexturesPerShaderStage = 1;
-  required->limits.maxSamplersPerShaderStage = 1;
+// the wall clock span of compiling shaders and creating pipelines, from the first
+// creation to the last completion, what the blob cache saves. The creations overlap so
+// their durations are not summed.
+static struct {
+    double begin;
+    double end;
+} compile = { 0 };
+
+#define PERMUTATION_CAPACITY (32)
+#define PERMUTATION_KEY      (512)
+
+// compiled modules by path and defines, replaced when the expanded source changes
+typedef struct {
+    char key[PERMUTATION_KEY];
+    uint64_t source; // hash of the expanded source
+    WGPUShaderModule module;
+} Permutation;
+static struct {
+    Permutation entries[PERMUTATION_CAPACITY];
+    size_t count;
+    size_t hits;
+} permutations = { 0 };
+
+static double now() {
+  struct timespec time = { 0 };
+  clock_gettime(CLOCK_MONOTONIC, &time);
+  return (double)time.tv_sec * 1e3 + (double)time.tv_nsec / 1e6;
+}
+// the pipeline callbacks may come from another thread of Dawn, the lock guards the
+// pending requests, their count and the compile span
+static mtx_t pendingsMutex;
+static once_flag pendingsOnce = ONCE_FLAG_INIT;
+
+static void pendings_initialize() {
+  mtx_init(&pendingsMutex, mtx_plain);
 }
+static void pendings_lock() {
+  call_once(&pendingsOnce, pendings_initialize);
+  mtx_lock(&pendingsMutex);
+}
+static void pendings_unlock() {
+  mtx_unlock(&pendingsMutex);
+}
+static void compile_span(double begin, double end) {
+  pendings_lock();
+  compile.begin = compile.begin && compile.begin < begin ? compile.begin : begin;
+  compile.end = compile.end > end ? compile.end : end;
+  pendings_unlock();
+}
+
 static void device_onRequest(
   WGPURequestDeviceStatus status,
   WGPUDevice device,
@@ -66,16 +103,60 @@ static void onDeviceError(WGPUErrorType type, const char* message, void* /* pUse
   printf("\n");
   abort();
 }
-WGPUDevice Application_device_request(WGPUAdapter adapter) {
+WGPUDevice Application_device_request(
+  WGPUAdapter adapter,
+  const WGPULimits requirements[static 1],
+  Application_cache* cache,
+  bool profile) {
   WGPUSupportedLimits supported = { .nextInChain = 0, .limits = { 0 } };
   wgpuAdapterGetLimits(adapter, &supported);
-  WGPURequiredLimits required = { .nextInChain = 0, .limits = supported.limits };
-  limitsSet(&required, supported);
+  WGPURequiredLimits required = { .nextInChain = 0 };
+  if (!Application_limits_negotiate(
+        requirements,
+        &supported.limits,
+        &required.limits,
+        stderr)) {
+    return 0;
+  }
+  // optional features are only requested when the adapter offers them, the implicit
+  // synchronization lets the render bundles be recorded on several threads, the
+  // timestamps are only asked for when profiling, those outside of the passes time the
+  // copies to the surface
+  const WGPUFeatureName optional[] = {
+    WGPUFeatureName_ImplicitDeviceSynchronization,
+    WGPUFeatureName_TimestampQuery,
+    WGPUFeatureName_ChromiumExperimentalTimestampQueryInsidePasses,
+  };
+  const size_t optionalCount = profile ? sizeof(optional) / sizeof(*optional) : 1;
+  WGPUFeatureName features[sizeof(optional) / sizeof(*optional)] = { 0 };
+  size_t featureCount = 0;
+  for (size_t i = 0; optionalCount > i; i++) {
+    if (wgpuAdapterHasFeature(adapter, optional[i])) {
+      features[featureCount++] = optional[i];
+    }
+  }
+  // blobs compiled for another adapter or driver must not be loaded
+  WGPUAdapterProperties properties = { .nextInChain = 0 };
+  wgpuAdapterGetProperties(adapter, &properties);
+  char isolationKey[512];
+  snprintf(
+    isolationKey,
+    sizeof(isolationKey),
+    "%x:%x:%d:%s",
+    properties.vendorID,
+    properties.deviceID,
+    properties.backendType,
+    properties.driverDescription ? properties.driverDescription : "");
+  wgpuAdapterPropertiesFreeMembers(properties);
+  WGPUDawnCacheDeviceDescriptor cacheDescriptor = { 0 };
+  if (cache) {
+    cacheDescriptor = Application_cache_descriptor(cache, isolationKey);
+  }
   WGPUDeviceDescriptor descriptor = {
-    .nextInChain = 0,
+    .nextInChain = cache ? &cacheDescriptor.chain : 0,
     .label = "Device 1",
-    .requiredFeatureCount = 0,
-    .requiredFeatures = 0,
+    .requiredFeatureCount = featureCount,
+    .requiredFeatures = features,
     .requiredLimits = &required,
     .defaultQueue.label = "default queueuue",
   };
@@ -86,7 +167,6 @@ WGPUDevice Application_device_request(WGPUAdapter adapter) {
   wgpuDeviceSetLoggingCallback(response.device, onLog, 0);
   return response.device;
 }
-static char* readFile(const char* filename);
 static void WGPUCompilationMessageStringify(const WGPUCompilationMessage message);
 static char* compilationStatusStringify(WGPUCompilationInfoRequestStatus status);
 static void compilationPrint(
@@ -101,12 +181,65 @@ static void compilationPrint(
     WGPUCompilationMessageStringify(info->messages[i]);
   }
 }
+static uint64_t hash(const char* string) {
+  uint64_t result = 14695981039346656037ull;
+  for (; *string; string++) {
+    result = (result ^ (unsigned char)*string) * 1099511628211ull;
+  }
+  return result;
+}
+static bool permutation_key(
+  char key[static PERMUTATION_KEY],
+  const char* path,
+  size_t defineCount,
+  const Application_preprocessor_Define defines[]) {
+  int length = snprintf(key, PERMUTATION_KEY, "%s", path);
+  for (size_t i = 0; defineCount > i && 0 <= length && PERMUTATION_KEY > length; i++) {
+    length += snprintf(
+      key + length,
+      PERMUTATION_KEY - length,
+      " %s=%s",
+      defines[i].name,
+      defines[i].value ? defines[i].value : "1");
+  }
+  return 0 <= length && PERMUTATION_KEY > length;
+}
 WGPUShaderModule Application_device_ShaderModule(WGPUDevice device, const char* path) {
-  char* shader = readFile(path);
+  return Application_device_ShaderModule_permutation(device, path, 0, 0, 0);
+}
+WGPUShaderModule Application_device_ShaderModule_permutation(
+  WGPUDevice device,
+  const char* path,
+  size_t defineCount,
+  const Application_preprocessor_Define defines[],
+  Application_preprocessor_Files* files) {
+  TRACE_SCOPE("shader compilation");
+  const double begin = now();
+  char* shader = Application_preprocessor_run(path, defineCount, defines, files, stderr);
   if (!shader) {
-    fprintf(stderr, "Error opening %s: %s\n", path, strerror(errno));
     return 0;
   }
+  // the file is read and expanded every time so that edits reach the cache
+  char key[PERMUTATION_KEY];
+  Permutation* permutation = 0;
+  if (permutation_key(key, path, defineCount, defines)) {
+    for (size_t i = 0; !permutation && permutations.count > i; i++) {
+      if (!strcmp(permutations.entries[i].key, key)) {
+        permutation = &permutations.entries[i];
+      }
+    }
+    if (!permutation && PERMUTATION_CAPACITY > permutations.count) {
+      permutation = &permutations.entries[permutations.count++];
+      strcpy(permutation->key, key);
+    }
+  }
+  const uint64_t source = hash(shader);
+  if (permutation && permutation->module && permutation->source == source) {
+    free(shader);
+    permutations.hits++;
+    wgpuShaderModuleAddRef(permutation->module);
+    return permutation->module;
+  }
   WGPUShaderModuleWGSLDescriptor codeDescriptor = {
     .chain.next = 0,
     .chain.sType = WGPUSType_ShaderModuleWGSLDescriptor,
@@ -119,6 +252,157 @@ WGPUShaderModule Application_device_ShaderModule(WGPUDevice device, const char*
   WGPUShaderModule result = wgpuDeviceCreateShaderModule(device, &shaderDescriptor);
   wgpuShaderModuleGetCompilationInfo(result, &compilationPrint, 0);
   free(shader);
+  compile_span(begin, now());
+  if (permutation && result) {
+    if (permutation->module) {
+      wgpuShaderModuleRelease(permutation->module);
+    }
+    permutation->source = source;
+    permutation->module = result;
+    wgpuShaderModuleAddRef(result);
+  }
+  return result;
+}
+size_t Application_device_ShaderModule_hits() {
+  return permutations.hits;
+}
+void Application_device_ShaderModule_clear() {
+  for (size_t i = 0; permutations.count > i; i++) {
+    if (permutations.entries[i].module) {
+      wgpuShaderModuleRelease(permutations.entries[i].module);
+    }
+  }
+  permutations.count = 0;
+}
+typedef struct Pending Pending;
+struct Pending {
+    Pending* next;
+    void* pipeline; // null once cancelled
+    double begin;
+};
+static Pending* pendings = 0;
+static size_t pendingCount = 0;
+static Pending* pending_push(void* pipeline) {
+  Pending* result = calloc(1, sizeof(*result));
+  if (result) {
+    const double begin = now();
+    pendings_lock();
+    *result = (Pending){ .next = pendings, .pipeline = pipeline, .begin = begin };
+    pendings = result;
+    pendingCount++;
+    pendings_unlock();
+  }
+  return result;
+}
+// returns where the pipeline has to be written, null when the request was cancelled
+static void* pending_pop(Pending pending[static 1]) {
+  const double end = now();
+  pendings_lock();
+  void* result = pending->pipeline;
+  for (Pending** link = &pendings; *link; link = &(*link)->next) {
+    if (*link == pending) {
+      *link = pending->next;
+      break;
+    }
+  }
+  pendingCount--;
+  pendings_unlock();
+  compile_span(pending->begin, end);
+  free(pending);
+  return result;
+}
+static void RenderPipeline_onCreate(
+  WGPUCreatePipelineAsyncStatus status,
+  WGPURenderPipeline pipeline,
+  const char* message,
+  void* userdata) {
+  WGPURenderPipeline* destination = pending_pop(userdata);
+  if (status != WGPUCreatePipelineAsyncStatus_Success) {
+    fprintf(stderr, "Render pipeline creation failed: %s\n", message ? message : "");
+  }
+  else if (destination) {
+    *destination = pipeline;
+  }
+  else if (pipeline) {
+    wgpuRenderPipelineRelease(pipeline);
+  }
+}
+static void ComputePipeline_onCreate(
+  WGPUCreatePipelineAsyncStatus status,
+  WGPUComputePipeline pipeline,
+  const char* message,
+  void* userdata) {
+  WGPUComputePipeline* destination = pending_pop(userdata);
+  if (status != WGPUCreatePipelineAsyncStatus_Success) {
+    fprintf(stderr, "Compute pipeline creation failed: %s\n", message ? message : "");
+  }
+  else if (destination) {
+    *destination = pipeline;
+  }
+  else if (pipeline) {
+    wgpuComputePipelineRelease(pipeline);
+  }
+}
+void Application_device_RenderPipeline_request(
+  WGPUDevice device,
+  const WGPURenderPipelineDescriptor descriptor[static 1],
+  WGPURenderPipeline pipeline[static 1]) {
+  TRACE_SCOPE("pipeline request");
+  *pipeline = 0;
+  Pending* pending = pending_push(pipeline);
+  if (!pending) {
+    perror("Pipeline request allocation failed");
+  }
+  else {
+    wgpuDeviceCreateRenderPipelineAsync(device, descriptor, RenderPipeline_onCreate, pending);
+  }
+}
+void Application_device_ComputePipeline_request(
+  WGPUDevice device,
+  const WGPUComputePipelineDescriptor descriptor[static 1],
+  WGPUComputePipeline pipeline[static 1]) {
+  TRACE_SCOPE("pipeline request");
+  *pipeline = 0;
+  Pending* pending = pending_push(pipeline);
+  if (!pending) {
+    perror("Pipeline request allocation failed");
+  }
+  else {
+    wgpuDeviceCreateComputePipelineAsync(
+      device,
+      descriptor,
+      ComputePipeline_onCreate,
+      pending);
+  }
+}
+void Application_device_Pipeline_cancel(const void* pipeline) {
+  pendings_lock();
+  for (Pending* pending = pendings; pending; pending = pending->next) {
+    if (pending->pipeline == pipeline) {
+      pending->pipeline = 0;
+    }
+  }
+  pendings_unlock();
+}
+bool Application_device_Pipeline_pending(const void* pipeline) {
+  bool result = false;
+  pendings_lock();
+  for (Pending* pending = pendings; !result && pending; pending = pending->next) {
+    result = pending->pipeline == pipeline;
+  }
+  pendings_unlock();
+  return result;
+}
+size_t Application_device_pendingPipelines() {
+  pendings_lock();
+  const size_t result = pendingCount;
+  pendings_unlock();
+  return result;
+}
+double Application_device_compileTime() {
+  pendings_lock();
+  const double result = compile.end - compile.begin;
+  pendings_unlock();
   return result;
 }
 void Application_device_inspect(WGPUDevice device) {
@@ -194,7 +478,9 @@ static void writeMipMaps(
   WGPUTexture texture,
   WGPUExtent3D size,
   uint32_t mipLevelCount,
+  uint32_t skip, // evicted levels are computed but not uploaded
   const uint8_t* pixelsInput) {
+  TRACE_SCOPE("writeMipMaps");
   WGPUQueue queue = wgpuDeviceGetQueue(device);
   WGPUImageCopyTexture destination = {
     .texture = texture,
@@ -229,10 +515,19 @@ static void writeMipMaps(
       }
     }
     pixelCount = 4 * mipLevelSize.width * mipLevelSize.height;
-    destination.mipLevel = level;
-    source.bytesPerRow = 4 * mipLevelSize.width;
-    source.rowsPerImage = mipLevelSize.height;
-    wgpuQueueWriteTexture(queue, &destination, pixels, pixelCount, &source, &mipLevelSize);
+    if (level >= skip) {
+      destination.mipLevel = level - skip;
+      source.bytesPerRow = 4 * mipLevelSize.width;
+      source.rowsPerImage = mipLevelSize.height;
+      wgpuQueueWriteTexture(
+        queue,
+        &destination,
+        pixels,
+        pixelCount,
+        &source,
+        &mipLevelSize);
+      Application_stats_add(Application_stats_UploadBytes, pixelCount);
+    }
     memcpy(previousLevelPixels, pixels, pixelCount);
     previousMipLevelSize = mipLevelSize;
     mipLevelSize.width /= 2;
@@ -261,24 +556,45 @@ WGPUTexture Application_device_Texture_load(
   int width = 0;
   int height = 0;
   int channels = 0;
+  TRACE_BEGIN("stbi_load");
   uint8_t* pixels = stbi_load(path, &width, &height, &channels, 4);
+  TRACE_END();
   if (!pixels) {
     return 0;
   }
   WGPUTextureDescriptor descriptor = {
     .nextInChain = 0,
+    .label = path,
     .dimension = WGPUTextureDimension_2D,
  // by convention for bmp, png and jpg file. Be careful with other formats,
     .format = WGPUTextureFormat_RGBA8Unorm,
-    .mipLevelCount = bit_width(fmax(descriptor.size.width, descriptor.size.height)),
+    .mipLevelCount = bit_width(fmax(width, height)),
     .sampleCount = 1,
     .size = {(unsigned int)width, (unsigned int)height, 1},
     .usage = WGPUTextureUsage_TextureBinding | WGPUTextureUsage_CopyDst,
     .viewFormatCount = 0,
     .viewFormats = 0,
   };
-  WGPUTexture texture = wgpuDeviceCreateTexture(device, &descriptor);
-  writeMipMaps(device, texture, descriptor.size, descriptor.mipLevelCount, pixels);
+  const WGPUExtent3D size = descriptor.size;
+  const uint32_t mipLevelCount = descriptor.mipLevelCount;
+  // over budget the largest levels are evicted until the rest of the chain fits, a non
+  // square texture stops when its smaller side is down to a pixel
+  uint32_t skip = 0;
+  const uint64_t available = Application_memory_available();
+  while (descriptor.mipLevelCount > 1 && descriptor.size.width > 1
+         && descriptor.size.height > 1
+         && Application_memory_Texture_size(&descriptor) > available) {
+    descriptor.size.width = descriptor.size.width / 2 ? descriptor.size.width / 2 : 1;
+    descriptor.size.height = descriptor.size.height / 2 ? descriptor.size.height / 2 : 1;
+    descriptor.mipLevelCount--;
+    skip++;
+  }
+  if (skip) {
+    printf("Texture %s exceeds the memory budget, %u mip levels evicted\n", path, skip);
+  }
+  WGPUTexture texture =
+    Application_memory_Texture_create(device, &descriptor, Application_memory_Texture);
+  writeMipMaps(device, texture, size, mipLevelCount, skip, pixels);
   stbi_image_free(pixels);
   if (view) {
     WGPUTextureViewDescriptor viewDescriptor = {
@@ -294,30 +610,58 @@ WGPUTexture Application_device_Texture_load(
   }
   return texture;
 }
-static char* readFile(const char* filename) {
-  char* result = 0;
-  FILE* input = fopen(filename, "rb");
+// counts the vertices of the triangulated faces without parsing the whole mesh, the
+// corners are counted as the characters come so lines have no length limit
+void Application_device_Mesh_require(
+  WGPULimits limits[static 1],
+  const char* path,
+  size_t vertexSize) {
+  FILE* input = fopen(path, "r");
   if (!input) {
-    result = 0;
+    fprintf(stderr, "Error opening %s: %s\n", path, strerror(errno));
+    return;
   }
-  else {
-    const size_t maxSize = 10 * 1024 * 1024;
-    size_t size = BUFSIZ;
-    result = malloc(size * sizeof(*result));
-    size_t total = 0;
-    while (!feof(input) && !ferror(input) && (maxSize > size)) {
-      if (total + BUFSIZ > size) {
-        size = size * 2;
-        result = realloc(result, size);
-      }
-      char* buffer = result + total;
-      total += fread(buffer, 1, BUFSIZ, input);
+  uint64_t vertexCount = 0;
+  uint64_t corners = 0;
+  size_t column = 0;
+  bool face = false;
+  bool corner = false; // inside a corner of the face
+  int c = 0;
+  do {
+    c = getc(input);
+    if (EOF == c || '\n' == c) {
+      vertexCount += face && corners > 2 ? 3 * (corners - 2) : 0;
+      corners = 0;
+      column = 0;
+      face = false;
+      corner = false;
+      continue;
+    }
+    const bool blank = ' ' == c || '\t' == c || '\r' == c;
+    if (0 == column) {
+      face = 'f' == c;
+    }
+    else if (1 == column) {
+      face = face && blank;
+    }
+    else if (face && !blank && !corner) {
+      corners++;
     }
-    fclose(input);
-    result = realloc(result, total + 1);
-    result[total] = '\0';
+    corner = face && 0 < column && !blank;
+    column++;
+  } while (EOF != c);
+  fclose(input);
+  LIMITS_REQUIRE(limits->maxBufferSize, vertexCount * vertexSize);
+}
+void Application_device_Texture_require(WGPULimits limits[static 1], const char* path) {
+  int width = 0;
+  int height = 0;
+  int channels = 0;
+  if (!stbi_info(path, &width, &height, &channels)) {
+    fprintf(stderr, "Error reading %s: %s\n", path, stbi_failure_reason());
+    return;
   }
-  return result;
+  LIMITS_REQUIRE(limits->maxTextureDimension2D, (uint32_t)(width > height ? width : height));
 }
 #define STRINGIFY(value) \
   case value:            \
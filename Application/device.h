@@ -1,14 +1,59 @@
 #ifndef device_H_
 #define device_H_
 
+#include <stddef.h>
 #include "webgpu.h"
+#include "cache.h"
+#include "preprocessor.h"
 
-WGPUDevice Application_device_request(WGPUAdapter adapter);
+// returns null and prints a report when the adapter cannot satisfy the requirements,
+// compiled shaders and pipelines are stored in the cache when there is one, the timestamp
+// queries are only enabled to profile
+WGPUDevice Application_device_request(
+  WGPUAdapter adapter,
+  const WGPULimits requirements[static 1],
+  Application_cache* cache,
+  bool profile);
+// the shaders go through the preprocessor, a module is compiled once per path and defines
+// and again only when the expanded source changes, the caller releases its reference, the
+// files the source was expanded from are stored in files unless it is null
 WGPUShaderModule Application_device_ShaderModule(WGPUDevice device, const char* path);
+WGPUShaderModule Application_device_ShaderModule_permutation(
+  WGPUDevice device,
+  const char* path,
+  size_t defineCount,
+  const Application_preprocessor_Define defines[],
+  Application_preprocessor_Files* files);
+// modules returned from the cache instead of compiled
+size_t Application_device_ShaderModule_hits();
+// releases the cached modules, before the device
+void Application_device_ShaderModule_clear();
+// the pipelines are created asynchronously, the handle stays null until the device tick
+// that completes them, requests that are still pending can be cancelled by their handle
+void Application_device_RenderPipeline_request(
+  WGPUDevice device,
+  const WGPURenderPipelineDescriptor descriptor[static 1],
+  WGPURenderPipeline pipeline[static 1]);
+void Application_device_ComputePipeline_request(
+  WGPUDevice device,
+  const WGPUComputePipelineDescriptor descriptor[static 1],
+  WGPUComputePipeline pipeline[static 1]);
+void Application_device_Pipeline_cancel(const void* pipeline);
+bool Application_device_Pipeline_pending(const void* pipeline);
+size_t Application_device_pendingPipelines();
+// milliseconds from the first shader or pipeline creation to the last one completed,
+// asynchronous creations are counted from the request to their completion
+double Application_device_compileTime();
 WGPUTexture Application_device_Texture_load(
   WGPUDevice device,
   const char* const path,
   WGPUTextureView* view);
 void Application_device_inspect(WGPUDevice device);
+// scene requirements read from the asset files before the device exists
+void Application_device_Mesh_require(
+  WGPULimits limits[static 1],
+  const char* path,
+  size_t vertexSize);
+void Application_device_Texture_require(WGPULimits limits[static 1], const char* path);
 
 #endif // device_H_
@@ -0,0 +1,61 @@
+#include "dirty.h"
+
+// joins a range with the next one
+static void merge(Application_dirty dirty[static 1], size_t index) {
+  dirty->ranges[index].end = dirty->ranges[index + 1].end > dirty->ranges[index].end
+                               ? dirty->ranges[index + 1].end
+                               : dirty->ranges[index].end;
+  for (size_t i = index + 1; dirty->count - 1 > i; i++) {
+    dirty->ranges[i] = dirty->ranges[i + 1];
+  }
+  dirty->count--;
+}
+void Application_dirty_mark(
+  Application_dirty dirty[static 1],
+  size_t offset,
+  size_t size) {
+  if (!size) {
+    return;
+  }
+  const Application_dirty_Range range = {
+    .begin = offset & ~(size_t)3,
+    .end = (offset + size + 3) & ~(size_t)3,
+  };
+  // the pair with the smallest gap is merged when the ranges run out
+  if (DIRTY_RANGES == dirty->count) {
+    size_t closest = 0;
+    for (size_t i = 1; dirty->count - 1 > i; i++) {
+      if (dirty->ranges[closest + 1].begin - dirty->ranges[closest].end
+          > dirty->ranges[i + 1].begin - dirty->ranges[i].end) {
+        closest = i;
+      }
+    }
+    merge(dirty, closest);
+  }
+  size_t index = dirty->count;
+  while (index && dirty->ranges[index - 1].begin > range.begin) {
+    dirty->ranges[index] = dirty->ranges[index - 1];
+    index--;
+  }
+  dirty->ranges[index] = range;
+  dirty->count++;
+  // the new range can join its neighbours on both sides
+  for (size_t i = 0; dirty->count - 1 > i;) {
+    if (dirty->ranges[i].end + DIRTY_GAP >= dirty->ranges[i + 1].begin) {
+      merge(dirty, i);
+    }
+    else {
+      i++;
+    }
+  }
+}
+size_t Application_dirty_take(
+  Application_dirty dirty[static 1],
+  Application_dirty_Range ranges[static DIRTY_RANGES]) {
+  const size_t result = dirty->count;
+  for (size_t i = 0; result > i; i++) {
+    ranges[i] = dirty->ranges[i];
+  }
+  dirty->count = 0;
+  return result;
+}
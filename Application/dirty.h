@@ -0,0 +1,58 @@
+#ifndef dirty_H_
+#define dirty_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "webgpu.h"
+#include "stats.h"
+
+#define DIRTY_RANGES (8)
+// ranges closer than this are written in one call, the bytes between cost less
+#define DIRTY_GAP    (64)
+
+// Byte ranges of a CPU side uniform block changed since its last upload, sorted and
+// merged as they are marked so that a flush is the fewest buffer writes.
+typedef struct {
+    uint32_t begin;
+    uint32_t end;
+} Application_dirty_Range;
+typedef struct {
+    Application_dirty_Range ranges[DIRTY_RANGES];
+    size_t count;
+} Application_dirty;
+
+#define DIRTY_MARK(dirty, block, member) \
+  Application_dirty_mark((dirty), offsetof(typeof(block), member), sizeof((block).member))
+
+void Application_dirty_mark(
+  Application_dirty dirty[static 1],
+  size_t offset,
+  size_t size);
+// the ranges to write, aligned to the 4 bytes buffer writes need, the tracker is cleared
+size_t Application_dirty_take(
+  Application_dirty dirty[static 1],
+  Application_dirty_Range ranges[static DIRTY_RANGES]);
+
+static inline void Application_dirty_flush(
+  Application_dirty dirty[static 1],
+  WGPUQueue queue,
+  WGPUBuffer buffer,
+  const void* data) {
+  Application_dirty_Range ranges[DIRTY_RANGES];
+  const size_t count = Application_dirty_take(dirty, ranges);
+  for (size_t i = 0; count > i; i++) {
+    const size_t size = ranges[i].end - ranges[i].begin;
+    wgpuQueueWriteBuffer(
+      queue,
+      buffer,
+      ranges[i].begin,
+      (const uint8_t*)data + ranges[i].begin,
+      size);
+    Application_stats_add(Application_stats_UploadBytes, size);
+    Application_stats_add(Application_stats_UniformBytes, size);
+    Application_stats_add(Application_stats_UniformWrites, 1);
+  }
+}
+
+#endif // dirty_H_
@@ -0,0 +1,282 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <assert.h>
+#include "webgpu.h"
+#include "adapter.h"
+#include "bundle.h"
+#include "jobs.h"
+
+#define ENCODING_ITERATIONS (20)
+#define ENCODING_PIPELINES  (4)
+#define ENCODING_GROUPS     (16)
+#define ENCODING_BUFFERS    (4)
+#define ENCODING_UNIFORM    (256) // the binding offset alignment
+
+// the time of recording the render bundles of more and more draws on more and more
+// workers, on an adapter without a surface
+static const char* const shader = "@group(0) @binding(0) var<uniform> offset: vec4f;\n"
+                                  "@vertex fn vs_main(@location(0) position: vec3f)\n"
+                                  "  -> @builtin(position) vec4f {\n"
+                                  "  return vec4f(position, 1.0) + offset;\n"
+                                  "}\n"
+                                  "@fragment fn fs_main() -> @location(0) vec4f {\n"
+                                  "  return vec4f(1.0);\n"
+                                  "}\n";
+
+typedef struct {
+    WGPUDevice device;
+    bool done;
+} Response;
+
+static void device_onRequest(
+  WGPURequestDeviceStatus status,
+  WGPUDevice device,
+  const char* message,
+  void* inputResponse) {
+  Response* response = (Response*)inputResponse;
+  if (status != WGPURequestDeviceStatus_Success) {
+    printf("Could not get WebGPU device: %s\n", message);
+  }
+  else {
+    response->device = device;
+  }
+  response->done = true;
+}
+// the workers only record in parallel with the implicit synchronization
+static WGPUDevice device_request(WGPUAdapter adapter) {
+  const WGPUFeatureName feature = WGPUFeatureName_ImplicitDeviceSynchronization;
+  const bool synchronized = wgpuAdapterHasFeature(adapter, feature);
+  if (!synchronized) {
+    printf("The adapter records on a single thread.\n");
+  }
+  const WGPUDeviceDescriptor descriptor = {
+    .nextInChain = 0,
+    .label = "encoding device",
+    .requiredFeatureCount = synchronized,
+    .requiredFeatures = &feature,
+    .requiredLimits = 0,
+    .defaultQueue = { .nextInChain = 0, .label = "encoding queue" },
+  };
+  Response response = { .device = 0, .done = false };
+  wgpuAdapterRequestDevice(adapter, &descriptor, device_onRequest, &response);
+  assert(response.done);
+  return response.device;
+}
+static void pipelines_create(
+  WGPUDevice device,
+  WGPUBindGroupLayout bindGroupLayout,
+  WGPURenderPipeline pipelines[static ENCODING_PIPELINES]) {
+  WGPUShaderModuleWGSLDescriptor codeDescriptor = {
+    .chain.next = 0,
+    .chain.sType = WGPUSType_ShaderModuleWGSLDescriptor,
+    .code = shader,
+  };
+  const WGPUShaderModuleDescriptor shaderDescriptor = {
+    .nextInChain = &codeDescriptor.chain,
+    .label = "encoding shader",
+  };
+  WGPUShaderModule module = wgpuDeviceCreateShaderModule(device, &shaderDescriptor);
+  const WGPUPipelineLayoutDescriptor layoutDescriptor = {
+    .nextInChain = 0,
+    .bindGroupLayoutCount = 1,
+    .bindGroupLayouts = &bindGroupLayout,
+  };
+  WGPUPipelineLayout layout = wgpuDeviceCreatePipelineLayout(device, &layoutDescriptor);
+  const WGPUVertexAttribute attribute = {
+    .format = WGPUVertexFormat_Float32x3,
+    .offset = 0,
+    .shaderLocation = 0,
+  };
+  const WGPUVertexBufferLayout bufferLayout = {
+    .arrayStride = 3 * sizeof(float),
+    .stepMode = WGPUVertexStepMode_Vertex,
+    .attributeCount = 1,
+    .attributes = &attribute,
+  };
+  const WGPUColorTargetState colorTarget = {
+    .nextInChain = 0,
+    .format = WGPUTextureFormat_BGRA8Unorm,
+    .blend = 0,
+    .writeMask = WGPUColorWriteMask_All,
+  };
+  const WGPUFragmentState fragmentState = {
+    .nextInChain = 0,
+    .module = module,
+    .entryPoint = "fs_main",
+    .constantCount = 0,
+    .constants = 0,
+    .targetCount = 1,
+    .targets = &colorTarget,
+  };
+  WGPUDepthStencilState depthStencilState = {
+    .nextInChain = 0,
+    .format = WGPUTextureFormat_Depth24Plus,
+    .depthWriteEnabled = true,
+    .depthCompare = WGPUCompareFunction_Less,
+    .stencilFront.compare = WGPUCompareFunction_Always,
+    .stencilBack.compare = WGPUCompareFunction_Always,
+    .stencilReadMask = 0,
+    .stencilWriteMask = 0,
+  };
+  // the pipelines only differ by their culling, which is enough to make them distinct
+  const WGPUCullMode cullModes[] = {
+    WGPUCullMode_None,
+    WGPUCullMode_Front,
+    WGPUCullMode_Back,
+    WGPUCullMode_None,
+  };
+  for (size_t i = 0; ENCODING_PIPELINES > i; i++) {
+    const WGPURenderPipelineDescriptor descriptor = {
+      .nextInChain = 0,
+      .label = "encoding pipeline",
+      .layout = layout,
+      .vertex.module = module,
+      .vertex.entryPoint = "vs_main",
+      .vertex.bufferCount = 1,
+      .vertex.buffers = &bufferLayout,
+      .primitive.topology = WGPUPrimitiveTopology_TriangleList,
+      .primitive.frontFace = i < 3 ? WGPUFrontFace_CCW : WGPUFrontFace_CW,
+      .primitive.cullMode = cullModes[i],
+      .depthStencil = &depthStencilState,
+      .multisample.count = 1,
+      .multisample.mask = ~0u,
+      .fragment = &fragmentState,
+    };
+    pipelines[i] = wgpuDeviceCreateRenderPipeline(device, &descriptor);
+  }
+  wgpuPipelineLayoutRelease(layout);
+  wgpuShaderModuleRelease(module);
+}
+int main() {
+  const size_t counts[] = { 256, 1024, 4096, 16384, 65536 };
+  const size_t workers[] = { 1, 2, 4, 8, 0 };
+  const size_t largest = counts[sizeof(counts) / sizeof(*counts) - 1];
+  const WGPUInstanceDescriptor instanceDescriptor = { .nextInChain = 0 };
+  WGPUInstance instance = wgpuCreateInstance(&instanceDescriptor);
+  const WGPURequestAdapterOptions adapterOptions = {
+    .nextInChain = 0,
+    .compatibleSurface = 0,
+    .powerPreference = WGPUPowerPreference_HighPerformance,
+  };
+  WGPUAdapter adapter =
+    instance ? Application_adapter_request(instance, &adapterOptions) : 0;
+  WGPUDevice device = adapter ? device_request(adapter) : 0;
+  Application_bundle_Draw* draws = malloc(largest * sizeof(*draws));
+  if (!device || !draws) {
+    perror("Benchmark setup failed");
+    return EXIT_FAILURE;
+  }
+  const WGPUBindGroupLayoutEntry entry = {
+    .nextInChain = 0,
+    .binding = 0,
+    .visibility = WGPUShaderStage_Vertex,
+    .buffer.type = WGPUBufferBindingType_Uniform,
+    .buffer.minBindingSize = 4 * sizeof(float),
+  };
+  const WGPUBindGroupLayoutDescriptor bindGroupLayoutDescriptor = {
+    .nextInChain = 0,
+    .entryCount = 1,
+    .entries = &entry,
+  };
+  WGPUBindGroupLayout bindGroupLayout =
+    wgpuDeviceCreateBindGroupLayout(device, &bindGroupLayoutDescriptor);
+  WGPURenderPipeline pipelines[ENCODING_PIPELINES];
+  pipelines_create(device, bindGroupLayout, pipelines);
+  const WGPUBufferDescriptor uniformDescriptor = {
+    .nextInChain = 0,
+    .label = "encoding uniforms",
+    .usage = WGPUBufferUsage_Uniform,
+    .size = ENCODING_GROUPS * ENCODING_UNIFORM,
+    .mappedAtCreation = false,
+  };
+  WGPUBuffer uniforms = wgpuDeviceCreateBuffer(device, &uniformDescriptor);
+  WGPUBindGroup bindGroups[ENCODING_GROUPS];
+  for (size_t i = 0; ENCODING_GROUPS > i; i++) {
+    const WGPUBindGroupEntry binding = {
+      .nextInChain = 0,
+      .binding = 0,
+      .buffer = uniforms,
+      .offset = i * ENCODING_UNIFORM,
+      .size = 4 * sizeof(float),
+    };
+    const WGPUBindGroupDescriptor descriptor = {
+      .nextInChain = 0,
+      .layout = bindGroupLayout,
+      .entryCount = 1,
+      .entries = &binding,
+    };
+    bindGroups[i] = wgpuDeviceCreateBindGroup(device, &descriptor);
+  }
+  const WGPUBufferDescriptor vertexDescriptor = {
+    .nextInChain = 0,
+    .label = "encoding vertices",
+    .usage = WGPUBufferUsage_Vertex,
+    .size = 3 * 3 * sizeof(float),
+    .mappedAtCreation = false,
+  };
+  WGPUBuffer vertexBuffers[ENCODING_BUFFERS];
+  for (size_t i = 0; ENCODING_BUFFERS > i; i++) {
+    vertexBuffers[i] = wgpuDeviceCreateBuffer(device, &vertexDescriptor);
+  }
+  printf("draws, workers, slices, milliseconds per encoding, milliseconds reused\n");
+  for (size_t i = 0; sizeof(workers) / sizeof(*workers) > i; i++) {
+    Application_jobs* jobs = Application_jobs_create(workers[i]);
+    Application_bundle* bundle = Application_bundle_create(
+      device,
+      jobs,
+      0,
+      WGPUTextureFormat_BGRA8Unorm,
+      WGPUTextureFormat_Depth24Plus);
+    for (size_t j = 0; bundle && sizeof(counts) / sizeof(*counts) > j; j++) {
+      // sorted by pipeline as a renderer would, every count switches between all of
+      // them, the bind group changes on most draws
+      for (size_t k = 0; counts[j] > k; k++) {
+        draws[k] = (Application_bundle_Draw){
+          .pipeline = pipelines[k * ENCODING_PIPELINES / counts[j]],
+          .bindGroup = bindGroups[k % ENCODING_GROUPS],
+          .vertexBuffer = vertexBuffers[k / 64 % ENCODING_BUFFERS],
+          .vertexSize = vertexDescriptor.size,
+          .vertexCount = 3,
+          .instanceCount = 1,
+        };
+      }
+      double milliseconds = 0;
+      double reused = 0;
+      for (size_t k = 0; ENCODING_ITERATIONS > k; k++) {
+        Application_bundle_invalidate(bundle);
+        Application_bundle_encode(bundle, counts[j], draws);
+        milliseconds += Application_bundle_stats(bundle).milliseconds;
+        Application_bundle_encode(bundle, counts[j], draws);
+        reused += Application_bundle_stats(bundle).milliseconds;
+      }
+      const Application_bundle_Stats stats = Application_bundle_stats(bundle);
+      printf(
+        "%zu, %zu, %zu, %.3f, %.3f\n",
+        counts[j],
+        stats.workers,
+        stats.slices,
+        milliseconds / ENCODING_ITERATIONS,
+        reused / ENCODING_ITERATIONS);
+      wgpuDeviceTick(device);
+    }
+    Application_bundle_destroy(bundle);
+    Application_jobs_destroy(jobs);
+  }
+  for (size_t i = 0; ENCODING_BUFFERS > i; i++) {
+    wgpuBufferRelease(vertexBuffers[i]);
+  }
+  for (size_t i = 0; ENCODING_GROUPS > i; i++) {
+    wgpuBindGroupRelease(bindGroups[i]);
+  }
+  for (size_t i = 0; ENCODING_PIPELINES > i; i++) {
+    wgpuRenderPipelineRelease(pipelines[i]);
+  }
+  wgpuBufferRelease(uniforms);
+  wgpuBindGroupLayoutRelease(bindGroupLayout);
+  wgpuDeviceRelease(device);
+  wgpuAdapterRelease(adapter);
+  wgpuInstanceRelease(instance);
+  free(draws);
+  return EXIT_SUCCESS;
+}
@@ -1,12 +1,16 @@
 #ifndef Application_gui_H_
 #define Application_gui_H_
 
+#include <float.h>
 #include "webgpu.h"
 #include "GLFW/glfw3.h"
 #include "cimgui/cimgui.h"
 #include "cimgui/cimgui_impl_wgpu.h"
 #include "cimgui/cimgui_impl_glfw.h"
 #include "./Lightning.h"
+#include "./Profiler.h"
+#include "./stats.h"
+#include "./memory.h"
 
 bool Application_gui_attach(
   GLFWwindow* window,
@@ -30,51 +34,151 @@ void Application_gui_detach() {
   cImGui_ImplGlfw_Shutdown();
   cImGui_ImplWGPU_Shutdown();
 }
+static void overlay_render(Application_Profiler profiler[static 1]) {
+  const Application_stats_Frame* frame = Application_stats_get();
+  const size_t last = (frame->head + STATS_HISTORY - 1) % STATS_HISTORY;
+  const ImGuiWindowFlags flags = ImGuiWindowFlags_NoDecoration
+                                 | ImGuiWindowFlags_AlwaysAutoResize
+                                 | ImGuiWindowFlags_NoSavedSettings
+                                 | ImGuiWindowFlags_NoFocusOnAppearing
+                                 | ImGuiWindowFlags_NoNav;
+  ImGui_SetNextWindowPos((ImVec2){ .x = 10.0f, .y = 10.0f }, ImGuiCond_Always);
+  ImGui_SetNextWindowBgAlpha(0.35f);
+  if (ImGui_Begin("Statistics", 0, flags)) {
+    ImGuiIO* io = ImGui_GetIO();
+    ImGui_Text(
+      "%.1f FPS, CPU %.3f ms, GPU %.3f ms",
+      io->Framerate,
+      frame->cpu[last],
+      frame->gpu[last]);
+    const ImVec2 size = { .x = 256.0f, .y = 40.0f };
+    ImGui_PlotLinesEx(
+      "CPU ms",
+      frame->cpu,
+      STATS_HISTORY,
+      frame->head,
+      0,
+      0.0f,
+      frame->histogramRange,
+      size,
+      sizeof(float));
+    if (profiler->enabled) {
+      ImGui_PlotLinesEx(
+        "GPU ms",
+        frame->gpu,
+        STATS_HISTORY,
+        frame->head,
+        0,
+        0.0f,
+        frame->histogramRange,
+        size,
+        sizeof(float));
+      for (size_t i = 0; profiler->passCount > i; i++) {
+        ImGui_Text(
+          "- %s: %.3f ms (avg %.3f, max %.3f)",
+          profiler->passes[i].name,
+          profiler->passes[i].milliseconds,
+          profiler->passes[i].average,
+          profiler->passes[i].maximum);
+      }
+    }
+    ImGui_Text("CPU frame times, 0 - %.0f ms", frame->histogramRange);
+    ImGui_PlotHistogramEx(
+      "##histogram",
+      frame->histogram,
+      STATS_HISTOGRAM,
+      0,
+      0,
+      0.0f,
+      FLT_MAX,
+      size,
+      sizeof(float));
+    ImGui_Separator();
+    ImGui_Text(
+      "draws %llu, triangles %llu",
+      (unsigned long long)frame->counters[Application_stats_DrawCalls],
+      (unsigned long long)frame->counters[Application_stats_Triangles]);
+    ImGui_Text(
+      "pipelines %llu, bind groups %llu",
+      (unsigned long long)frame->counters[Application_stats_PipelineSwitches],
+      (unsigned long long)frame->counters[Application_stats_BindGroupSwitches]);
+    ImGui_Text(
+      "buffers %.2f MiB, textures %.2f MiB",
+      (double)frame->gauges[Application_stats_BufferBytes] / (1024.0 * 1024.0),
+      (double)frame->gauges[Application_stats_TextureBytes] / (1024.0 * 1024.0));
+    ImGui_Text(
+      "uploaded %.2f KiB/frame",
+      (double)frame->counters[Application_stats_UploadBytes] / 1024.0);
+    ImGui_Text(
+      "uniforms %llu B in %llu writes",
+      (unsigned long long)frame->counters[Application_stats_UniformBytes],
+      (unsigned long long)frame->counters[Application_stats_UniformWrites]);
+    const Application_memory_Usage usage = Application_memory_usage();
+    if (ImGui_CollapsingHeader("GPU memory", 0)) {
+      for (size_t i = 0; Application_memory_CategoryCount > i; i++) {
+        ImGui_Text(
+          "%-13s %8.2f MiB, peak %8.2f MiB",
+          Application_memory_categoryName(i),
+          (double)usage.live[i] / (1024.0 * 1024.0),
+          (double)usage.peak[i] / (1024.0 * 1024.0));
+      }
+      ImGui_Text(
+        "total %.2f MiB, peak %.2f MiB",
+        (double)usage.total / (1024.0 * 1024.0),
+        (double)usage.totalPeak / (1024.0 * 1024.0));
+      if (usage.budget) {
+        ImGui_Text("budget %.2f MiB", (double)usage.budget / (1024.0 * 1024.0));
+      }
+    }
+  }
+  ImGui_End();
+}
 void Application_gui_render(
   WGPURenderPassEncoder renderPass,
-  Application_Lighting* lightning) {
+  Application_Lighting* lightning,
+  Application_Profiler* profiler,
+  bool overlay[static 1]) {
   cImGui_ImplWGPU_NewFrame();
   cImGui_ImplGlfw_NewFrame();
   ImGui_NewFrame();
-  static float f = 0.0f;
-  static int counter = 0;
-  static bool show_demo_window = true;
-  static bool show_another_window = false;
-  static ImVec4 clear_color = { .x = 0.45f, .y = 0.55f, .z = 0.60f, .w = 1.00f };
-  ImGui_Begin("Hello, world!", 0, 0);
-  ImGui_Text("This is some useful text.");
-  ImGui_Checkbox("Demo Window", &show_demo_window);
-  ImGui_Checkbox("Another Window", &show_another_window);
-  ImGui_SliderFloat("float", &f, 0.0f, 1.0f);
-  ImGui_ColorEdit3("clear color", (float*)&clear_color, 0);
-  if (ImGui_Button("Button")) {
-    counter++;
+  if (*overlay) {
+    overlay_render(profiler);
+  }
+  ImGui_Begin("Lighting", 0, 0);
+  ImGui_Checkbox("Statistics (F1)", overlay);
+  // only the edited members are uploaded
+  Application_dirty* dirty = &lightning->dirty;
+  Application_Lighting_Uniforms* uniforms = &lightning->uniforms;
+  if (ImGui_ColorEdit3("Color #0", uniforms->colors[0].components, 0)) {
+    DIRTY_MARK(dirty, *uniforms, colors[0]);
+  }
+  if (ImGui_DragFloat3("Direction #0", uniforms->directions[0].components)) {
+    DIRTY_MARK(dirty, *uniforms, directions[0]);
+  }
+  if (ImGui_ColorEdit3("Color #1", uniforms->colors[1].components, 0)) {
+    DIRTY_MARK(dirty, *uniforms, colors[1]);
+  }
+  if (ImGui_DragFloat3("Direction #1", uniforms->directions[1].components)) {
+    DIRTY_MARK(dirty, *uniforms, directions[1]);
+  }
+  if (ImGui_SliderFloat("Hardness", &uniforms->hardness, 1.0f, 100.0f)) {
+    DIRTY_MARK(dirty, *uniforms, hardness);
+  }
+  if (ImGui_SliderFloat("Diffusivity", &uniforms->diffusivity, 0.0f, 1.0f)) {
+    DIRTY_MARK(dirty, *uniforms, diffusivity);
+  }
+  if (ImGui_SliderFloat("Specularity", &uniforms->specularity, 0.0f, 1.0f)) {
+    DIRTY_MARK(dirty, *uniforms, specularity);
+  }
+  if (lightning->cluster) {
+    const Application_cluster_Stats stats = Application_cluster_stats(lightning->cluster);
+    ImGui_Text(
+      "%zu point lights binned in %.2f ms on %zu threads",
+      stats.lights,
+      stats.milliseconds,
+      stats.threads);
+    ImGui_Text("%zu cluster references, %zu dropped", stats.references, stats.dropped);
   }
-  ImGui_SameLine();
-  ImGui_Text("counter = %d", counter);
-  ImGuiIO* io = ImGui_GetIO();
-  ImGui_Text(
-    "Application average %.3f ms/frame (%.1f FPS)",
-    1000.0f / io->Framerate,
-    io->Framerate);
-  // ImGui_End();
-  // ImGui_Begin("Lighting", 0, 0);
-  bool update = false;
-  update =
-    ImGui_ColorEdit3("Color #0", lightning->uniforms.colors[0].components, 0) || update;
-  update = ImGui_DragFloat3("Direction #0", lightning->uniforms.directions[0].components)
-           || update;
-  update =
-    ImGui_ColorEdit3("Color #1", lightning->uniforms.colors[1].components, 0) || update;
-  update = ImGui_DragFloat3("Direction #1", lightning->uniforms.directions[1].components)
-           || update;
-  update =
-    ImGui_SliderFloat("Hardness", &lightning->uniforms.hardness, 1.0f, 100.0f) || update;
-  update = ImGui_SliderFloat("Diffusivity", &lightning->uniforms.diffusivity, 0.0f, 1.0f)
-           || update;
-  update = ImGui_SliderFloat("Specularity", &lightning->uniforms.specularity, 0.0f, 1.0f)
-           || update;
-  lightning->update = update;
   ImGui_End();
   ImGui_EndFrame();
   ImGui_Render();
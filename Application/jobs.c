@@ -0,0 +1,477 @@
+#include "jobs.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <string.h>
+#include <assert.h>
+#include <stdalign.h>
+#include <threads.h>
+#ifdef __unix__
+  #include <unistd.h>
+#endif
+
+#define JOBS_LINE  (64)
+#define JOBS_SPINS (64) // rounds without finding a job before a worker sleeps
+
+typedef struct Worker Worker;
+struct Application_jobs_Job {
+    Application_jobs_Function function;
+    void* context;
+    Application_jobs_Counter* counter;
+    Application_jobs_Job* next; // in a waiting list, the main queue or a free list
+    Worker* owner; // the thread that allocated it, it goes back to its free list
+    bool main;
+};
+// the owner pushes and pops at the bottom, the thieves take from the top
+typedef struct {
+    alignas(JOBS_LINE) _Atomic int64_t top;
+    alignas(JOBS_LINE) _Atomic int64_t bottom;
+    _Atomic(Application_jobs_Job*) buffer[JOBS_CAPACITY];
+} Deque;
+struct Worker {
+    Deque deque;
+    Application_jobs* jobs;
+    size_t index; // the main thread is the first
+    thrd_t thread;
+    Application_jobs_Job* free; // the own jobs, for the submissions of this thread
+    // the own jobs that ran on other threads, pushed by them and taken all at once
+    alignas(JOBS_LINE) _Atomic(Application_jobs_Job*) returned;
+    uint32_t random; // state of the victim choice
+    // only written by the owner
+    _Atomic uint64_t executed;
+    _Atomic uint64_t stolen;
+    _Atomic uint64_t overflowed;
+    _Atomic uint64_t allocated;
+};
+struct Application_jobs {
+    Worker workers[JOBS_THREADS];
+    size_t threads;
+    size_t started; // the workers besides the main thread that are running
+    atomic_size_t queued; // jobs in the deques, the workers only sleep without any
+    atomic_size_t sleepers;
+    atomic_bool stop;
+    mtx_t mutex;
+    cnd_t wake;
+    // first in first out, only taken by the main thread
+    mtx_t mainMutex;
+    Application_jobs_Job* mainHead;
+    Application_jobs_Job* mainTail;
+    atomic_size_t mainQueued;
+};
+
+static thread_local Worker* local = 0;
+
+static size_t cores() {
+  long result = 1;
+#ifdef _SC_NPROCESSORS_ONLN
+  result = sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+  return result > 0 ? (size_t)result : 1;
+}
+static void count(_Atomic uint64_t counter[static 1]) {
+  atomic_store_explicit(
+    counter,
+    atomic_load_explicit(counter, memory_order_relaxed) + 1,
+    memory_order_relaxed);
+}
+
+// Chase-Lev with the orderings of Lê, Pop, Cohen and Zappa Nardelli for weak memory
+// models, the buffer does not grow
+static bool deque_push(Deque deque[static 1], Application_jobs_Job job[static 1]) {
+  const int64_t bottom = atomic_load_explicit(&deque->bottom, memory_order_relaxed);
+  const int64_t top = atomic_load_explicit(&deque->top, memory_order_acquire);
+  if (JOBS_CAPACITY <= bottom - top) {
+    return false;
+  }
+  atomic_store_explicit(
+    &deque->buffer[bottom & (JOBS_CAPACITY - 1)],
+    job,
+    memory_order_relaxed);
+  atomic_thread_fence(memory_order_release);
+  atomic_store_explicit(&deque->bottom, bottom + 1, memory_order_relaxed);
+  return true;
+}
+static Application_jobs_Job* deque_pop(Deque deque[static 1]) {
+  const int64_t bottom = atomic_load_explicit(&deque->bottom, memory_order_relaxed) - 1;
+  atomic_store_explicit(&deque->bottom, bottom, memory_order_relaxed);
+  atomic_thread_fence(memory_order_seq_cst);
+  int64_t top = atomic_load_explicit(&deque->top, memory_order_relaxed);
+  Application_jobs_Job* result = 0;
+  if (top <= bottom) {
+    result = atomic_load_explicit(
+      &deque->buffer[bottom & (JOBS_CAPACITY - 1)],
+      memory_order_relaxed);
+    // the last job goes to whoever moves the top first
+    if (top == bottom) {
+      if (!atomic_compare_exchange_strong_explicit(
+            &deque->top,
+            &top,
+            top + 1,
+            memory_order_seq_cst,
+            memory_order_relaxed)) {
+        result = 0;
+      }
+      atomic_store_explicit(&deque->bottom, bottom + 1, memory_order_relaxed);
+    }
+  }
+  else {
+    atomic_store_explicit(&deque->bottom, bottom + 1, memory_order_relaxed);
+  }
+  return result;
+}
+static Application_jobs_Job* deque_steal(Deque deque[static 1]) {
+  int64_t top = atomic_load_explicit(&deque->top, memory_order_acquire);
+  atomic_thread_fence(memory_order_seq_cst);
+  const int64_t bottom = atomic_load_explicit(&deque->bottom, memory_order_acquire);
+  Application_jobs_Job* result = 0;
+  if (top < bottom) {
+    result = atomic_load_explicit(
+      &deque->buffer[top & (JOBS_CAPACITY - 1)],
+      memory_order_relaxed);
+    if (!atomic_compare_exchange_strong_explicit(
+          &deque->top,
+          &top,
+          top + 1,
+          memory_order_seq_cst,
+          memory_order_relaxed)) {
+      result = 0;
+    }
+  }
+  return result;
+}
+
+static void counter_lock(Application_jobs_Counter counter[static 1]) {
+  while (atomic_flag_test_and_set_explicit(&counter->lock, memory_order_acquire)) {
+    thrd_yield();
+  }
+}
+static void counter_unlock(Application_jobs_Counter counter[static 1]) {
+  atomic_flag_clear_explicit(&counter->lock, memory_order_release);
+}
+static void job_run(
+  Application_jobs jobs[static 1],
+  Worker self[static 1],
+  Application_jobs_Job job[static 1]);
+static void job_schedule(
+  Application_jobs jobs[static 1],
+  Worker self[static 1],
+  Application_jobs_Job job[static 1]) {
+  if (job->main) {
+    job->next = 0;
+    mtx_lock(&jobs->mainMutex);
+    if (jobs->mainTail) {
+      jobs->mainTail->next = job;
+    }
+    else {
+      jobs->mainHead = job;
+    }
+    jobs->mainTail = job;
+    atomic_fetch_add(&jobs->mainQueued, 1);
+    mtx_unlock(&jobs->mainMutex);
+    return;
+  }
+  // counted before the push so that a thief never takes the count below zero
+  atomic_fetch_add(&jobs->queued, 1);
+  if (!deque_push(&self->deque, job)) {
+    atomic_fetch_sub(&jobs->queued, 1);
+    count(&self->overflowed);
+    job_run(jobs, self, job);
+    return;
+  }
+  // a sleeper counted itself before it looked at the queued jobs
+  if (atomic_load(&jobs->sleepers)) {
+    mtx_lock(&jobs->mutex);
+    cnd_signal(&jobs->wake);
+    mtx_unlock(&jobs->mutex);
+  }
+}
+// the count is only taken to zero under the lock, so that the waiting list is emptied
+// before a wait sees zero and the counter is not touched once the wait has returned
+static void counter_signal(
+  Application_jobs jobs[static 1],
+  Worker self[static 1],
+  Application_jobs_Counter counter[static 1]) {
+  size_t pending = atomic_load_explicit(&counter->pending, memory_order_relaxed);
+  while (1 < pending
+         && !atomic_compare_exchange_weak_explicit(
+           &counter->pending,
+           &pending,
+           pending - 1,
+           memory_order_release,
+           memory_order_relaxed)) {}
+  if (1 < pending) {
+    return;
+  }
+  Application_jobs_Job* waiting = 0;
+  counter_lock(counter);
+  if (1 == atomic_fetch_sub_explicit(&counter->pending, 1, memory_order_acq_rel)) {
+    waiting = counter->waiting;
+    counter->waiting = 0;
+  }
+  counter_unlock(counter);
+  while (waiting) {
+    Application_jobs_Job* next = waiting->next;
+    job_schedule(jobs, self, waiting);
+    waiting = next;
+  }
+}
+static void job_run(
+  Application_jobs jobs[static 1],
+  Worker self[static 1],
+  Application_jobs_Job job[static 1]) {
+  job->function(job->context);
+  Application_jobs_Counter* counter = job->counter;
+  Worker* owner = job->owner;
+  if (owner == self) {
+    job->next = self->free;
+    self->free = job;
+  }
+  else {
+    // the owner may reuse it as soon as it is pushed
+    job->next = atomic_load_explicit(&owner->returned, memory_order_relaxed);
+    while (!atomic_compare_exchange_weak_explicit(
+             &owner->returned,
+             &job->next,
+             job,
+             memory_order_release,
+             memory_order_relaxed)) {}
+  }
+  count(&self->executed);
+  if (counter) {
+    counter_signal(jobs, self, counter);
+  }
+}
+static Application_jobs_Job* main_take(Application_jobs jobs[static 1]) {
+  if (!atomic_load_explicit(&jobs->mainQueued, memory_order_acquire)) {
+    return 0;
+  }
+  mtx_lock(&jobs->mainMutex);
+  Application_jobs_Job* result = jobs->mainHead;
+  if (result) {
+    jobs->mainHead = result->next;
+    jobs->mainTail = jobs->mainHead ? jobs->mainTail : 0;
+    atomic_fetch_sub(&jobs->mainQueued, 1);
+  }
+  mtx_unlock(&jobs->mainMutex);
+  return result;
+}
+// the own deque first, then the others from a random one on
+static Application_jobs_Job* job_find(
+  Application_jobs jobs[static 1],
+  Worker self[static 1]) {
+  Application_jobs_Job* result = deque_pop(&self->deque);
+  if (!result) {
+    self->random ^= self->random << 13;
+    self->random ^= self->random >> 17;
+    self->random ^= self->random << 5;
+    const size_t start = self->random % jobs->threads;
+    for (size_t i = 0; !result && jobs->threads > i; i++) {
+      const size_t victim = (start + i) % jobs->threads;
+      if (victim != self->index && (result = deque_steal(&jobs->workers[victim].deque))) {
+        count(&self->stolen);
+      }
+    }
+  }
+  if (result) {
+    atomic_fetch_sub(&jobs->queued, 1);
+  }
+  return result;
+}
+// runs a single job, the main thread takes its own ones first
+static bool help(Application_jobs jobs[static 1], Worker self[static 1]) {
+  Application_jobs_Job* job = self->index ? 0 : main_take(jobs);
+  if (job || (job = job_find(jobs, self))) {
+    job_run(jobs, self, job);
+  }
+  return job;
+}
+static int worker_run(void* argument) {
+  Worker* self = local = argument;
+  Application_jobs* jobs = self->jobs;
+  size_t spins = 0;
+  while (!atomic_load_explicit(&jobs->stop, memory_order_relaxed)) {
+    if (help(jobs, self)) {
+      spins = 0;
+    }
+    else if (JOBS_SPINS > ++spins) {
+      thrd_yield();
+    }
+    else {
+      spins = 0;
+      mtx_lock(&jobs->mutex);
+      atomic_fetch_add(&jobs->sleepers, 1);
+      while (!atomic_load(&jobs->stop) && !atomic_load(&jobs->queued)) {
+        cnd_wait(&jobs->wake, &jobs->mutex);
+      }
+      atomic_fetch_sub(&jobs->sleepers, 1);
+      mtx_unlock(&jobs->mutex);
+    }
+  }
+  return 0;
+}
+
+Application_jobs* Application_jobs_create(size_t threads) {
+  Application_jobs* result = aligned_alloc(JOBS_LINE, sizeof(*result));
+  if (!result) {
+    perror("Job system allocation failed");
+    return 0;
+  }
+  memset(result, 0, sizeof(*result));
+  threads = threads ? threads : cores();
+  result->threads = threads > JOBS_THREADS ? JOBS_THREADS : threads;
+  mtx_init(&result->mutex, mtx_plain);
+  cnd_init(&result->wake);
+  mtx_init(&result->mainMutex, mtx_plain);
+  for (size_t i = 0; result->threads > i; i++) {
+    result->workers[i].jobs = result;
+    result->workers[i].index = i;
+    result->workers[i].random = 2654435761u * (uint32_t)(i + 1);
+  }
+  local = &result->workers[0];
+  // the deques of the workers that could not be started stay empty
+  for (size_t i = 1; result->threads > i; i++) {
+    Worker* worker = &result->workers[i];
+    if (thrd_create(&worker->thread, worker_run, worker) != thrd_success) {
+      perror("Job thread creation failed");
+      break;
+    }
+    result->started++;
+  }
+  return result;
+}
+void Application_jobs_destroy(Application_jobs* jobs) {
+  if (jobs) {
+    mtx_lock(&jobs->mutex);
+    atomic_store(&jobs->stop, true);
+    cnd_broadcast(&jobs->wake);
+    mtx_unlock(&jobs->mutex);
+    for (size_t i = 1; jobs->started >= i; i++) {
+      thrd_join(jobs->workers[i].thread, 0);
+    }
+    for (size_t i = 0; jobs->threads > i; i++) {
+      Worker* worker = &jobs->workers[i];
+      Application_jobs_Job* lists[] = { worker->free, atomic_load(&worker->returned) };
+      for (size_t l = 0; 2 > l; l++) {
+        while (lists[l]) {
+          Application_jobs_Job* next = lists[l]->next;
+          free(lists[l]);
+          lists[l] = next;
+        }
+      }
+    }
+    mtx_destroy(&jobs->mainMutex);
+    cnd_destroy(&jobs->wake);
+    mtx_destroy(&jobs->mutex);
+    if (local && local->jobs == jobs) {
+      local = 0;
+    }
+    free(jobs);
+  }
+}
+static void submit(
+  Application_jobs jobs[static 1],
+  Application_jobs_Function function,
+  void* context,
+  Application_jobs_Counter* dependency,
+  Application_jobs_Counter* counter,
+  bool main) {
+  Worker* self = local;
+  assert(self && self->jobs == jobs);
+  if (!self->free) {
+    self->free = atomic_exchange_explicit(&self->returned, 0, memory_order_acquire);
+  }
+  Application_jobs_Job* job = self->free;
+  if (job) {
+    self->free = job->next;
+  }
+  else if ((job = malloc(sizeof(*job)))) {
+    count(&self->allocated);
+  }
+  else {
+    // without memory the job runs here after its dependency
+    perror("Job allocation failed");
+    if (dependency) {
+      Application_jobs_wait(jobs, dependency);
+    }
+    function(context);
+    return;
+  }
+  *job = (Application_jobs_Job){
+    .function = function,
+    .context = context,
+    .counter = counter,
+    .next = 0,
+    .owner = self,
+    .main = main,
+  };
+  if (counter) {
+    atomic_fetch_add_explicit(&counter->pending, 1, memory_order_relaxed);
+  }
+  if (dependency) {
+    counter_lock(dependency);
+    const bool pending = atomic_load_explicit(&dependency->pending, memory_order_acquire);
+    if (pending) {
+      job->next = dependency->waiting;
+      dependency->waiting = job;
+    }
+    counter_unlock(dependency);
+    if (pending) {
+      return;
+    }
+  }
+  job_schedule(jobs, self, job);
+}
+void Application_jobs_submit(
+  Application_jobs* jobs,
+  Application_jobs_Function function,
+  void* context,
+  Application_jobs_Counter* dependency,
+  Application_jobs_Counter* counter) {
+  submit(jobs, function, context, dependency, counter, false);
+}
+void Application_jobs_submitMain(
+  Application_jobs* jobs,
+  Application_jobs_Function function,
+  void* context,
+  Application_jobs_Counter* dependency,
+  Application_jobs_Counter* counter) {
+  submit(jobs, function, context, dependency, counter, true);
+}
+void Application_jobs_wait(
+  Application_jobs* jobs,
+  Application_jobs_Counter counter[static 1]) {
+  Worker* self = local;
+  assert(self && self->jobs == jobs);
+  while (atomic_load_explicit(&counter->pending, memory_order_acquire)) {
+    if (!help(jobs, self)) {
+      thrd_yield();
+    }
+  }
+  // the last job of the counter may still hold the lock
+  counter_lock(counter);
+  counter_unlock(counter);
+}
+size_t Application_jobs_poll(Application_jobs* jobs) {
+  Worker* self = local;
+  assert(self && !self->index && self->jobs == jobs);
+  // the jobs these ones submit for the main thread wait for the next poll
+  const size_t ready = atomic_load(&jobs->mainQueued);
+  size_t result = 0;
+  Application_jobs_Job* job = 0;
+  while (ready > result && (job = main_take(jobs))) {
+    job_run(jobs, self, job);
+    result++;
+  }
+  return result;
+}
+Application_jobs_Stats Application_jobs_stats(const Application_jobs* jobs) {
+  Application_jobs_Stats result = { .threads = jobs->started + 1 };
+  for (size_t i = 0; jobs->threads > i; i++) {
+    const Worker* worker = &jobs->workers[i];
+    result.executed += atomic_load_explicit(&worker->executed, memory_order_relaxed);
+    result.stolen += atomic_load_explicit(&worker->stolen, memory_order_relaxed);
+    result.overflowed += atomic_load_explicit(&worker->overflowed, memory_order_relaxed);
+    result.allocated += atomic_load_explicit(&worker->allocated, memory_order_relaxed);
+  }
+  return result;
+}
@@ -0,0 +1,62 @@
+#ifndef jobs_H_
+#define jobs_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdatomic.h>
+
+// Work stealing job system: every thread owns a Chase-Lev deque it pushes and pops at
+// the bottom while the idle threads steal from the top of the others. A counter counts
+// the jobs submitted with it until they have run, a job can wait for a counter before it
+// is scheduled and a thread waiting for a counter runs jobs in the meantime instead of
+// blocking. The jobs submitted for the main thread, the one calling into WebGPU, only run
+// in its waits and polls. Jobs are submitted from the main thread and from other jobs.
+#define JOBS_THREADS  (64)
+#define JOBS_CAPACITY (4096) // per deque, a power of two, further jobs run inline
+
+typedef void (*Application_jobs_Function)(void* context);
+typedef struct Application_jobs_Job Application_jobs_Job;
+// zero initialized, it is reused once it was waited on
+typedef struct {
+    atomic_size_t pending;
+    atomic_flag lock;
+    Application_jobs_Job* waiting; // scheduled when pending reaches zero
+} Application_jobs_Counter;
+typedef struct {
+    size_t threads;
+    uint64_t executed; // since the creation
+    uint64_t stolen;
+    uint64_t overflowed; // run at submission because the deque was full
+    uint64_t allocated; // jobs, they return to the thread that submitted them
+} Application_jobs_Stats;
+
+typedef struct Application_jobs Application_jobs;
+
+// the threads include the calling one, which becomes the main thread, zero uses every
+// core
+Application_jobs* Application_jobs_create(size_t threads);
+// every submitted job must have run
+void Application_jobs_destroy(Application_jobs* jobs);
+// the job runs once the dependency reads zero, the counter counts it until it has run,
+// both may be null
+void Application_jobs_submit(
+  Application_jobs* jobs,
+  Application_jobs_Function function,
+  void* context,
+  Application_jobs_Counter* dependency,
+  Application_jobs_Counter* counter);
+void Application_jobs_submitMain(
+  Application_jobs* jobs,
+  Application_jobs_Function function,
+  void* context,
+  Application_jobs_Counter* dependency,
+  Application_jobs_Counter* counter);
+// runs jobs until the counter reads zero
+void Application_jobs_wait(
+  Application_jobs* jobs,
+  Application_jobs_Counter counter[static 1]);
+// runs the main thread jobs that are ready, returns how many
+size_t Application_jobs_poll(Application_jobs* jobs);
+Application_jobs_Stats Application_jobs_stats(const Application_jobs* jobs);
+
+#endif // jobs_H_
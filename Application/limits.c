@@ -0,0 +1,125 @@
+#include "limits.h"
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include "webgpu.h"
+
+typedef struct {
+    const char* name;
+    size_t offset;
+    size_t size;
+    uint64_t defaultValue;
+} Limit;
+
+#define LIMIT(name, defaultValue) \
+  { #name, offsetof(WGPULimits, name), sizeof(((WGPULimits*)0)->name), defaultValue }
+
+// only the maximum limits, the alignments are taken from the adapter as they are
+static const Limit limits[] = {
+  LIMIT(maxTextureDimension1D, 8192),
+  LIMIT(maxTextureDimension2D, 8192),
+  LIMIT(maxTextureDimension3D, 2048),
+  LIMIT(maxTextureArrayLayers, 256),
+  LIMIT(maxBindGroups, 4),
+  LIMIT(maxBindGroupsPlusVertexBuffers, 24),
+  LIMIT(maxBindingsPerBindGroup, 1000),
+  LIMIT(maxDynamicUniformBuffersPerPipelineLayout, 8),
+  LIMIT(maxDynamicStorageBuffersPerPipelineLayout, 4),
+  LIMIT(maxSampledTexturesPerShaderStage, 16),
+  LIMIT(maxSamplersPerShaderStage, 16),
+  LIMIT(maxStorageBuffersPerShaderStage, 8),
+  LIMIT(maxStorageTexturesPerShaderStage, 4),
+  LIMIT(maxUniformBuffersPerShaderStage, 12),
+  LIMIT(maxUniformBufferBindingSize, 65536),
+  LIMIT(maxStorageBufferBindingSize, 134217728),
+  LIMIT(maxVertexBuffers, 8),
+  LIMIT(maxBufferSize, 268435456),
+  LIMIT(maxVertexAttributes, 16),
+  LIMIT(maxVertexBufferArrayStride, 2048),
+  LIMIT(maxInterStageShaderComponents, 60),
+  LIMIT(maxInterStageShaderVariables, 16),
+  LIMIT(maxColorAttachments, 8),
+  LIMIT(maxColorAttachmentBytesPerSample, 32),
+  LIMIT(maxComputeWorkgroupStorageSize, 16384),
+  LIMIT(maxComputeInvocationsPerWorkgroup, 256),
+  LIMIT(maxComputeWorkgroupSizeX, 256),
+  LIMIT(maxComputeWorkgroupSizeY, 256),
+  LIMIT(maxComputeWorkgroupSizeZ, 64),
+  LIMIT(maxComputeWorkgroupsPerDimension, 65535),
+};
+
+static uint64_t limitGet(const WGPULimits source[static 1], Limit limit) {
+  uint64_t result = 0;
+  if (limit.size == sizeof(uint32_t)) {
+    uint32_t value = 0;
+    memcpy(&value, (const char*)source + limit.offset, sizeof(value));
+    result = value;
+  }
+  else {
+    memcpy(&result, (const char*)source + limit.offset, sizeof(result));
+  }
+  return result;
+}
+static void limitSet(WGPULimits destination[static 1], Limit limit, uint64_t value) {
+  if (limit.size == sizeof(uint32_t)) {
+    const uint32_t narrow = value > UINT32_MAX ? UINT32_MAX : (uint32_t)value;
+    memcpy((char*)destination + limit.offset, &narrow, sizeof(narrow));
+  }
+  else {
+    memcpy((char*)destination + limit.offset, &value, sizeof(value));
+  }
+}
+// the 32 bit limits saturate like the requests do
+void Application_limits_require32(uint32_t limit[static 1], uint64_t value) {
+  const uint32_t narrow = value > UINT32_MAX ? UINT32_MAX : (uint32_t)value;
+  *limit = narrow > *limit ? narrow : *limit;
+}
+void Application_limits_require64(uint64_t limit[static 1], uint64_t value) {
+  *limit = value > *limit ? value : *limit;
+}
+WGPULimits Application_limits_make() {
+  WGPULimits result = { 0 };
+  return result;
+}
+WGPULimits Application_limits_defaults() {
+  WGPULimits result = { .minUniformBufferOffsetAlignment = 256,
+                        .minStorageBufferOffsetAlignment = 256 };
+  for (size_t i = 0; sizeof(limits) / sizeof(*limits) > i; i++) {
+    limitSet(&result, limits[i], limits[i].defaultValue);
+  }
+  return result;
+}
+// every requirement has to fit the adapter, the request is the requirement raised to the
+// default and clamped to the adapter so later features do not need a new negotiation
+bool Application_limits_negotiate(
+  const WGPULimits required[static 1],
+  const WGPULimits supported[static 1],
+  WGPULimits result[static 1],
+  FILE* report) {
+  bool success = true;
+  *result = Application_limits_make();
+  for (size_t i = 0; sizeof(limits) / sizeof(*limits) > i; i++) {
+    const uint64_t requirement = limitGet(required, limits[i]);
+    const uint64_t available = limitGet(supported, limits[i]);
+    if (requirement > available) {
+      if (success && report) {
+        fprintf(report, "The adapter does not satisfy the scene requirements:\n");
+      }
+      if (report) {
+        fprintf(
+          report,
+          "- %s: required %llu, supported %llu\n",
+          limits[i].name,
+          (unsigned long long)requirement,
+          (unsigned long long)available);
+      }
+      success = false;
+    }
+    const uint64_t request =
+      requirement > limits[i].defaultValue ? requirement : limits[i].defaultValue;
+    limitSet(result, limits[i], request < available ? request : available);
+  }
+  result->minUniformBufferOffsetAlignment = supported->minUniformBufferOffsetAlignment;
+  result->minStorageBufferOffsetAlignment = supported->minStorageBufferOffsetAlignment;
+  return success;
+}
@@ -0,0 +1,30 @@
+#ifndef limits_H_
+#define limits_H_
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "webgpu.h"
+
+// Device limits are negotiated from what the scene needs instead of fixed numbers.
+// Requirements are collected in a WGPULimits where zero means "not needed", then
+// checked against the adapter and raised to the WebGPU defaults where possible.
+// raises the limit to the value, both are evaluated once
+#define LIMITS_REQUIRE(limit, value)              \
+  _Generic(                                       \
+    (limit),                                      \
+    uint32_t: Application_limits_require32,       \
+    uint64_t: Application_limits_require64)(&(limit), (value))
+
+void Application_limits_require32(uint32_t limit[static 1], uint64_t value);
+void Application_limits_require64(uint64_t limit[static 1], uint64_t value);
+WGPULimits Application_limits_make();
+// the default limits every WebGPU implementation guarantees
+WGPULimits Application_limits_defaults();
+bool Application_limits_negotiate(
+  const WGPULimits required[static 1],
+  const WGPULimits supported[static 1],
+  WGPULimits result[static 1],
+  FILE* report);
+
+#endif // limits_H_
@@ -0,0 +1,246 @@
+#include "memory.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <threads.h>
+#include "webgpu.h"
+#include "stats.h"
+
+typedef struct {
+    void* handle;
+    char label[64]; // copied, descriptors labels do not have to outlive the call
+    uint64_t size;
+    Application_memory_Category category;
+} Record;
+
+static struct {
+    once_flag once;
+    mtx_t lock;
+    Record* records;
+    size_t count;
+    size_t capacity;
+    Application_memory_Usage usage;
+} tracker = { .once = ONCE_FLAG_INIT };
+
+static void tracker_init() {
+  mtx_init(&tracker.lock, mtx_plain);
+}
+static void track(
+  void* handle,
+  const char* label,
+  uint64_t size,
+  Application_memory_Category category) {
+  call_once(&tracker.once, tracker_init);
+  mtx_lock(&tracker.lock);
+  if (tracker.count == tracker.capacity) {
+    const size_t capacity = tracker.capacity ? 2 * tracker.capacity : 64;
+    Record* records = realloc(tracker.records, capacity * sizeof(*records));
+    if (records) {
+      tracker.records = records;
+      tracker.capacity = capacity;
+    }
+  }
+  if (tracker.capacity > tracker.count) {
+    Record* record = &tracker.records[tracker.count++];
+    *record = (Record){
+      .handle = handle,
+      .size = size,
+      .category = category,
+    };
+    if (label) {
+      strncpy(record->label, label, sizeof(record->label) - 1);
+    }
+  }
+  Application_memory_Usage* usage = &tracker.usage;
+  usage->live[category] += size;
+  usage->allocations[category]++;
+  usage->peak[category] =
+    usage->live[category] > usage->peak[category] ? usage->live[category]
+                                                   : usage->peak[category];
+  usage->total += size;
+  usage->totalPeak = usage->total > usage->totalPeak ? usage->total : usage->totalPeak;
+  mtx_unlock(&tracker.lock);
+}
+// returns the category of the released record, or the count for untracked handles
+static Application_memory_Category untrack(void* handle, uint64_t size[static 1]) {
+  Application_memory_Category result = Application_memory_CategoryCount;
+  call_once(&tracker.once, tracker_init);
+  mtx_lock(&tracker.lock);
+  for (size_t i = 0; tracker.count > i; i++) {
+    if (tracker.records[i].handle == handle) {
+      result = tracker.records[i].category;
+      *size = tracker.records[i].size;
+      tracker.records[i] = tracker.records[--tracker.count];
+      tracker.usage.live[result] -= *size;
+      tracker.usage.total -= *size;
+      break;
+    }
+  }
+  mtx_unlock(&tracker.lock);
+  return result;
+}
+static Application_stats_Gauge gauge(Application_memory_Category category) {
+  return category == Application_memory_Texture || category == Application_memory_RenderTarget
+           ? Application_stats_TextureBytes
+           : Application_stats_BufferBytes;
+}
+WGPUBuffer Application_memory_Buffer_create(
+  WGPUDevice device,
+  const WGPUBufferDescriptor descriptor[static 1],
+  Application_memory_Category category) {
+  WGPUBuffer result = wgpuDeviceCreateBuffer(device, descriptor);
+  if (result) {
+    track(result, descriptor->label, descriptor->size, category);
+    Application_stats_gaugeAdd(gauge(category), descriptor->size);
+  }
+  return result;
+}
+void Application_memory_Buffer_destroy(WGPUBuffer buffer) {
+  if (buffer) {
+    uint64_t size = 0;
+    const Application_memory_Category category = untrack(buffer, &size);
+    if (category != Application_memory_CategoryCount) {
+      Application_stats_gaugeAdd(gauge(category), -(int64_t)size);
+    }
+    wgpuBufferDestroy(buffer);
+    wgpuBufferRelease(buffer);
+  }
+}
+static uint64_t texelSize(WGPUTextureFormat format) {
+  switch (format) {
+    case WGPUTextureFormat_R8Unorm:
+      return 1;
+    case WGPUTextureFormat_RG8Unorm:
+      return 2;
+    case WGPUTextureFormat_RGBA16Float:
+      return 8;
+    case WGPUTextureFormat_RGBA32Float:
+      return 16;
+    default:
+      return 4;
+  }
+}
+uint64_t Application_memory_Texture_size(const WGPUTextureDescriptor descriptor[static 1]) {
+  uint64_t result = 0;
+  uint64_t width = descriptor->size.width;
+  uint64_t height = descriptor->size.height;
+  const uint64_t texel = texelSize(descriptor->format) * descriptor->sampleCount;
+  for (uint32_t level = 0; descriptor->mipLevelCount > level; level++) {
+    result += width * height * descriptor->size.depthOrArrayLayers * texel;
+    width = width > 1 ? width / 2 : 1;
+    height = height > 1 ? height / 2 : 1;
+  }
+  return result;
+}
+WGPUTexture Application_memory_Texture_create(
+  WGPUDevice device,
+  const WGPUTextureDescriptor descriptor[static 1],
+  Application_memory_Category category) {
+  WGPUTexture result = wgpuDeviceCreateTexture(device, descriptor);
+  if (result) {
+    const uint64_t size = Application_memory_Texture_size(descriptor);
+    track(result, descriptor->label, size, category);
+    Application_stats_gaugeAdd(gauge(category), size);
+  }
+  return result;
+}
+void Application_memory_Texture_destroy(WGPUTexture texture) {
+  if (texture) {
+    uint64_t size = 0;
+    const Application_memory_Category category = untrack(texture, &size);
+    if (category != Application_memory_CategoryCount) {
+      Application_stats_gaugeAdd(gauge(category), -(int64_t)size);
+    }
+    wgpuTextureDestroy(texture);
+    wgpuTextureRelease(texture);
+  }
+}
+void Application_memory_budgetSet(uint64_t bytes) {
+  call_once(&tracker.once, tracker_init);
+  mtx_lock(&tracker.lock);
+  tracker.usage.budget = bytes;
+  mtx_unlock(&tracker.lock);
+}
+// bytes left before the budget is exceeded, UINT64_MAX without a budget
+uint64_t Application_memory_available() {
+  const Application_memory_Usage usage = Application_memory_usage();
+  uint64_t result = UINT64_MAX;
+  if (usage.budget) {
+    result = usage.budget > usage.total ? usage.budget - usage.total : 0;
+  }
+  return result;
+}
+Application_memory_Usage Application_memory_usage() {
+  call_once(&tracker.once, tracker_init);
+  mtx_lock(&tracker.lock);
+  const Application_memory_Usage result = tracker.usage;
+  mtx_unlock(&tracker.lock);
+  return result;
+}
+const char* Application_memory_categoryName(Application_memory_Category category) {
+  switch (category) {
+    case Application_memory_Vertex:
+      return "vertex";
+    case Application_memory_Index:
+      return "index";
+    case Application_memory_Uniform:
+      return "uniform";
+    case Application_memory_Storage:
+      return "storage";
+    case Application_memory_Texture:
+      return "texture";
+    case Application_memory_RenderTarget:
+      return "render target";
+    case Application_memory_Readback:
+      return "readback";
+    case Application_memory_CategoryCount:
+      break;
+  }
+  return "unknown";
+}
+size_t Application_memory_leaks(FILE* output) {
+  call_once(&tracker.once, tracker_init);
+  mtx_lock(&tracker.lock);
+  const size_t result = tracker.count;
+  for (size_t i = 0; tracker.count > i; i++) {
+    fprintf(
+      output,
+      "Leaked %s allocation \"%s\": %llu bytes\n",
+      Application_memory_categoryName(tracker.records[i].category),
+      tracker.records[i].label,
+      (unsigned long long)tracker.records[i].size);
+  }
+  mtx_unlock(&tracker.lock);
+  return result;
+}
+void Application_memory_report(FILE* output) {
+  const Application_memory_Usage usage = Application_memory_usage();
+  fprintf(output, "{\n  \"total\": %llu,\n", (unsigned long long)usage.total);
+  fprintf(output, "  \"peak\": %llu,\n", (unsigned long long)usage.totalPeak);
+  fprintf(output, "  \"budget\": %llu,\n", (unsigned long long)usage.budget);
+  fprintf(output, "  \"categories\": [");
+  for (size_t i = 0; Application_memory_CategoryCount > i; i++) {
+    fprintf(
+      output,
+      "%s\n    {\"name\": \"%s\", \"live\": %llu, \"peak\": %llu, \"allocations\": %zu}",
+      i ? "," : "",
+      Application_memory_categoryName(i),
+      (unsigned long long)usage.live[i],
+      (unsigned long long)usage.peak[i],
+      usage.allocations[i]);
+  }
+  fprintf(output, "\n  ],\n  \"leaks\": [");
+  mtx_lock(&tracker.lock);
+  for (size_t i = 0; tracker.count > i; i++) {
+    fprintf(
+      output,
+      "%s\n    {\"category\": \"%s\", \"label\": \"%s\", \"size\": %llu}",
+      i ? "," : "",
+      Application_memory_categoryName(tracker.records[i].category),
+      tracker.records[i].label,
+      (unsigned long long)tracker.records[i].size);
+  }
+  mtx_unlock(&tracker.lock);
+  fprintf(output, "\n  ]\n}\n");
+}
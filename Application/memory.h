@@ -0,0 +1,49 @@
+#ifndef memory_H_
+#define memory_H_
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "webgpu.h"
+
+// Every buffer and texture of the application is created and destroyed through here,
+// so live and peak sizes are known per category.
+typedef enum {
+  Application_memory_Vertex,
+  Application_memory_Index,
+  Application_memory_Uniform,
+  Application_memory_Storage,
+  Application_memory_Texture,
+  Application_memory_RenderTarget,
+  Application_memory_Readback,
+  Application_memory_CategoryCount,
+} Application_memory_Category;
+
+typedef struct {
+    uint64_t live[Application_memory_CategoryCount];
+    uint64_t peak[Application_memory_CategoryCount];
+    size_t allocations[Application_memory_CategoryCount];
+    uint64_t total;
+    uint64_t totalPeak;
+    uint64_t budget; // zero means unlimited
+} Application_memory_Usage;
+
+WGPUBuffer Application_memory_Buffer_create(
+  WGPUDevice device,
+  const WGPUBufferDescriptor descriptor[static 1],
+  Application_memory_Category category);
+void Application_memory_Buffer_destroy(WGPUBuffer buffer);
+WGPUTexture Application_memory_Texture_create(
+  WGPUDevice device,
+  const WGPUTextureDescriptor descriptor[static 1],
+  Application_memory_Category category);
+void Application_memory_Texture_destroy(WGPUTexture texture);
+uint64_t Application_memory_Texture_size(const WGPUTextureDescriptor descriptor[static 1]);
+void Application_memory_budgetSet(uint64_t bytes);
+uint64_t Application_memory_available();
+Application_memory_Usage Application_memory_usage();
+const char* Application_memory_categoryName(Application_memory_Category category);
+size_t Application_memory_leaks(FILE* output);
+void Application_memory_report(FILE* output);
+
+#endif // memory_H_
@@ -0,0 +1,695 @@
+#include "preprocessor.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <ctype.h>
+#include <errno.h>
+
+#define PREPROCESSOR_MACROS    (128)
+#define PREPROCESSOR_FILES     (64)
+#define PREPROCESSOR_NESTING   (32)
+#define PREPROCESSOR_EXPANSION (8)
+#define PREPROCESSOR_NAME      (64)
+#define PREPROCESSOR_VALUE     (256)
+#define PREPROCESSOR_PATH      (1024)
+
+typedef struct {
+    char* data;
+    size_t length;
+    size_t capacity;
+} Text;
+typedef struct {
+    char name[PREPROCESSOR_NAME];
+    char value[PREPROCESSOR_VALUE];
+} Macro;
+typedef struct {
+    bool active; // the lines of the current branch are emitted
+    bool taken; // a branch of this conditional was already active
+    bool parent; // the enclosing block is active
+    bool elsed;
+} Condition;
+typedef struct {
+    Text output;
+    Macro macros[PREPROCESSOR_MACROS];
+    size_t macroCount;
+    char files[PREPROCESSOR_FILES][PREPROCESSOR_PATH];
+    size_t fileCount;
+    FILE* errors;
+    bool failed;
+    // position for the messages
+    const char* path;
+    size_t line;
+} State;
+
+static void fail(State state[static 1], const char* message, const char* detail) {
+  if (state->errors) {
+    fprintf(
+      state->errors,
+      "%s:%zu: %s%s%s\n",
+      state->path,
+      state->line,
+      message,
+      detail ? " " : "",
+      detail ? detail : "");
+  }
+  state->failed = true;
+}
+static void append(State state[static 1], const char* data, size_t length) {
+  Text* text = &state->output;
+  if (text->length + length + 1 > text->capacity) {
+    size_t capacity = text->capacity ? text->capacity : 4096;
+    while (text->length + length + 1 > capacity) {
+      capacity *= 2;
+    }
+    char* grown = realloc(text->data, capacity);
+    if (!grown) {
+      fail(state, "out of memory", 0);
+      return;
+    }
+    text->data = grown;
+    text->capacity = capacity;
+  }
+  memcpy(text->data + text->length, data, length);
+  text->length += length;
+  text->data[text->length] = '\0';
+}
+static Macro* macroFind(State state[static 1], const char* name, size_t length) {
+  Macro* result = 0;
+  for (size_t i = 0; !result && state->macroCount > i; i++) {
+    if (strlen(state->macros[i].name) == length
+        && !strncmp(state->macros[i].name, name, length)) {
+      result = &state->macros[i];
+    }
+  }
+  return result;
+}
+static void macroDefine(State state[static 1], const char* name, const char* value) {
+  const size_t length = strlen(name);
+  Macro* macro = macroFind(state, name, length);
+  if (!macro && PREPROCESSOR_MACROS > state->macroCount) {
+    macro = &state->macros[state->macroCount++];
+  }
+  if (!macro || length >= PREPROCESSOR_NAME || strlen(value) >= PREPROCESSOR_VALUE) {
+    fail(state, "cannot define", name);
+    return;
+  }
+  strcpy(macro->name, name);
+  strcpy(macro->value, value);
+}
+static void macroUndefine(State state[static 1], const char* name) {
+  Macro* macro = macroFind(state, name, strlen(name));
+  if (macro) {
+    *macro = state->macros[--state->macroCount];
+  }
+}
+static bool isIdentifierStart(char character) {
+  return isalpha((unsigned char)character) || character == '_';
+}
+static bool isIdentifier(char character) {
+  return isalnum((unsigned char)character) || character == '_';
+}
+// replaces the defined identifiers, comments are left alone
+static void expand(State state[static 1], const char* line, size_t length, size_t depth) {
+  size_t i = 0;
+  while (length > i) {
+    if (line[i] == '/' && length > i + 1 && line[i + 1] == '/') {
+      append(state, line + i, length - i);
+      return;
+    }
+    if (isIdentifierStart(line[i])) {
+      size_t end = i;
+      while (length > end && isIdentifier(line[end])) {
+        end++;
+      }
+      Macro* macro = macroFind(state, line + i, end - i);
+      if (!macro) {
+        append(state, line + i, end - i);
+      }
+      else if (PREPROCESSOR_EXPANSION > depth) {
+        expand(state, macro->value, strlen(macro->value), depth + 1);
+      }
+      else {
+        fail(state, "recursive macro", macro->name);
+      }
+      i = end;
+    }
+    else {
+      size_t end = i + 1;
+      // numbers like 2u or 1e3 are not identifiers
+      if (isdigit((unsigned char)line[i])) {
+        while (length > end && isIdentifier(line[end])) {
+          end++;
+        }
+      }
+      append(state, line + i, end - i);
+      i = end;
+    }
+  }
+}
+
+// integer expressions of #if and #elif, precedence climbing over a cursor
+typedef struct {
+    State* state;
+    const char* cursor;
+    size_t depth;
+} Expression;
+
+static int64_t expression_or(Expression expression[static 1]);
+static void expression_skip(Expression expression[static 1]) {
+  while (isspace((unsigned char)*expression->cursor)) {
+    expression->cursor++;
+  }
+}
+static bool expression_accept(Expression expression[static 1], const char* token) {
+  expression_skip(expression);
+  const size_t length = strlen(token);
+  bool result = !strncmp(expression->cursor, token, length);
+  // "<" is not accepted in front of "<="
+  if (result && length == 1 && strchr("<>!=&|", token[0])
+      && expression->cursor[1] == '=') {
+    result = false;
+  }
+  if (result) {
+    expression->cursor += length;
+  }
+  return result;
+}
+static int64_t expression_value(Expression expression[static 1], const char* source) {
+  Expression nested = {
+    .state = expression->state,
+    .cursor = source,
+    .depth = expression->depth + 1,
+  };
+  int64_t result = 0;
+  if (PREPROCESSOR_EXPANSION > nested.depth) {
+    result = expression_or(&nested);
+  }
+  else {
+    fail(expression->state, "recursive macro in", source);
+  }
+  return result;
+}
+static int64_t expression_primary(Expression expression[static 1]) {
+  int64_t result = 0;
+  expression_skip(expression);
+  const char* start = expression->cursor;
+  if (expression_accept(expression, "(")) {
+    result = expression_or(expression);
+    if (!expression_accept(expression, ")")) {
+      fail(expression->state, "missing ) in", start);
+    }
+  }
+  else if (isdigit((unsigned char)*start)) {
+    char* end = 0;
+    result = strtoll(start, &end, 0);
+    // WGSL suffixes
+    while (*end == 'u' || *end == 'i') {
+      end++;
+    }
+    expression->cursor = end;
+  }
+  else if (isIdentifierStart(*start)) {
+    const char* end = start;
+    while (isIdentifier(*end)) {
+      end++;
+    }
+    expression->cursor = end;
+    if (end - start == 7 && !strncmp(start, "defined", 7)) {
+      const bool parenthesis = expression_accept(expression, "(");
+      expression_skip(expression);
+      const char* name = expression->cursor;
+      while (isIdentifier(*expression->cursor)) {
+        expression->cursor++;
+      }
+      result = !!macroFind(expression->state, name, expression->cursor - name);
+      if (parenthesis && !expression_accept(expression, ")")) {
+        fail(expression->state, "missing ) after defined in", start);
+      }
+    }
+    else if (end - start == 4 && !strncmp(start, "true", 4)) {
+      result = 1;
+    }
+    else {
+      // undefined identifiers are zero, as in C
+      Macro* macro = macroFind(expression->state, start, end - start);
+      result = macro ? expression_value(expression, macro->value) : 0;
+    }
+  }
+  else {
+    fail(expression->state, "unexpected token in #if at", start);
+    expression->cursor += *start ? 1 : 0;
+  }
+  return result;
+}
+static int64_t expression_unary(Expression expression[static 1]) {
+  int64_t result = 0;
+  if (expression_accept(expression, "!")) {
+    result = !expression_unary(expression);
+  }
+  else if (expression_accept(expression, "-")) {
+    result = -expression_unary(expression);
+  }
+  else {
+    result = expression_primary(expression);
+  }
+  return result;
+}
+static int64_t expression_multiplicative(Expression expression[static 1]) {
+  int64_t result = expression_unary(expression);
+  while (!expression->state->failed) {
+    if (expression_accept(expression, "*")) {
+      result *= expression_unary(expression);
+    }
+    else if (expression_accept(expression, "/") || expression_accept(expression, "%")) {
+      const bool modulo = expression->cursor[-1] == '%';
+      const int64_t divisor = expression_unary(expression);
+      if (!divisor) {
+        fail(expression->state, "division by zero in #if", 0);
+      }
+      else {
+        result = modulo ? result % divisor : result / divisor;
+      }
+    }
+    else {
+      break;
+    }
+  }
+  return result;
+}
+static int64_t expression_additive(Expression expression[static 1]) {
+  int64_t result = expression_multiplicative(expression);
+  while (!expression->state->failed) {
+    if (expression_accept(expression, "+")) {
+      result += expression_multiplicative(expression);
+    }
+    else if (expression_accept(expression, "-")) {
+      result -= expression_multiplicative(expression);
+    }
+    else {
+      break;
+    }
+  }
+  return result;
+}
+static int64_t expression_relational(Expression expression[static 1]) {
+  int64_t result = expression_additive(expression);
+  while (!expression->state->failed) {
+    if (expression_accept(expression, "<=")) {
+      result = result <= expression_additive(expression);
+    }
+    else if (expression_accept(expression, ">=")) {
+      result = result >= expression_additive(expression);
+    }
+    else if (expression_accept(expression, "<")) {
+      result = result < expression_additive(expression);
+    }
+    else if (expression_accept(expression, ">")) {
+      result = result > expression_additive(expression);
+    }
+    else {
+      break;
+    }
+  }
+  return result;
+}
+static int64_t expression_equality(Expression expression[static 1]) {
+  int64_t result = expression_relational(expression);
+  while (!expression->state->failed) {
+    if (expression_accept(expression, "==")) {
+      result = result == expression_relational(expression);
+    }
+    else if (expression_accept(expression, "!=")) {
+      result = result != expression_relational(expression);
+    }
+    else {
+      break;
+    }
+  }
+  return result;
+}
+static int64_t expression_and(Expression expression[static 1]) {
+  int64_t result = expression_equality(expression);
+  while (!expression->state->failed && expression_accept(expression, "&&")) {
+    // both sides are evaluated so errors are reported either way
+    const int64_t right = expression_equality(expression);
+    result = result && right;
+  }
+  return result;
+}
+static int64_t expression_or(Expression expression[static 1]) {
+  int64_t result = expression_and(expression);
+  while (!expression->state->failed && expression_accept(expression, "||")) {
+    const int64_t right = expression_and(expression);
+    result = result || right;
+  }
+  return result;
+}
+static bool evaluate(State state[static 1], const char* source) {
+  Expression expression = { .state = state, .cursor = source, .depth = 0 };
+  const int64_t result = expression_or(&expression);
+  expression_skip(&expression);
+  if (*expression.cursor && *expression.cursor != '/') {
+    fail(state, "unexpected trailing tokens in #if:", expression.cursor);
+  }
+  return result;
+}
+
+static void process(State state[static 1], const char* source, const char* directory);
+static char* readFile(const char* path) {
+  char* result = 0;
+  FILE* input = fopen(path, "rb");
+  if (input) {
+    fseek(input, 0, SEEK_END);
+    const long size = ftell(input);
+    rewind(input);
+    result = size >= 0 ? malloc(size + 1) : 0;
+    if (result && fread(result, 1, size, input) == (size_t)size) {
+      result[size] = '\0';
+    }
+    else {
+      free(result);
+      result = 0;
+    }
+    fclose(input);
+  }
+  return result;
+}
+// files are told apart by their canonical path, a/../b.wgsl is b.wgsl, false when the
+// file does not exist or its path is too long
+static bool canonicalize(const char* path, char canonical[static PREPROCESSOR_PATH]) {
+  char* resolved = realpath(path, 0);
+  const bool result = resolved && PREPROCESSOR_PATH > strlen(resolved);
+  if (result) {
+    strcpy(canonical, resolved);
+  }
+  free(resolved);
+  return result;
+}
+static void include(State state[static 1], const char* directory, const char* name) {
+  char relative[PREPROCESSOR_PATH];
+  const int length = name[0] == '/' || !directory[0]
+                       ? snprintf(relative, sizeof(relative), "%s", name)
+                       : snprintf(relative, sizeof(relative), "%s/%s", directory, name);
+  if (length < 0 || (size_t)length >= sizeof(relative)) {
+    fail(state, "include path too long:", name);
+    return;
+  }
+  char path[PREPROCESSOR_PATH];
+  if (!canonicalize(relative, path)) {
+    fail(state, "cannot include", relative);
+    return;
+  }
+  for (size_t i = 0; state->fileCount > i; i++) {
+    if (!strcmp(state->files[i], path)) {
+      return;
+    }
+  }
+  if (PREPROCESSOR_FILES == state->fileCount) {
+    fail(state, "too many included files at", path);
+    return;
+  }
+  strcpy(state->files[state->fileCount++], path);
+  char* source = readFile(path);
+  if (!source) {
+    fail(state, "cannot include", path);
+    return;
+  }
+  char includeDirectory[PREPROCESSOR_PATH];
+  strcpy(includeDirectory, path);
+  char* slash = strrchr(includeDirectory, '/');
+  if (slash) {
+    *slash = '\0';
+  }
+  else {
+    includeDirectory[0] = '\0';
+  }
+  const char* previousPath = state->path;
+  const size_t previousLine = state->line;
+  state->path = state->files[state->fileCount - 1];
+  state->line = 0;
+  process(state, source, includeDirectory);
+  state->path = previousPath;
+  state->line = previousLine;
+  free(source);
+}
+// reads the identifier at the cursor into name
+static const char* identifier(const char* cursor, char name[static PREPROCESSOR_NAME]) {
+  size_t length = 0;
+  while (isspace((unsigned char)*cursor)) {
+    cursor++;
+  }
+  while (isIdentifier(*cursor) && PREPROCESSOR_NAME - 1 > length) {
+    name[length++] = *cursor++;
+  }
+  name[length] = '\0';
+  return cursor;
+}
+static void directive(
+  State state[static 1],
+  const char* line,
+  Condition conditions[static PREPROCESSOR_NESTING],
+  size_t depth[static 1],
+  const char* directory) {
+  char keyword[PREPROCESSOR_NAME];
+  const char* cursor = identifier(line + 1, keyword);
+  while (isspace((unsigned char)*cursor)) {
+    cursor++;
+  }
+  const bool active = *depth ? conditions[*depth - 1].active : true;
+  if (!strcmp(keyword, "if") || !strcmp(keyword, "ifdef") || !strcmp(keyword, "ifndef")) {
+    if (PREPROCESSOR_NESTING == *depth) {
+      fail(state, "conditionals nested too deep", 0);
+      return;
+    }
+    bool value = false;
+    if (active && !strcmp(keyword, "if")) {
+      value = evaluate(state, cursor);
+    }
+    else if (active) {
+      char name[PREPROCESSOR_NAME];
+      identifier(cursor, name);
+      value = !!macroFind(state, name, strlen(name)) == !strcmp(keyword, "ifdef");
+    }
+    conditions[(*depth)++] = (Condition){
+      .active = active && value,
+      .taken = value,
+      .parent = active,
+    };
+  }
+  else if (!strcmp(keyword, "elif") || !strcmp(keyword, "else")) {
+    Condition* condition = *depth ? &conditions[*depth - 1] : 0;
+    if (!condition || condition->elsed) {
+      fail(state, "unexpected", keyword);
+      return;
+    }
+    bool value = !condition->taken && condition->parent;
+    if (value && !strcmp(keyword, "elif")) {
+      value = evaluate(state, cursor);
+    }
+    condition->elsed = !strcmp(keyword, "else");
+    condition->active = value;
+    condition->taken = condition->taken || value;
+  }
+  else if (!strcmp(keyword, "endif")) {
+    if (!*depth) {
+      fail(state, "unexpected", keyword);
+      return;
+    }
+    (*depth)--;
+  }
+  else if (!active) {
+    // other directives are skipped with their branch
+  }
+  else if (!strcmp(keyword, "define")) {
+    char name[PREPROCESSOR_NAME];
+    cursor = identifier(cursor, name);
+    while (isspace((unsigned char)*cursor)) {
+      cursor++;
+    }
+    char value[PREPROCESSOR_VALUE] = { 0 };
+    size_t length = strcspn(cursor, "\r\n");
+    // trailing comments are not part of the value
+    const char* comment = strstr(cursor, "//");
+    if (comment && (size_t)(comment - cursor) < length) {
+      length = comment - cursor;
+    }
+    while (length && isspace((unsigned char)cursor[length - 1])) {
+      length--;
+    }
+    if (!name[0] || length >= PREPROCESSOR_VALUE) {
+      fail(state, "invalid #define", cursor);
+      return;
+    }
+    memcpy(value, cursor, length);
+    macroDefine(state, name, value);
+  }
+  else if (!strcmp(keyword, "undef")) {
+    char name[PREPROCESSOR_NAME];
+    identifier(cursor, name);
+    macroUndefine(state, name);
+  }
+  else if (!strcmp(keyword, "include")) {
+    const char* end = *cursor == '"' ? strchr(cursor + 1, '"') : 0;
+    if (!end) {
+      fail(state, "expected #include \"path\", got", cursor);
+      return;
+    }
+    char name[PREPROCESSOR_PATH] = { 0 };
+    if ((size_t)(end - cursor - 1) >= sizeof(name)) {
+      fail(state, "include path too long", 0);
+      return;
+    }
+    memcpy(name, cursor + 1, end - cursor - 1);
+    include(state, directory, name);
+  }
+  else if (!strcmp(keyword, "error")) {
+    fail(state, "#error", cursor);
+  }
+  else {
+    fail(state, "unknown directive", keyword);
+  }
+}
+static void process(State state[static 1], const char* source, const char* directory) {
+  Condition conditions[PREPROCESSOR_NESTING];
+  size_t depth = 0;
+  const char* line = source;
+  while (*line && !state->failed) {
+    state->line++;
+    const char* end = strchr(line, '\n');
+    const size_t length = end ? (size_t)(end - line) + 1 : strlen(line);
+    const char* first = line;
+    while (first < line + length && (*first == ' ' || *first == '\t')) {
+      first++;
+    }
+    if (*first == '#') {
+      char copy[PREPROCESSOR_PATH];
+      const size_t size = line + length - first;
+      if (size >= sizeof(copy)) {
+        fail(state, "directive too long", 0);
+        break;
+      }
+      memcpy(copy, first, size);
+      copy[size] = '\0';
+      directive(state, copy, conditions, &depth, directory);
+    }
+    else if (!depth || conditions[depth - 1].active) {
+      expand(state, line, length, 0);
+    }
+    line += length;
+  }
+  if (depth && !state->failed) {
+    fail(state, "missing #endif", 0);
+  }
+}
+// the paths are copied out of the state, which is freed by the run
+static void files_copy(
+  State state[static 1],
+  Application_preprocessor_Files files[static 1]) {
+  Application_preprocessor_Files_free(files);
+  files->paths = calloc(state->fileCount, sizeof(*files->paths));
+  for (size_t i = 0; files->paths && state->fileCount > i; i++) {
+    if ((files->paths[files->count] = strdup(state->files[i]))) {
+      files->count++;
+    }
+  }
+  if (state->fileCount > files->count) {
+    perror("Preprocessor allocation failed");
+  }
+}
+static char* run(
+  State* state,
+  const char* source,
+  const char* directory,
+  size_t defineCount,
+  const Application_preprocessor_Define defines[],
+  Application_preprocessor_Files* files) {
+  for (size_t i = 0; defineCount > i && !state->failed; i++) {
+    macroDefine(state, defines[i].name, defines[i].value ? defines[i].value : "1");
+  }
+  process(state, source, directory);
+  if (files) {
+    files_copy(state, files);
+  }
+  char* result = state->output.data;
+  if (state->failed) {
+    free(result);
+    result = 0;
+  }
+  else if (!result) {
+    result = calloc(1, 1);
+  }
+  free(state);
+  return result;
+}
+char* Application_preprocessor_string(
+  const char* source,
+  const char* directory,
+  size_t defineCount,
+  const Application_preprocessor_Define defines[],
+  FILE* errors) {
+  State* state = calloc(1, sizeof(*state));
+  if (!state) {
+    perror("Preprocessor allocation failed");
+    return 0;
+  }
+  state->errors = errors;
+  state->path = "<string>";
+  return run(state, source, directory ? directory : "", defineCount, defines, 0);
+}
+char* Application_preprocessor_run(
+  const char* path,
+  size_t defineCount,
+  const Application_preprocessor_Define defines[],
+  Application_preprocessor_Files* files,
+  FILE* errors) {
+  char* result = 0;
+  State* state = calloc(1, sizeof(*state));
+  char* source = readFile(path);
+  if (!state) {
+    perror("Preprocessor allocation failed");
+  }
+  else if (!source || !canonicalize(path, state->files[0])) {
+    if (files) {
+      Application_preprocessor_Files_free(files);
+    }
+    if (errors) {
+      fprintf(errors, "Error opening %s: %s\n", path, strerror(errno));
+    }
+    free(state);
+  }
+  else {
+    state->errors = errors;
+    state->fileCount++;
+    state->path = state->files[0];
+    char directory[PREPROCESSOR_PATH];
+    strcpy(directory, state->files[0]);
+    char* slash = strrchr(directory, '/');
+    if (slash) {
+      *slash = '\0';
+    }
+    else {
+      directory[0] = '\0';
+    }
+    result = run(state, source, directory, defineCount, defines, files);
+  }
+  free(source);
+  return result;
+}
+bool Application_preprocessor_Files_contains(
+  const Application_preprocessor_Files files[static 1],
+  const char* path) {
+  bool result = false;
+  for (size_t i = 0; !result && files->count > i; i++) {
+    result = !strcmp(files->paths[i], path);
+  }
+  return result;
+}
+void Application_preprocessor_Files_free(Application_preprocessor_Files files[static 1]) {
+  for (size_t i = 0; files->count > i; i++) {
+    free(files->paths[i]);
+  }
+  free(files->paths);
+  *files = (Application_preprocessor_Files){ 0 };
+}
@@ -0,0 +1,42 @@
+#ifndef preprocessor_H_
+#define preprocessor_H_
+
+#include <stdio.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+// A small C like preprocessor for WGSL: #include "path" (relative to the including file
+// and expanded once per file), object like #define and #undef, and #if, #ifdef, #ifndef,
+// #elif, #else, #endif over integer expressions with defined().
+typedef struct {
+    const char* name;
+    const char* value;
+} Application_preprocessor_Define;
+// the canonical paths of the file run first and then of the ones it included
+typedef struct {
+    size_t count;
+    char** paths;
+} Application_preprocessor_Files;
+
+// the expanded source has to be freed, null when it fails with the reason on errors,
+// the files read until then are stored in files unless it is null
+char* Application_preprocessor_run(
+  const char* path,
+  size_t defineCount,
+  const Application_preprocessor_Define defines[],
+  Application_preprocessor_Files* files,
+  FILE* errors);
+// same from a string, includes are resolved relative to directory
+char* Application_preprocessor_string(
+  const char* source,
+  const char* directory,
+  size_t defineCount,
+  const Application_preprocessor_Define defines[],
+  FILE* errors);
+// whether path, canonical, is one of the files
+bool Application_preprocessor_Files_contains(
+  const Application_preprocessor_Files files[static 1],
+  const char* path);
+void Application_preprocessor_Files_free(Application_preprocessor_Files files[static 1]);
+
+#endif // preprocessor_H_
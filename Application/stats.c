@@ -0,0 +1,48 @@
+#include "stats.h"
+#include <stdint.h>
+#include <stdatomic.h>
+
+static atomic_uint_fast64_t counters[Application_stats_CounterCount] = { 0 };
+static atomic_int_fast64_t gauges[Application_stats_GaugeCount] = { 0 };
+static Application_stats_Frame frame = { .histogramRange = STATS_RANGE };
+
+void Application_stats_add(Application_stats_Counter counter, uint64_t value) {
+  atomic_fetch_add_explicit(&counters[counter], value, memory_order_relaxed);
+}
+void Application_stats_gaugeAdd(Application_stats_Gauge gauge, int64_t value) {
+  atomic_fetch_add_explicit(&gauges[gauge], value, memory_order_relaxed);
+}
+// called once per frame on the main thread, everything happens in place
+void Application_stats_frame(float cpuMilliseconds, float gpuMilliseconds) {
+  for (size_t i = 0; Application_stats_CounterCount > i; i++) {
+    frame.counters[i] = atomic_exchange_explicit(&counters[i], 0, memory_order_relaxed);
+  }
+  for (size_t i = 0; Application_stats_GaugeCount > i; i++) {
+    frame.gauges[i] = atomic_load_explicit(&gauges[i], memory_order_relaxed);
+  }
+  frame.cpu[frame.head] = cpuMilliseconds;
+  frame.gpu[frame.head] = gpuMilliseconds;
+  frame.head = (frame.head + 1) % STATS_HISTORY;
+  frame.frames++;
+  float maximum = 0;
+  for (size_t i = 0; STATS_HISTORY > i; i++) {
+    maximum = frame.cpu[i] > maximum ? frame.cpu[i] : maximum;
+  }
+  // the range covers the history in steps so the buckets do not jump around every frame,
+  // it shrinks again once a spike left the history
+  frame.histogramRange = STATS_RANGE;
+  while (maximum > frame.histogramRange) {
+    frame.histogramRange *= 2;
+  }
+  for (size_t i = 0; STATS_HISTOGRAM > i; i++) {
+    frame.histogram[i] = 0;
+  }
+  const size_t samples = frame.frames < STATS_HISTORY ? frame.frames : STATS_HISTORY;
+  for (size_t i = 0; samples > i; i++) {
+    size_t bucket = (size_t)(frame.cpu[i] / frame.histogramRange * STATS_HISTOGRAM);
+    frame.histogram[bucket < STATS_HISTOGRAM ? bucket : STATS_HISTOGRAM - 1] += 1;
+  }
+}
+const Application_stats_Frame* Application_stats_get() {
+  return &frame;
+}
@@ -0,0 +1,45 @@
+#ifndef stats_H_
+#define stats_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define STATS_HISTORY   (256)
+#define STATS_HISTOGRAM (32)
+#define STATS_RANGE     (50.0f) // milliseconds the histogram covers at least
+
+// per frame counters, reset when the frame is committed
+typedef enum {
+  Application_stats_DrawCalls,
+  Application_stats_Triangles,
+  Application_stats_PipelineSwitches,
+  Application_stats_BindGroupSwitches,
+  Application_stats_UploadBytes,
+  Application_stats_UniformBytes,
+  Application_stats_UniformWrites,
+  Application_stats_CounterCount,
+} Application_stats_Counter;
+// running totals
+typedef enum {
+  Application_stats_BufferBytes,
+  Application_stats_TextureBytes,
+  Application_stats_GaugeCount,
+} Application_stats_Gauge;
+
+typedef struct {
+    uint64_t counters[Application_stats_CounterCount];
+    int64_t gauges[Application_stats_GaugeCount];
+    float cpu[STATS_HISTORY]; // from the start of the frame to its present
+    float gpu[STATS_HISTORY];
+    size_t head; // oldest sample of the histories
+    size_t frames;
+    float histogram[STATS_HISTOGRAM];
+    float histogramRange; // milliseconds covered by the histogram
+} Application_stats_Frame;
+
+void Application_stats_add(Application_stats_Counter counter, uint64_t value);
+void Application_stats_gaugeAdd(Application_stats_Gauge gauge, int64_t value);
+void Application_stats_frame(float cpuMilliseconds, float gpuMilliseconds);
+const Application_stats_Frame* Application_stats_get();
+
+#endif // stats_H_
@@ -0,0 +1,714 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <threads.h>
+#include <sys/stat.h>
+#include "webgpu.h"
+#include "limits.h"
+#include "cache.h"
+#include "preprocessor.h"
+#include "cluster.h"
+#include "dirty.h"
+#include "jobs.h"
+#include "watch.h"
+
+// synthetic adapter tables, a low end one below the WebGPU defaults and a desktop one
+static WGPULimits lowEnd() {
+  WGPULimits result = Application_limits_defaults();
+  result.maxTextureDimension2D = 4096;
+  result.maxStorageBuffersPerShaderStage = 4;
+  result.maxBufferSize = 128 << 20;
+  result.minUniformBufferOffsetAlignment = 256;
+  return result;
+}
+static WGPULimits desktop() {
+  WGPULimits result = Application_limits_defaults();
+  result.maxTextureDimension2D = 16384;
+  result.maxBindGroups = 8;
+  result.maxStorageBufferBindingSize = 2147483648;
+  result.maxBufferSize = 2147483648;
+  result.minUniformBufferOffsetAlignment = 64;
+  return result;
+}
+static WGPULimits scene() {
+  WGPULimits result = Application_limits_make();
+  LIMITS_REQUIRE(result.maxTextureDimension2D, 2048u);
+  LIMITS_REQUIRE(result.maxBufferSize, (uint64_t)(150000 * 44));
+  LIMITS_REQUIRE(result.maxBindGroups, 1u);
+  LIMITS_REQUIRE(result.maxUniformBufferBindingSize, (uint64_t)(16 * 4 * sizeof(float)));
+  return result;
+}
+bool negotiationSucceeds() {
+  bool error = false;
+  const WGPULimits required = scene();
+  const WGPULimits supported = desktop();
+  WGPULimits result = { 0 };
+  if (!Application_limits_negotiate(&required, &supported, &result, 0)) {
+    printf("A scene within the defaults is rejected by a desktop adapter.\n");
+    error = true;
+  }
+  if (result.maxTextureDimension2D != 8192 || result.maxBindGroups != 4) {
+    printf("Limits below the defaults are not raised to the defaults.\n");
+    error = true;
+  }
+  if (result.minUniformBufferOffsetAlignment != 64) {
+    printf("The uniform offset alignment is not taken from the adapter.\n");
+    error = true;
+  }
+  if (!error) {
+    printf("Negotiation within the defaults succeeds.\n");
+  }
+  return error;
+}
+bool negotiationRaises() {
+  bool error = false;
+  WGPULimits required = scene();
+  LIMITS_REQUIRE(required.maxBufferSize, (uint64_t)512 << 20);
+  LIMITS_REQUIRE(required.maxTextureDimension2D, 12000u);
+  const WGPULimits supported = desktop();
+  WGPULimits result = { 0 };
+  if (!Application_limits_negotiate(&required, &supported, &result, 0)) {
+    printf("A large scene is rejected by a desktop adapter.\n");
+    error = true;
+  }
+  if (result.maxBufferSize != (uint64_t)512 << 20 || result.maxTextureDimension2D != 12000) {
+    printf("Limits above the defaults are not raised to the requirement.\n");
+    error = true;
+  }
+  if (!error) {
+    printf("Negotiation above the defaults succeeds.\n");
+  }
+  return error;
+}
+bool negotiationClamps() {
+  bool error = false;
+  const WGPULimits required = scene();
+  const WGPULimits supported = lowEnd();
+  WGPULimits result = { 0 };
+  if (!Application_limits_negotiate(&required, &supported, &result, 0)) {
+    printf("A small scene is rejected by a low end adapter.\n");
+    error = true;
+  }
+  if (result.maxTextureDimension2D != 4096 || result.maxBufferSize != 128 << 20) {
+    printf("Defaults above the adapter limits are not clamped.\n");
+    error = true;
+  }
+  if (!error) {
+    printf("Negotiation clamps to the adapter.\n");
+  }
+  return error;
+}
+bool negotiationFails() {
+  bool error = false;
+  WGPULimits required = scene();
+  LIMITS_REQUIRE(required.maxTextureDimension2D, 8192u);
+  LIMITS_REQUIRE(required.maxStorageBuffersPerShaderStage, 6u);
+  const WGPULimits supported = lowEnd();
+  WGPULimits result = { 0 };
+  char report[1024] = { 0 };
+  FILE* output = fmemopen(report, sizeof(report), "w");
+  if (Application_limits_negotiate(&required, &supported, &result, output)) {
+    printf("A scene above the adapter limits is accepted.\n");
+    error = true;
+  }
+  fclose(output);
+  if (!strstr(report, "maxTextureDimension2D: required 8192, supported 4096")
+      || !strstr(report, "maxStorageBuffersPerShaderStage: required 6, supported 4")) {
+    printf("The failure report does not name every missing limit:\n%s", report);
+    error = true;
+  }
+  if (strstr(report, "maxBufferSize")) {
+    printf("The failure report names a satisfied limit:\n%s", report);
+    error = true;
+  }
+  if (!error) {
+    printf("Negotiation above the adapter limits fails with a report.\n");
+  }
+  return error;
+}
+// the blobs go through the callbacks Dawn is given
+bool cacheEvictsLeastRecentlyUsed() {
+  bool error = false;
+  const char* directory = "tests-cache";
+  // a zero limit empties what a previous run may have left
+  Application_cache_destroy(Application_cache_create(directory, 0));
+  Application_cache* cache = Application_cache_create(directory, 3500);
+  if (!cache) {
+    printf("The cache directory could not be created.\n");
+    return true;
+  }
+  WGPUDawnCacheDeviceDescriptor descriptor = Application_cache_descriptor(cache, "tests");
+  static char value[4000] = { 0 };
+  char keys[4][8] = { "first", "second", "third", "fourth" };
+  for (size_t i = 0; 3 > i; i++) {
+    value[0] = (char)i;
+    descriptor.storeDataFunction(keys[i], 8, value, 1000, cache);
+  }
+  // the first is used again, so the second is the oldest when the fourth is stored
+  const size_t size = descriptor.loadDataFunction(keys[0], 8, 0, 0, cache);
+  if (size != 1000 || descriptor.loadDataFunction(keys[0], 8, value, size, cache) != size
+      || value[0] != 0) {
+    printf("A stored blob is not loaded back.\n");
+    error = true;
+  }
+  descriptor.storeDataFunction(keys[3], 8, value, 1000, cache);
+  if (descriptor.loadDataFunction(keys[1], 8, 0, 0, cache)
+      || !descriptor.loadDataFunction(keys[0], 8, 0, 0, cache)) {
+    printf("The least recently used blob is not the one evicted.\n");
+    error = true;
+  }
+  Application_cache_destroy(cache);
+  // a new run sees the blobs of the previous one
+  cache = Application_cache_create(directory, 3500);
+  descriptor = Application_cache_descriptor(cache, "tests");
+  if (Application_cache_stats(cache).entries != 3
+      || descriptor.loadDataFunction(keys[3], 8, 0, 0, cache) != 1000) {
+    printf("The cache does not persist across runs.\n");
+    error = true;
+  }
+  for (size_t i = 0; 4 > i; i++) {
+    descriptor.storeDataFunction(keys[i], 8, value, sizeof(value), cache);
+  }
+  if (Application_cache_stats(cache).entries) {
+    printf("Blobs above the size limit are kept.\n");
+    error = true;
+  }
+  Application_cache_destroy(cache);
+  remove(directory);
+  if (!error) {
+    printf("The cache evicts the least recently used blobs.\n");
+  }
+  return error;
+}
+static bool expands(
+  const char* source,
+  size_t defineCount,
+  const Application_preprocessor_Define defines[],
+  const char* expected) {
+  char* result = Application_preprocessor_string(source, "", defineCount, defines, 0);
+  const bool matches = result && !strcmp(result, expected);
+  if (!matches) {
+    printf("Expanded\n%sto\n%sinstead of\n%s", source, result ? result : "null\n", expected);
+  }
+  free(result);
+  return matches;
+}
+bool preprocessorConditionals() {
+  bool error = false;
+  const char* source = "#if LIGHTS > 2 && defined(TEXTURED)\n"
+                       "many\n"
+                       "#elif LIGHTS == 2\n"
+                       "  #ifdef TEXTURED\n"
+                       "two textured\n"
+                       "  #else\n"
+                       "two\n"
+                       "  #endif\n"
+                       "#else\n"
+                       "few\n"
+                       "#endif\n";
+  const Application_preprocessor_Define many[] = { { "LIGHTS", "4" }, { "TEXTURED", 0 } };
+  const Application_preprocessor_Define two[] = { { "LIGHTS", "1 + 1" } };
+  const Application_preprocessor_Define textured[] = { { "LIGHTS", "2" }, { "TEXTURED", 0 } };
+  error = !expands(source, 2, many, "many\n") || error;
+  error = !expands(source, 1, two, "two\n") || error;
+  error = !expands(source, 2, textured, "two textured\n") || error;
+  error = !expands(source, 0, 0, "few\n") || error;
+  if (!error) {
+    printf("The preprocessor selects the branches of nested conditionals.\n");
+  }
+  return error;
+}
+bool preprocessorDefines() {
+  bool error = false;
+  const Application_preprocessor_Define count[] = { { "COUNT", "3" } };
+  error = !expands(
+            "#define SIZE COUNT * 4 // bytes\n"
+            "array<f32, SIZE> COUNTS; // SIZE\n"
+            "#undef SIZE\n"
+            "SIZE 2u\n",
+            1,
+            count,
+            "array<f32, 3 * 4> COUNTS; // SIZE\n"
+            "SIZE 2u\n")
+          || error;
+  char errors[256] = { 0 };
+  FILE* output = fmemopen(errors, sizeof(errors), "w");
+  char* result = Application_preprocessor_string("#if 1\nopen\n", "", 0, 0, output);
+  fclose(output);
+  if (result || !strstr(errors, "missing #endif")) {
+    printf("An unterminated #if is not reported: %s\n", errors);
+    error = true;
+  }
+  free(result);
+  if (!error) {
+    printf("The preprocessor substitutes and reports its errors.\n");
+  }
+  return error;
+}
+bool preprocessorIncludes() {
+  bool error = false;
+  FILE* header = fopen("tests-header.wgsl", "w");
+  if (!header) {
+    printf("The included file could not be written.\n");
+    return true;
+  }
+  fputs("#define HEADER 1\nstruct Header { value: f32, };\n", header);
+  fclose(header);
+  mkdir("tests-include", 0755);
+  // included three times through two paths, expanded once
+  error = !expands(
+            "#include \"tests-header.wgsl\"\n"
+            "#include \"tests-header.wgsl\"\n"
+            "#include \"tests-include/../tests-header.wgsl\"\n"
+            "#if HEADER\n"
+            "header\n"
+            "#endif\n",
+            0,
+            0,
+            "struct Header { value: f32, };\nheader\n")
+          || error;
+  remove("tests-include");
+  remove("tests-header.wgsl");
+  if (!error) {
+    printf("The preprocessor includes files once.\n");
+  }
+  return error;
+}
+// the watch loop of the application, the shader is reloaded for an edit of a file it
+// includes as much as for one of its own
+bool watchReloadsIncluders() {
+  FILE* header = fopen("tests-watched.wgsl", "w");
+  FILE* shader = fopen("tests-watching.wgsl", "w");
+  if (header) {
+    fputs("struct Header { value: f32, };\n", header);
+    fclose(header);
+  }
+  if (shader) {
+    fputs("#include \"tests-watched.wgsl\"\n", shader);
+    fclose(shader);
+  }
+  if (!header || !shader) {
+    printf("The watched files could not be written.\n");
+    return true;
+  }
+  bool error = false;
+  Application_preprocessor_Files includes = { 0 };
+  char* source =
+    Application_preprocessor_run("tests-watching.wgsl", 0, 0, &includes, stdout);
+  char* included = realpath("tests-watched.wgsl", 0);
+  if (!source || 2 != includes.count || !included
+      || !Application_preprocessor_Files_contains(&includes, included)) {
+    printf("The preprocessor does not report the included file.\n");
+    error = true;
+  }
+  Application_watch* watch = Application_watch_create();
+  bool reloaded = false;
+  if (watch) {
+    for (size_t i = 0; includes.count > i; i++) {
+      Application_watch_add(watch, includes.paths[i]);
+    }
+    if ((header = fopen("tests-watched.wgsl", "w"))) {
+      fputs("struct Header { value: f32, edited: f32, };\n", header);
+      fclose(header);
+    }
+    const char* changed[4];
+    const size_t count = Application_watch_poll(watch, changed, 4);
+    for (size_t i = 0; count > i; i++) {
+      reloaded |= Application_preprocessor_Files_contains(&includes, changed[i]);
+    }
+    if (!reloaded) {
+      printf("An edit of an included file does not reload the shader.\n");
+      error = true;
+    }
+    Application_watch_destroy(watch);
+  }
+  free(included);
+  free(source);
+  Application_preprocessor_Files_free(&includes);
+  remove("tests-watching.wgsl");
+  remove("tests-watched.wgsl");
+  if (!error) {
+    printf(
+      "The included files are watched%s.\n",
+      reloaded ? ", an edit reloads the including shader" : " where files can be");
+  }
+  return error;
+}
+// every permutation the application uses has to be valid WGSL, checked by Tint when it
+// is installed
+bool permutationsCompile() {
+  bool error = false;
+  const bool tint = !system("command -v tint > /dev/null 2>&1");
+  const char* lightCounts[] = { "1", "2", "4" };
+  const char* textured[] = { "0", "1" };
+  for (size_t i = 0; 3 > i; i++) {
+    for (size_t j = 0; 2 > j; j++) {
+      const Application_preprocessor_Define defines[] = {
+        { "LIGHT_COUNT", lightCounts[i] },
+        { "TEXTURED", textured[j] },
+      };
+      char* source = Application_preprocessor_run(
+        RESOURCE_DIR "/lightning/specularity.wgsl",
+        2,
+        defines,
+        0,
+        stdout);
+      if (!source || strchr(source, '#')) {
+        printf("LIGHT_COUNT=%s TEXTURED=%s does not expand.\n", lightCounts[i], textured[j]);
+        error = true;
+      }
+      FILE* output = source && tint ? fopen("tests-permutation.wgsl", "w") : 0;
+      if (output) {
+        fputs(source, output);
+        fclose(output);
+        if (system("tint --format wgsl -o /dev/null tests-permutation.wgsl")) {
+          printf("LIGHT_COUNT=%s TEXTURED=%s does not compile.\n", lightCounts[i], textured[j]);
+          error = true;
+        }
+        remove("tests-permutation.wgsl");
+      }
+      free(source);
+    }
+  }
+  if (!error) {
+    printf(
+      tint ? "The shader permutations compile.\n"
+           : "The shader permutations expand, tint is not installed to compile them.\n");
+  }
+  return error;
+}
+// a perspective looking down -z with near 1 and far 100, as Matrix4f_perspective builds it
+static Matrix4f perspective() {
+  Matrix4f result = { 0 };
+  result.elements[0] = 1.0f;
+  result.elements[5] = 1.0f;
+  result.elements[10] = -101.0f / 99.0f;
+  result.elements[11] = -200.0f / 99.0f;
+  result.elements[14] = -1.0f;
+  return result;
+}
+static Matrix4f identity() {
+  Matrix4f result = { 0 };
+  for (size_t i = 0; 4 > i; i++) {
+    result.elements[5 * i] = 1.0f;
+  }
+  return result;
+}
+bool clustersBinVisibleLights() {
+  bool error = false;
+  Application_cluster* cluster = Application_cluster_create(0, 1);
+  const Application_cluster_Light lights[] = {
+    { .position = { { 0.6875f, 0.0f, -11.0f } }, .radius = 0.01f },
+    { .position = { { 0.0f, 0.0f, 10.0f } }, .radius = 1.0f },
+  };
+  size_t size = 0;
+  const uint32_t* grid =
+    Application_cluster_bin(cluster, 2, lights, identity(), perspective(), &size);
+  // in the middle of a tile and of a slice, the slices are exponential from 1 to 100
+  const size_t z = CLUSTER_Z / 2;
+  const size_t index = CLUSTER_X / 2 + CLUSTER_X * (CLUSTER_Y / 2 + CLUSTER_Y * z);
+  if (Application_cluster_stats(cluster).references != 1 || grid[2 * index + 1] != 1
+      || grid[grid[2 * index]] != 0) {
+    printf("A light in front of the camera is not binned into its cluster.\n");
+    error = true;
+  }
+  if (size != (2 * CLUSTER_COUNT + 1) * sizeof(uint32_t)) {
+    printf("The grid is not packed.\n");
+    error = true;
+  }
+  Application_cluster_destroy(cluster);
+  if (!error) {
+    printf("The clusters hold the visible lights.\n");
+  }
+  return error;
+}
+bool clustersMatchAcrossThreads() {
+  bool error = false;
+  static Application_cluster_Light lights[2000];
+  uint32_t state = 1;
+  for (size_t i = 0; 2000 > i; i++) {
+    for (size_t j = 0; 3 > j; j++) {
+      state = state * 1664525u + 1013904223u;
+      lights[i].position.components[j] = (float)(state >> 8) / (float)(1u << 20) - 8.0f;
+    }
+    lights[i].radius = 0.5f;
+  }
+  Application_jobs* jobs = Application_jobs_create(4);
+  Application_cluster* single = Application_cluster_create(0, 1);
+  Application_cluster* multiple = Application_cluster_create(jobs, 5);
+  size_t singleSize = 0;
+  size_t multipleSize = 0;
+  const uint32_t* expected =
+    Application_cluster_bin(single, 2000, lights, identity(), perspective(), &singleSize);
+  const uint32_t* grid =
+    Application_cluster_bin(multiple, 2000, lights, identity(), perspective(), &multipleSize);
+  if (singleSize != multipleSize || memcmp(expected, grid, singleSize)) {
+    printf("Binning on several threads differs from binning on one.\n");
+    error = true;
+  }
+  Application_cluster_destroy(single);
+  Application_cluster_destroy(multiple);
+  Application_jobs_destroy(jobs);
+  if (!error) {
+    printf("The clusters do not depend on the thread count.\n");
+  }
+  return error;
+}
+static bool rangesAre(
+  Application_dirty dirty[static 1],
+  size_t count,
+  const Application_dirty_Range expected[]) {
+  Application_dirty_Range ranges[DIRTY_RANGES];
+  const size_t taken = Application_dirty_take(dirty, ranges);
+  bool result = taken == count && !dirty->count;
+  for (size_t i = 0; result && count > i; i++) {
+    result = ranges[i].begin == expected[i].begin && ranges[i].end == expected[i].end;
+  }
+  if (!result) {
+    printf("Took %zu ranges:", taken);
+    for (size_t i = 0; taken > i; i++) {
+      printf(" [%u, %u)", ranges[i].begin, ranges[i].end);
+    }
+    printf("\n");
+  }
+  return result;
+}
+bool dirtyRangesCoalesce() {
+  bool error = false;
+  Application_dirty dirty = { 0 };
+  // far apart and marked out of order, then a range bridging two of them
+  Application_dirty_mark(&dirty, 1000, 4);
+  Application_dirty_mark(&dirty, 0, 64);
+  Application_dirty_mark(&dirty, 500, 16);
+  Application_dirty_mark(&dirty, 0, 16);
+  const Application_dirty_Range apart[] = { { 0, 64 }, { 500, 516 }, { 1000, 1004 } };
+  if (!rangesAre(&dirty, 3, apart)) {
+    printf("Distant ranges are not kept apart and sorted.\n");
+    error = true;
+  }
+  Application_dirty_mark(&dirty, 0, 64);
+  Application_dirty_mark(&dirty, 200, 16);
+  Application_dirty_mark(&dirty, 100, 100);
+  const Application_dirty_Range bridged[] = { { 0, 216 } };
+  if (!rangesAre(&dirty, 1, bridged)) {
+    printf("Close ranges are not merged.\n");
+    error = true;
+  }
+  // buffer writes are 4 byte aligned
+  Application_dirty_mark(&dirty, 6, 3);
+  const Application_dirty_Range aligned[] = { { 4, 12 } };
+  if (!rangesAre(&dirty, 1, aligned)) {
+    printf("Ranges are not aligned to 4 bytes.\n");
+    error = true;
+  }
+  for (size_t i = 0; DIRTY_RANGES + 1 > i; i++) {
+    Application_dirty_mark(&dirty, i * 1000 + (i == 3 ? 900 : 0), 4);
+  }
+  if (dirty.count != DIRTY_RANGES || dirty.ranges[3].end != 4004) {
+    printf("The closest ranges are not the ones merged when the tracker is full.\n");
+    error = true;
+  }
+  if (!error) {
+    printf("Dirty ranges coalesce into the fewest writes.\n");
+  }
+  return error;
+}
+#define STAGES     (4)
+#define STAGE_JOBS (64)
+// the jobs stamp when they start and end, the stages must not overlap
+typedef struct {
+    atomic_size_t* clock;
+    size_t begin;
+    size_t end;
+} Stamp;
+static void stamp(void* context) {
+  Stamp* stamp = context;
+  stamp->begin = atomic_fetch_add(stamp->clock, 1);
+  for (volatile size_t i = 0; 1000 > i; i++) {}
+  stamp->end = atomic_fetch_add(stamp->clock, 1);
+}
+typedef struct {
+    Application_jobs* jobs;
+    Stamp stamps[STAGE_JOBS];
+    Application_jobs_Counter counter;
+} Spawn;
+// submits the stamps as children and helps until they are done
+static void spawn(void* context) {
+  Spawn* spawn = context;
+  for (size_t i = 0; STAGE_JOBS > i; i++) {
+    Application_jobs_submit(spawn->jobs, stamp, &spawn->stamps[i], 0, &spawn->counter);
+  }
+  Application_jobs_wait(spawn->jobs, &spawn->counter);
+}
+bool jobsRespectDependencies() {
+  bool error = false;
+  const size_t threads[] = { 1, 4 };
+  for (size_t t = 0; sizeof(threads) / sizeof(*threads) > t; t++) {
+    Application_jobs* jobs = Application_jobs_create(threads[t]);
+    atomic_size_t clock = 0;
+    static Stamp stamps[STAGES][STAGE_JOBS];
+    Application_jobs_Counter counters[STAGES] = { 0 };
+    // every job of a stage depends on the whole stage before
+    for (size_t s = 0; STAGES > s; s++) {
+      for (size_t i = 0; STAGE_JOBS > i; i++) {
+        stamps[s][i] = (Stamp){ .clock = &clock };
+        Application_jobs_submit(
+          jobs,
+          stamp,
+          &stamps[s][i],
+          s ? &counters[s - 1] : 0,
+          &counters[s]);
+      }
+    }
+    Application_jobs_wait(jobs, &counters[STAGES - 1]);
+    for (size_t s = 0; STAGES > s; s++) {
+      if (atomic_load(&counters[s].pending)) {
+        printf("A stage is pending after the last one.\n");
+        error = true;
+      }
+    }
+    for (size_t s = 1; STAGES > s; s++) {
+      for (size_t i = 0; STAGE_JOBS > i; i++) {
+        for (size_t j = 0; STAGE_JOBS > j; j++) {
+          if (stamps[s][i].begin < stamps[s - 1][j].end) {
+            printf("A job started before its dependency on %zu threads.\n", threads[t]);
+            error = true;
+            i = j = STAGE_JOBS;
+          }
+        }
+      }
+    }
+    // nested submissions, the parents wait in their jobs
+    static Spawn spawns[8];
+    Application_jobs_Counter parents = { 0 };
+    for (size_t i = 0; 8 > i; i++) {
+      spawns[i] = (Spawn){ .jobs = jobs };
+      for (size_t j = 0; STAGE_JOBS > j; j++) {
+        spawns[i].stamps[j] = (Stamp){ .clock = &clock };
+      }
+      Application_jobs_submit(jobs, spawn, &spawns[i], 0, &parents);
+    }
+    Application_jobs_wait(jobs, &parents);
+    for (size_t i = 0; 8 > i; i++) {
+      for (size_t j = 0; STAGE_JOBS > j; j++) {
+        if (!spawns[i].stamps[j].end) {
+          printf("A nested job did not run before its parent ended.\n");
+          error = true;
+        }
+      }
+    }
+    const Application_jobs_Stats stats = Application_jobs_stats(jobs);
+    if (stats.executed != STAGES * STAGE_JOBS + 8 + 8 * STAGE_JOBS) {
+      printf("%zu jobs ran instead of the submitted ones.\n", (size_t)stats.executed);
+      error = true;
+    }
+    Application_jobs_destroy(jobs);
+  }
+  if (!error) {
+    printf("The jobs run after their dependencies.\n");
+  }
+  return error;
+}
+typedef struct {
+    Application_jobs* jobs;
+    thrd_t main;
+    Application_jobs_Counter* counter;
+    atomic_size_t* elsewhere; // main thread jobs that ran on another thread
+} Affinity;
+static void onMain(void* context) {
+  Affinity* affinity = context;
+  if (!thrd_equal(thrd_current(), affinity->main)) {
+    atomic_fetch_add(affinity->elsewhere, 1);
+  }
+}
+// submits from a worker for the main thread
+static void toMain(void* context) {
+  Affinity* affinity = context;
+  Application_jobs_submitMain(affinity->jobs, onMain, affinity, 0, affinity->counter);
+}
+bool jobsKeepMainThreadAffinity() {
+  bool error = false;
+  Application_jobs* jobs = Application_jobs_create(4);
+  atomic_size_t elsewhere = 0;
+  Application_jobs_Counter submitted = { 0 };
+  Application_jobs_Counter ran = { 0 };
+  Affinity affinity = {
+    .jobs = jobs,
+    .main = thrd_current(),
+    .counter = &ran,
+    .elsewhere = &elsewhere,
+  };
+  for (size_t i = 0; 100 > i; i++) {
+    Application_jobs_submit(jobs, toMain, &affinity, 0, &submitted);
+  }
+  Application_jobs_wait(jobs, &submitted);
+  // they only run when the main thread waits or polls
+  size_t polled = 0;
+  while (atomic_load(&ran.pending)) {
+    polled += Application_jobs_poll(jobs);
+  }
+  Application_jobs_wait(jobs, &ran);
+  if (atomic_load(&elsewhere)) {
+    printf("%zu main thread jobs ran on workers.\n", atomic_load(&elsewhere));
+    error = true;
+  }
+  Application_jobs_destroy(jobs);
+  if (!error) {
+    printf("The main thread jobs ran on the main thread, %zu from a poll.\n", polled);
+  }
+  return error;
+}
+// the jobs the main thread submits come back to it from the workers that ran them
+bool jobsReuseTheirAllocations() {
+  bool error = false;
+  Application_jobs* jobs = Application_jobs_create(4);
+  atomic_size_t clock = 0;
+  static Stamp stamps[STAGE_JOBS];
+  uint64_t steady = 0;
+  for (size_t round = 0; 64 > round; round++) {
+    Application_jobs_Counter counter = { 0 };
+    for (size_t i = 0; STAGE_JOBS > i; i++) {
+      stamps[i] = (Stamp){ .clock = &clock };
+      Application_jobs_submit(jobs, stamp, &stamps[i], 0, &counter);
+    }
+    Application_jobs_wait(jobs, &counter);
+    steady = round ? steady : Application_jobs_stats(jobs).allocated;
+  }
+  const Application_jobs_Stats stats = Application_jobs_stats(jobs);
+  if (stats.allocated != steady || STAGE_JOBS < steady) {
+    printf(
+      "%zu jobs were allocated after the first round of %d, %zu in all.\n",
+      (size_t)(stats.allocated - steady),
+      STAGE_JOBS,
+      (size_t)stats.allocated);
+    error = true;
+  }
+  Application_jobs_destroy(jobs);
+  if (!error) {
+    printf("The jobs were allocated once, %zu stolen.\n", (size_t)stats.stolen);
+  }
+  return error;
+}
+int main() {
+  bool error = false;
+  error = negotiationSucceeds() || error;
+  error = negotiationRaises() || error;
+  error = negotiationClamps() || error;
+  error = negotiationFails() || error;
+  error = cacheEvictsLeastRecentlyUsed() || error;
+  error = preprocessorConditionals() || error;
+  error = preprocessorDefines() || error;
+  error = preprocessorIncludes() || error;
+  error = watchReloadsIncluders() || error;
+  error = permutationsCompile() || error;
+  error = clustersBinVisibleLights() || error;
+  error = clustersMatchAcrossThreads() || error;
+  error = dirtyRangesCoalesce() || error;
+  error = jobsRespectDependencies() || error;
+  error = jobsKeepMainThreadAffinity() || error;
+  error = jobsReuseTheirAllocations() || error;
+  return error ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+// gcc-13 -std=gnu2x -I ../library -DRESOURCE_DIR=\"../resources\" tests.c limits.c cache.c preprocessor.c cluster.c dirty.c jobs.c watch.c
@@ -0,0 +1,141 @@
+#include "trace.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include <threads.h>
+#include <time.h>
+
+#define TRACE_CAPACITY (1 << 16)
+#define TRACE_DEPTH    (32)
+
+typedef struct {
+    const char* name;
+    uint64_t begin;
+    uint64_t duration;
+} Event;
+// written by its own thread only, other threads read up to the published count
+typedef struct Buffer {
+    struct Buffer* next;
+    size_t thread;
+    const char* name;
+    atomic_size_t count;
+    Application_trace_Scope stack[TRACE_DEPTH];
+    size_t depth;
+    Event events[TRACE_CAPACITY];
+} Buffer;
+
+static _Atomic(Buffer*) buffers = 0;
+static atomic_size_t threads = 0;
+static thread_local Buffer* local = 0;
+
+static uint64_t now() {
+  struct timespec time = { 0 };
+  clock_gettime(CLOCK_MONOTONIC, &time);
+  return (uint64_t)time.tv_sec * 1000000000u + (uint64_t)time.tv_nsec;
+}
+static Buffer* buffer_get() {
+  if (!local && (local = calloc(1, sizeof(*local)))) {
+    local->thread = atomic_fetch_add_explicit(&threads, 1, memory_order_relaxed);
+    local->next = atomic_load_explicit(&buffers, memory_order_relaxed);
+    while (!atomic_compare_exchange_weak_explicit(
+      &buffers,
+      &local->next,
+      local,
+      memory_order_release,
+      memory_order_relaxed)) { }
+  }
+  return local;
+}
+static void record(const char* name, uint64_t begin, uint64_t end) {
+  Buffer* buffer = buffer_get();
+  if (buffer) {
+    const size_t count = atomic_load_explicit(&buffer->count, memory_order_relaxed);
+    buffer->events[count % TRACE_CAPACITY] = (Event){
+      .name = name,
+      .begin = begin,
+      .duration = end - begin,
+    };
+    atomic_store_explicit(&buffer->count, count + 1, memory_order_release);
+  }
+}
+Application_trace_Scope Application_trace_begin(const char* name) {
+  return (Application_trace_Scope){ .name = name, .begin = now() };
+}
+void Application_trace_end(Application_trace_Scope scope[static 1]) {
+  record(scope->name, scope->begin, now());
+}
+void Application_trace_push(const char* name) {
+  Buffer* buffer = buffer_get();
+  if (buffer && TRACE_DEPTH > buffer->depth) {
+    buffer->stack[buffer->depth] = Application_trace_begin(name);
+  }
+  if (buffer) {
+    buffer->depth++;
+  }
+}
+void Application_trace_pop() {
+  Buffer* buffer = buffer_get();
+  if (buffer && buffer->depth) {
+    buffer->depth--;
+    if (TRACE_DEPTH > buffer->depth) {
+      Application_trace_end(&buffer->stack[buffer->depth]);
+    }
+  }
+}
+void Application_trace_threadName(const char* name) {
+  Buffer* buffer = buffer_get();
+  if (buffer) {
+    buffer->name = name;
+  }
+}
+// events still being overwritten by a busy thread while writing may come out torn
+size_t Application_trace_write(FILE* output) {
+  size_t result = 0;
+  fprintf(output, "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [");
+  for (Buffer* buffer = atomic_load_explicit(&buffers, memory_order_acquire); buffer;
+       buffer = buffer->next) {
+    const size_t count = atomic_load_explicit(&buffer->count, memory_order_acquire);
+    const size_t first = count > TRACE_CAPACITY ? count - TRACE_CAPACITY : 0;
+    if (buffer->name) {
+      fprintf(
+        output,
+        "%s\n{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 0, \"tid\": %zu, "
+        "\"args\": {\"name\": \"%s\"}}",
+        result ? "," : "",
+        buffer->thread,
+        buffer->name);
+      result++;
+    }
+    for (size_t i = first; count > i; i++) {
+      const Event event = buffer->events[i % TRACE_CAPACITY];
+      fprintf(
+        output,
+        "%s\n{\"name\": \"%s\", \"ph\": \"X\", \"pid\": 0, \"tid\": %zu, "
+        "\"ts\": %.3f, \"dur\": %.3f}",
+        result ? "," : "",
+        event.name,
+        buffer->thread,
+        (double)event.begin / 1e3,
+        (double)event.duration / 1e3);
+      result++;
+    }
+  }
+  fprintf(output, "\n]}\n");
+  return result;
+}
+bool Application_trace_dump(const char* path) {
+  bool result = false;
+  FILE* output = fopen(path, "w");
+  if (!output) {
+    perror("Could not write the trace");
+  }
+  else {
+    const size_t count = Application_trace_write(output);
+    fclose(output);
+    printf("Wrote %zu trace events to %s\n", count, path);
+    result = true;
+  }
+  return result;
+}
@@ -0,0 +1,46 @@
+#ifndef trace_H_
+#define trace_H_
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+// CPU trace events, written as Chrome trace JSON (chrome://tracing, ui.perfetto.dev).
+// Without APPLICATION_TRACE defined the macros expand to nothing.
+typedef struct {
+    const char* name;
+    uint64_t begin;
+} Application_trace_Scope;
+
+Application_trace_Scope Application_trace_begin(const char* name);
+void Application_trace_end(Application_trace_Scope scope[static 1]);
+void Application_trace_push(const char* name);
+void Application_trace_pop();
+void Application_trace_threadName(const char* name);
+size_t Application_trace_write(FILE* output);
+bool Application_trace_dump(const char* path);
+
+#ifdef APPLICATION_TRACE
+  #define TRACE_CONCAT_(a, b) a##b
+  #define TRACE_CONCAT(a, b)  TRACE_CONCAT_(a, b)
+  // records the enclosing block
+  #define TRACE_SCOPE(name)                                      \
+    Application_trace_Scope TRACE_CONCAT(traceScope, __LINE__)   \
+      __attribute__((cleanup(Application_trace_end))) =          \
+        Application_trace_begin(name)
+  // records a section of a block, sections nest per thread
+  #define TRACE_BEGIN(name) Application_trace_push(name)
+  #define TRACE_END()       Application_trace_pop()
+  // names the calling thread in the trace
+  #define TRACE_THREAD_NAME(name) Application_trace_threadName(name)
+  // writes the events recorded so far
+  #define TRACE_DUMP(path)        Application_trace_dump(path)
+#else
+  #define TRACE_SCOPE(name)
+  #define TRACE_BEGIN(name)
+  #define TRACE_END()
+  #define TRACE_THREAD_NAME(name)
+  #define TRACE_DUMP(path)
+#endif
+
+#endif // trace_H_
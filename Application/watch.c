@@ -0,0 +1,129 @@
+#include "watch.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#ifdef __linux__
+  #include <unistd.h>
+  #include <libgen.h>
+  #include <sys/inotify.h>
+#endif
+
+#define WATCH_CAPACITY (64)
+
+typedef struct {
+    int directory; // inotify watch descriptor, shared by the files of a directory
+    char* path;
+    const char* name; // points into path
+    bool changed;
+} File;
+struct Application_watch {
+    int descriptor;
+    File files[WATCH_CAPACITY];
+    size_t count;
+};
+
+#ifdef __linux__
+Application_watch* Application_watch_create() {
+  Application_watch* result = calloc(1, sizeof(*result));
+  if (!result) {
+    perror("Watch allocation failed");
+  }
+  else if ((result->descriptor = inotify_init1(IN_NONBLOCK | IN_CLOEXEC)) < 0) {
+    perror("Could not initialize inotify");
+    free(result);
+    result = 0;
+  }
+  return result;
+}
+void Application_watch_destroy(Application_watch* watch) {
+  if (watch) {
+    for (size_t i = 0; watch->count > i; i++) {
+      free(watch->files[i].path);
+    }
+    close(watch->descriptor);
+    free(watch);
+  }
+}
+bool Application_watch_add(Application_watch* watch, const char* path) {
+  bool result = false;
+  for (size_t i = 0; watch->count > i; i++) {
+    if (!strcmp(watch->files[i].path, path)) {
+      return true;
+    }
+  }
+  char* directory = strdup(path);
+  char* copy = strdup(path);
+  if (WATCH_CAPACITY == watch->count) {
+    fprintf(stderr, "Cannot watch %s, the watch is full.\n", path);
+  }
+  else if (!directory || !copy) {
+    perror("Watch allocation failed");
+  }
+  else {
+    const int descriptor = inotify_add_watch(
+      watch->descriptor,
+      dirname(directory),
+      IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE);
+    if (descriptor < 0) {
+      fprintf(stderr, "Cannot watch %s: %s\n", path, strerror(errno));
+    }
+    else {
+      const char* name = strrchr(copy, '/');
+      watch->files[watch->count++] = (File){
+        .directory = descriptor,
+        .path = copy,
+        .name = name ? name + 1 : copy,
+      };
+      copy = 0;
+      result = true;
+    }
+  }
+  free(directory);
+  free(copy);
+  return result;
+}
+size_t Application_watch_poll(
+  Application_watch* watch,
+  const char* changed[],
+  size_t capacity) {
+  char buffer[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+  ssize_t length = 0;
+  while ((length = read(watch->descriptor, buffer, sizeof(buffer))) > 0) {
+    for (char* cursor = buffer; buffer + length > cursor;) {
+      const struct inotify_event* event = (const struct inotify_event*)cursor;
+      for (size_t i = 0; event->len && watch->count > i; i++) {
+        File* file = &watch->files[i];
+        if (file->directory == event->wd && !strcmp(file->name, event->name)) {
+          file->changed = true;
+        }
+      }
+      cursor += sizeof(struct inotify_event) + event->len;
+    }
+  }
+  size_t result = 0;
+  for (size_t i = 0; watch->count > i && capacity > result; i++) {
+    if (watch->files[i].changed) {
+      watch->files[i].changed = false;
+      changed[result++] = watch->files[i].path;
+    }
+  }
+  return result;
+}
+#else
+Application_watch* Application_watch_create() {
+  fprintf(stderr, "File watching is only available on Linux.\n");
+  return 0;
+}
+void Application_watch_destroy(Application_watch* /* watch */) {
+}
+bool Application_watch_add(Application_watch* /* watch */, const char* /* path */) {
+  return false;
+}
+size_t Application_watch_poll(
+  Application_watch* /* watch */,
+  const char* /* changed */[],
+  size_t /* capacity */) {
+  return 0;
+}
+#endif
@@ -0,0 +1,22 @@
+#ifndef watch_H_
+#define watch_H_
+
+#include <stddef.h>
+#include <stdbool.h>
+
+// Watches files for changes with inotify. The directories are watched rather than the
+// files, editors usually save by writing a new file and renaming it over the old one.
+// Elsewhere than on Linux nothing is ever reported.
+typedef struct Application_watch Application_watch;
+
+Application_watch* Application_watch_create();
+void Application_watch_destroy(Application_watch* watch);
+bool Application_watch_add(Application_watch* watch, const char* path);
+// never blocks, the returned paths compare equal to the ones given to add, a file
+// changed several times since the last poll is reported once
+size_t Application_watch_poll(
+  Application_watch* watch,
+  const char* changed[],
+  size_t capacity);
+
+#endif // watch_H_
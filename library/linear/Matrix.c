@@ -1,18 +1,36 @@
 #include "algebra.h"
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 #include <tgmath.h>
 
+// the header padded to the alignment of the elements
+#define MATRIX_HEADER ((sizeof(Matrix) + LINEAR_ALIGN - 1) / LINEAR_ALIGN * LINEAR_ALIGN)
+
+static Matrix* Matrix_place(void* memory, size_t rows, size_t columns) {
+  Matrix* result = memory;
+  if (result) {
+    *result = (Matrix){
+      .elements = (double*)((unsigned char*)memory + MATRIX_HEADER),
+      .rows = rows,
+      .columns = columns,
+    };
+  }
+  return result;
+}
 Matrix* Matrix_create(size_t rows, size_t columns) {
-  Matrix* result = calloc(1, sizeof(*result));
-  result->elements = calloc(rows * columns, sizeof(*(result->elements)));
-  result->rows = rows;
-  result->columns = columns;
+  const size_t size = MATRIX_HEADER + rows * columns * sizeof(double);
+  Matrix* result = Matrix_place(Linear_allocate(size), rows, columns);
+  if (result) {
+    memset(result->elements, 0, rows * columns * sizeof(*result->elements));
+  }
   return result;
 }
+Matrix* Matrix_createIn(Arena* arena, size_t rows, size_t columns) {
+  const size_t size = MATRIX_HEADER + rows * columns * sizeof(double);
+  return Matrix_place(Arena_allocate(arena, size), rows, columns);
+}
 void Matrix_destroy(Matrix* matrix) {
-  free(matrix->elements);
-  matrix->elements = 0;
   free(matrix);
 }
 void Matrix_fill(Matrix matrix[static 1], double value) {
@@ -28,36 +46,15 @@ void Matrix_setDiagonal(Matrix matrix[static 1], double value) {
 void Matrix_add(Matrix a[static 1], Matrix b[static 1], Matrix result[static 1]) {
   for (size_t n = 0; a->rows > n; n++) {
     for (size_t m = 0; a->columns > m; m++) {
-      result->elements[a->rows * n + m] =
-        a->elements[a->rows * n + m] + b->elements[a->rows * n + m];
-    }
-  }
-}
-void Matrix_multiply(Matrix a[static 1], Matrix b[static 1], Matrix result[static 1]) {
-  for (size_t n = 0; a->rows > n; n++) {
-    for (size_t m = 0; b->columns > m; m++) {
-      for (size_t k = 0; a->columns > k; k++) {
-        result->elements[a->rows * n + m] +=
-          a->elements[a->rows * n + k] * b->elements[k * b->columns + m];
-      }
-    }
-  }
-}
-void Matrix_differentiate(Matrix result[static 1]) {
-  register const double height = 2 * M_PI / result->columns;
-  for (size_t n = 0; result->columns > n; n++) {
-    for (size_t m = 0; result->columns > m; m++) {
-      result->elements[n * result->rows + m] =
-        0.5 * pow(-1, m + n)
-        * ((m - n) ? tan(M_PI_2 - ((double)(result->columns - (m - n)) * 0.5 * height)) : 0);
+      result->elements[a->columns * n + m] =
+        a->elements[a->columns * n + m] + b->elements[a->columns * n + m];
     }
   }
-  return;
 }
 void Matrix_print(Matrix matrix[static 1]) {
   for (size_t n = 0; matrix->rows > n; n++) {
     for (size_t m = 0; matrix->columns > m; m++) {
-      printf("%g, ", matrix->elements[matrix->rows * n + m]);
+      printf("%g, ", matrix->elements[matrix->columns * n + m]);
     }
     printf("\n");
   }
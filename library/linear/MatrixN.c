@@ -1,4 +1,5 @@
 #include "algebra.h"
+#include "simd.h"
 #include <stdio.h>
 #include <tgmath.h>
 
@@ -18,6 +19,22 @@ Matrix4f Matrix4f_diagonal(float value) {
 }
 Matrix4f Matrix4f_transpose(Matrix4f matrix) {
   Matrix4f result = { 0 };
+#if LINEAR_SSE
+  __m128 rows[4];
+  for (size_t n = 0; 4 > n; n++) {
+    rows[n] = _mm_loadu_ps(&matrix.elements[4 * n]);
+  }
+  _MM_TRANSPOSE4_PS(rows[0], rows[1], rows[2], rows[3]);
+  for (size_t n = 0; 4 > n; n++) {
+    _mm_storeu_ps(&result.elements[4 * n], rows[n]);
+  }
+#elif LINEAR_NEON
+  // the interleaved load reads the columns
+  const float32x4x4_t columns = vld4q_f32(matrix.elements);
+  for (size_t n = 0; 4 > n; n++) {
+    vst1q_f32(&result.elements[4 * n], columns.val[n]);
+  }
+#else
   result.elements[0] = matrix.elements[0];
   result.elements[1] = matrix.elements[4];
   result.elements[2] = matrix.elements[8];
@@ -34,6 +51,7 @@ Matrix4f Matrix4f_transpose(Matrix4f matrix) {
   result.elements[13] = matrix.elements[7];
   result.elements[14] = matrix.elements[11];
   result.elements[15] = matrix.elements[15];
+#endif
   return result;
 }
 Matrix4f Matrix4f_add(Matrix4f a, Matrix4f b) {
@@ -43,8 +61,36 @@ Matrix4f Matrix4f_add(Matrix4f a, Matrix4f b) {
   }
   return result;
 }
+// a row of the result is the rows of b weighted by the row of a
 Matrix4f Matrix4f_multiply(Matrix4f a, Matrix4f b) {
   Matrix4f result = { 0 };
+#if LINEAR_SSE
+  __m128 rows[4];
+  for (size_t k = 0; 4 > k; k++) {
+    rows[k] = _mm_loadu_ps(&b.elements[4 * k]);
+  }
+  for (size_t n = 0; 4 > n; n++) {
+    const __m128 weights = _mm_loadu_ps(&a.elements[4 * n]);
+    __m128 row = _mm_mul_ps(LINEAR_SWIZZLE(weights, 0, 0, 0, 0), rows[0]);
+    row = linear_madd(LINEAR_SWIZZLE(weights, 1, 1, 1, 1), rows[1], row);
+    row = linear_madd(LINEAR_SWIZZLE(weights, 2, 2, 2, 2), rows[2], row);
+    row = linear_madd(LINEAR_SWIZZLE(weights, 3, 3, 3, 3), rows[3], row);
+    _mm_storeu_ps(&result.elements[4 * n], row);
+  }
+#elif LINEAR_NEON
+  float32x4_t rows[4];
+  for (size_t k = 0; 4 > k; k++) {
+    rows[k] = vld1q_f32(&b.elements[4 * k]);
+  }
+  for (size_t n = 0; 4 > n; n++) {
+    const float32x4_t weights = vld1q_f32(&a.elements[4 * n]);
+    float32x4_t row = vmulq_laneq_f32(rows[0], weights, 0);
+    row = vfmaq_laneq_f32(row, rows[1], weights, 1);
+    row = vfmaq_laneq_f32(row, rows[2], weights, 2);
+    row = vfmaq_laneq_f32(row, rows[3], weights, 3);
+    vst1q_f32(&result.elements[4 * n], row);
+  }
+#else
   for (size_t n = 0; 4 > n; n++) {
     for (size_t m = 0; 4 > m; m++) {
       for (size_t k = 0; 4 > k; k++) {
@@ -52,6 +98,82 @@ Matrix4f Matrix4f_multiply(Matrix4f a, Matrix4f b) {
       }
     }
   }
+#endif
+  return result;
+}
+#if LINEAR_SSE
+// products of the 2x2 blocks stored row major in a vector, # is the adjugate
+static inline __m128 block_multiply(__m128 a, __m128 b) {
+  return _mm_add_ps(
+    _mm_mul_ps(a, LINEAR_SWIZZLE(b, 0, 3, 0, 3)),
+    _mm_mul_ps(LINEAR_SWIZZLE(a, 1, 0, 3, 2), LINEAR_SWIZZLE(b, 2, 1, 2, 1)));
+}
+// a# b
+static inline __m128 block_adjugateMultiply(__m128 a, __m128 b) {
+  return _mm_sub_ps(
+    _mm_mul_ps(LINEAR_SWIZZLE(a, 3, 3, 0, 0), b),
+    _mm_mul_ps(LINEAR_SWIZZLE(a, 1, 1, 2, 2), LINEAR_SWIZZLE(b, 2, 3, 0, 1)));
+}
+// a b#
+static inline __m128 block_multiplyAdjugate(__m128 a, __m128 b) {
+  return _mm_sub_ps(
+    _mm_mul_ps(a, LINEAR_SWIZZLE(b, 3, 0, 3, 0)),
+    _mm_mul_ps(LINEAR_SWIZZLE(a, 1, 0, 3, 2), LINEAR_SWIZZLE(b, 2, 1, 2, 1)));
+}
+#endif
+// the inverse of a singular matrix is not finite
+Matrix4f Matrix4f_inverse(Matrix4f matrix) {
+  Matrix4f result = { 0 };
+#if LINEAR_SSE
+  // by 2x2 blocks | A B |
+  //               | C D |
+  __m128 rows[4];
+  for (size_t n = 0; 4 > n; n++) {
+    rows[n] = _mm_loadu_ps(&matrix.elements[4 * n]);
+  }
+  const __m128 A = _mm_movelh_ps(rows[0], rows[1]);
+  const __m128 B = _mm_movehl_ps(rows[1], rows[0]);
+  const __m128 C = _mm_movelh_ps(rows[2], rows[3]);
+  const __m128 D = _mm_movehl_ps(rows[3], rows[2]);
+  // the determinants of A, B, C and D
+  const __m128 determinants = _mm_sub_ps(
+    _mm_mul_ps(
+      LINEAR_SHUFFLE(rows[0], rows[2], 0, 2, 0, 2),
+      LINEAR_SHUFFLE(rows[1], rows[3], 1, 3, 1, 3)),
+    _mm_mul_ps(
+      LINEAR_SHUFFLE(rows[0], rows[2], 1, 3, 1, 3),
+      LINEAR_SHUFFLE(rows[1], rows[3], 0, 2, 0, 2)));
+  const __m128 detA = LINEAR_SWIZZLE(determinants, 0, 0, 0, 0);
+  const __m128 detB = LINEAR_SWIZZLE(determinants, 1, 1, 1, 1);
+  const __m128 detC = LINEAR_SWIZZLE(determinants, 2, 2, 2, 2);
+  const __m128 detD = LINEAR_SWIZZLE(determinants, 3, 3, 3, 3);
+  const __m128 DC = block_adjugateMultiply(D, C);
+  const __m128 AB = block_adjugateMultiply(A, B);
+  // the adjugates of the blocks of the inverse
+  __m128 X = _mm_sub_ps(_mm_mul_ps(detD, A), block_multiply(B, DC));
+  __m128 W = _mm_sub_ps(_mm_mul_ps(detA, D), block_multiply(C, AB));
+  __m128 Y = _mm_sub_ps(_mm_mul_ps(detB, C), block_multiplyAdjugate(D, AB));
+  __m128 Z = _mm_sub_ps(_mm_mul_ps(detC, B), block_multiplyAdjugate(A, DC));
+  // |M| = |A| |D| + |B| |C| - tr((A# B) (D# C))
+  __m128 trace = _mm_mul_ps(AB, LINEAR_SWIZZLE(DC, 0, 2, 1, 3));
+  trace = _mm_add_ps(trace, LINEAR_SWIZZLE(trace, 1, 0, 3, 2));
+  trace = _mm_add_ps(trace, LINEAR_SWIZZLE(trace, 2, 3, 0, 1));
+  const __m128 determinant =
+    _mm_sub_ps(_mm_add_ps(_mm_mul_ps(detA, detD), _mm_mul_ps(detB, detC)), trace);
+  const __m128 signs = _mm_setr_ps(1.0f, -1.0f, -1.0f, 1.0f);
+  const __m128 reciprocal = _mm_div_ps(signs, determinant);
+  X = _mm_mul_ps(X, reciprocal);
+  Y = _mm_mul_ps(Y, reciprocal);
+  Z = _mm_mul_ps(Z, reciprocal);
+  W = _mm_mul_ps(W, reciprocal);
+  // the adjugates undone while the blocks are put back in rows
+  _mm_storeu_ps(&result.elements[0], LINEAR_SHUFFLE(X, Y, 3, 1, 3, 1));
+  _mm_storeu_ps(&result.elements[4], LINEAR_SHUFFLE(X, Y, 2, 0, 2, 0));
+  _mm_storeu_ps(&result.elements[8], LINEAR_SHUFFLE(Z, W, 3, 1, 3, 1));
+  _mm_storeu_ps(&result.elements[12], LINEAR_SHUFFLE(Z, W, 2, 0, 2, 0));
+#else
+  linear_inverse4_float(matrix.elements, result.elements);
+#endif
   return result;
 }
 void Matrix4f_print(Matrix4f matrix) {
@@ -104,9 +226,9 @@ Matrix4f Matrix4f_lookAt(Vector3f position, Vector3f target, Vector3f up) {
   ori.elements[8] = -forward.components[0];
   ori.elements[9] = -forward.components[1];
   ori.elements[10] = -forward.components[2];
-  Matrix4f p = Matrix4f_diagonal(1.0);
-  p.elements[3] = -position.components[0];
-  p.elements[7] = -position.components[1];
-  p.elements[11] = -position.components[2];
-  return Matrix4f_multiply(ori, p);
+  // the translation by -position is applied to the rotation rows without a product
+  ori.elements[3] = -Vector3f_inner(right, position);
+  ori.elements[7] = -Vector3f_inner(u, position);
+  ori.elements[11] = Vector3f_inner(forward, position);
+  return ori;
 }
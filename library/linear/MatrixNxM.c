@@ -0,0 +1,112 @@
+#include "algebra.h"
+#include "simd.h"
+
+// The loops run over the dimensions, which are constants of every instance, and are
+// unrolled completely so that the elements are kept in registers. The float 4x4 kernels
+// are those of MatrixN.c and VectorN.c.
+#define MatrixNxM_transpose(N, M, f)                                             \
+  Matrix##M##x##N##f Matrix##N##x##M##f##_transpose(Matrix##N##x##M##f matrix) { \
+    Matrix##M##x##N##f result = { 0 };                                           \
+    LINEAR_UNROLL for (size_t n = 0; N > n; n++) {                               \
+      LINEAR_UNROLL for (size_t m = 0; M > m; m++) {                             \
+        result.elements[N * m + n] = matrix.elements[M * n + m];                 \
+      }                                                                          \
+    }                                                                            \
+    return result;                                                               \
+  }
+#define MatrixNxM_transform(N, M, f, T)                      \
+  Vector##N##f Matrix##N##x##M##f##_transform(               \
+    Matrix##N##x##M##f matrix, Vector##M##f v) {             \
+    Vector##N##f result = { 0 };                             \
+    LINEAR_UNROLL for (size_t n = 0; N > n; n++) {           \
+      T sum = 0;                                             \
+      LINEAR_UNROLL for (size_t m = 0; M > m; m++) {         \
+        sum += matrix.elements[M * n + m] * v.components[m]; \
+      }                                                      \
+      result.components[n] = sum;                            \
+    }                                                        \
+    return result;                                           \
+  }
+#define MatrixNxM_multiply(N, M, P, f, T)                       \
+  Matrix##N##x##P##f Matrix##N##x##M##f##_multiply##M##x##P(    \
+    Matrix##N##x##M##f a, Matrix##M##x##P##f b) {               \
+    Matrix##N##x##P##f result = { 0 };                          \
+    LINEAR_UNROLL for (size_t n = 0; N > n; n++) {              \
+      LINEAR_UNROLL for (size_t p = 0; P > p; p++) {            \
+        T sum = 0;                                              \
+        LINEAR_UNROLL for (size_t m = 0; M > m; m++) {          \
+          sum += a.elements[M * n + m] * b.elements[P * m + p]; \
+        }                                                       \
+        result.elements[P * n + p] = sum;                       \
+      }                                                         \
+    }                                                           \
+    return result;                                              \
+  }
+#define MatrixNxM_kernels(N, M, f, T)                                   \
+  MatrixNxM_transpose(N, M, f) MatrixNxM_transform(N, M, f, T)          \
+    MatrixNxM_multiply(N, M, 2, f, T) MatrixNxM_multiply(N, M, 3, f, T) \
+      MatrixNxM_multiply(N, M, 4, f, T)
+
+// adjugates over determinants
+#define MatrixN_inverse(f, T)                                    \
+  Matrix2x2##f Matrix2x2##f##_inverse(Matrix2x2##f matrix) {     \
+    const T* m = matrix.elements;                                \
+    const T reciprocal = 1 / (m[0] * m[3] - m[1] * m[2]);        \
+    return (Matrix2x2##f){ .elements = {                         \
+                             m[3] * reciprocal,                  \
+                             -m[1] * reciprocal,                 \
+                             -m[2] * reciprocal,                 \
+                             m[0] * reciprocal,                  \
+                           } };                                  \
+  }                                                              \
+  Matrix3x3##f Matrix3x3##f##_inverse(Matrix3x3##f matrix) {     \
+    const T* m = matrix.elements;                                \
+    Matrix3x3##f result = { .elements = {                        \
+                              m[4] * m[8] - m[5] * m[7],         \
+                              m[2] * m[7] - m[1] * m[8],         \
+                              m[1] * m[5] - m[2] * m[4],         \
+                              m[5] * m[6] - m[3] * m[8],         \
+                              m[0] * m[8] - m[2] * m[6],         \
+                              m[2] * m[3] - m[0] * m[5],         \
+                              m[3] * m[7] - m[4] * m[6],         \
+                              m[1] * m[6] - m[0] * m[7],         \
+                              m[0] * m[4] - m[1] * m[3],         \
+                            } };                                 \
+    const T reciprocal =                                         \
+      1 / (m[0] * result.elements[0] + m[1] * result.elements[3] \
+           + m[2] * result.elements[6]);                         \
+    LINEAR_UNROLL for (size_t n = 0; 9 > n; n++) {               \
+      result.elements[n] *= reciprocal;                          \
+    }                                                            \
+    return result;                                               \
+  }
+
+MatrixNxM_kernels(2, 2, , double) MatrixNxM_kernels(2, 3, , double)
+  MatrixNxM_kernels(2, 4, , double) MatrixNxM_kernels(3, 2, , double)
+    MatrixNxM_kernels(3, 3, , double) MatrixNxM_kernels(3, 4, , double)
+      MatrixNxM_kernels(4, 2, , double) MatrixNxM_kernels(4, 3, , double)
+        MatrixNxM_kernels(4, 4, , double) MatrixNxM_kernels(2, 2, f, float)
+          MatrixNxM_kernels(2, 3, f, float) MatrixNxM_kernels(2, 4, f, float)
+            MatrixNxM_kernels(3, 2, f, float) MatrixNxM_kernels(3, 3, f, float)
+              MatrixNxM_kernels(3, 4, f, float) MatrixNxM_kernels(4, 2, f, float)
+                MatrixNxM_kernels(4, 3, f, float) MatrixNxM_multiply(4, 4, 2, f, float)
+                  MatrixNxM_multiply(4, 4, 3, f, float) MatrixN_inverse(, double)
+                    MatrixN_inverse(f, float)
+
+Matrix4x4f Matrix4x4f_transpose(Matrix4x4f matrix) {
+  return Matrix4f_transpose(matrix);
+}
+Vector4f Matrix4x4f_transform(Matrix4x4f matrix, Vector4f v) {
+  return Vector4f_transform(matrix, v);
+}
+Matrix4x4f Matrix4x4f_multiply4x4(Matrix4x4f a, Matrix4x4f b) {
+  return Matrix4f_multiply(a, b);
+}
+Matrix4x4f Matrix4x4f_inverse(Matrix4x4f matrix) {
+  return Matrix4f_inverse(matrix);
+}
+Matrix4x4 Matrix4x4_inverse(Matrix4x4 matrix) {
+  Matrix4x4 result = { 0 };
+  linear_inverse4_double(matrix.elements, result.elements);
+  return result;
+}
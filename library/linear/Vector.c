@@ -1,21 +1,37 @@
 #include "algebra.h"
+#include "simd.h"
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
 #include <tgmath.h>
 
+// the header padded to the alignment of the components
+#define VECTOR_HEADER ((sizeof(Vector) + LINEAR_ALIGN - 1) / LINEAR_ALIGN * LINEAR_ALIGN)
+
+static Vector* Vector_place(void* memory, size_t length) {
+  Vector* result = memory;
+  if (result) {
+    *result = (Vector){
+      .components = (double*)((unsigned char*)memory + VECTOR_HEADER),
+      .length = length,
+    };
+  }
+  return result;
+}
 Vector* Vector_create(size_t length) {
-  Vector* result = calloc(1, sizeof(*result));
-  result->components = calloc(length, sizeof(*(result->components)));
-  result->length = length;
+  Vector* result =
+    Vector_place(Linear_allocate(VECTOR_HEADER + length * sizeof(double)), length);
+  if (result) {
+    memset(result->components, 0, length * sizeof(*result->components));
+  }
   return result;
 }
+Vector* Vector_createIn(Arena* arena, size_t length) {
+  const size_t size = VECTOR_HEADER + length * sizeof(double);
+  return Vector_place(Arena_allocate(arena, size), length);
+}
 void Vector_destroy(Vector* vector) {
-  free(vector->components);
-  vector->components = 0;
-  vector->length = 0;
   free(vector);
-  vector = 0;
 }
 void Vector_fill(Vector vector[static 1], double value) {
   for (size_t n = 0; vector->length > n; n++) {
@@ -55,22 +71,27 @@ void(Vector_subtract)(Vector a[static 1], Vector b[static 1], Vector* result) {
     result->components[n] = a->components[n] - b->components[n];
   }
 }
+// the rows in lanes, summed across at the end
 void(Vector_transform)(Matrix matrix[static 1], Vector v[static 1], Vector* result) {
-  for (size_t n = 0; v->length > n; n++) {
-    for (size_t m = 0; matrix->columns > m; m++) {
-      result->components[n] +=
-        v->components[m] * matrix->elements[matrix->columns * n + m];
+  const size_t columns = matrix->columns;
+  for (size_t n = 0; matrix->rows > n; n++) {
+    const double* row = &matrix->elements[columns * n];
+    linear_doubles sums = linear_fillDoubles(0.0);
+    size_t m = 0;
+    for (; columns >= m + LINEAR_DOUBLES; m += LINEAR_DOUBLES) {
+      const linear_doubles value = linear_loadDoubles(&v->components[m]);
+      sums = linear_maddDoubles(linear_loadDoubles(&row[m]), value, sums);
     }
-  }
-}
-void Vector_differentiate(Vector input[static 1], Vector result[static 1]) {
-  register const double height = 2 * M_PI / input->length;
-  for (size_t n = 0; input->length > n; n++) {
-    for (size_t m = 0; input->length > m; m++) {
-      result->components[n] +=
-        input->components[m] * 0.5 * pow(-1, m + n)
-        * ((m - n) ? tan(M_PI_2 - ((input->length - (m - n)) * 0.5 * height)) : 0);
+    double lanes[LINEAR_DOUBLES];
+    linear_storeDoubles(lanes, sums);
+    double sum = 0;
+    for (size_t lane = 0; LINEAR_DOUBLES > lane; lane++) {
+      sum += lanes[lane];
+    }
+    for (; columns > m; m++) {
+      sum += row[m] * v->components[m];
     }
+    result->components[n] = sum;
   }
 }
 void(Vector_print)(Vector vector[static 1]) {
@@ -1,4 +1,5 @@
 #include "algebra.h"
+#include "simd.h"
 #include <stdio.h>
 #include <stdbool.h>
 #include <tgmath.h>
@@ -188,7 +189,8 @@ Vector4f Vector4f_make(float x, float y, float z, float w) {
       }                                                                       \
     }                                                                         \
     return result;                                                            \
-  }                                                                           \
+  }
+#define VectorNf_transform(N)                                                 \
   Vector##N##f Vector##N##f_transform(Matrix##N##f matrix, Vector##N##f v) {  \
     Vector##N##f result = { 0 };                                              \
     for (size_t n = 0; N > n; n++) {                                          \
@@ -213,6 +215,38 @@ Vector4f Vector4f_make(float x, float y, float z, float w) {
     }                                            \
     printf(" ]\n");                              \
   }
+// the columns of the matrix weighted by the components of v
+Vector4f Vector4f_transform(Matrix4f matrix, Vector4f v) {
+  Vector4f result = { 0 };
+#if LINEAR_SSE
+  __m128 columns[4];
+  for (size_t n = 0; 4 > n; n++) {
+    columns[n] = _mm_loadu_ps(&matrix.elements[4 * n]);
+  }
+  _MM_TRANSPOSE4_PS(columns[0], columns[1], columns[2], columns[3]);
+  const __m128 w = _mm_loadu_ps(v.components);
+  __m128 sum = _mm_mul_ps(columns[0], LINEAR_SWIZZLE(w, 0, 0, 0, 0));
+  sum = linear_madd(columns[1], LINEAR_SWIZZLE(w, 1, 1, 1, 1), sum);
+  sum = linear_madd(columns[2], LINEAR_SWIZZLE(w, 2, 2, 2, 2), sum);
+  sum = linear_madd(columns[3], LINEAR_SWIZZLE(w, 3, 3, 3, 3), sum);
+  _mm_storeu_ps(result.components, sum);
+#elif LINEAR_NEON
+  const float32x4x4_t columns = vld4q_f32(matrix.elements);
+  const float32x4_t w = vld1q_f32(v.components);
+  float32x4_t sum = vmulq_laneq_f32(columns.val[0], w, 0);
+  sum = vfmaq_laneq_f32(sum, columns.val[1], w, 1);
+  sum = vfmaq_laneq_f32(sum, columns.val[2], w, 2);
+  sum = vfmaq_laneq_f32(sum, columns.val[3], w, 3);
+  vst1q_f32(result.components, sum);
+#else
+  for (size_t n = 0; 4 > n; n++) {
+    for (size_t m = 0; 4 > m; m++) {
+      result.components[n] += v.components[m] * matrix.elements[4 * n + m];
+    }
+  }
+#endif
+  return result;
+}
 Vector3 Vector3_cross(Vector3 v, Vector3 w) {
   Vector3 result = { 0 };
   result.components[0] =
@@ -239,5 +273,5 @@ VectorN_fill(2) VectorN_fill(3) VectorN_fill(4) VectorN_from(2) VectorN_from(3)
       VectorN_subtract(4) VectorN_areEqual(2) VectorN_areEqual(3) VectorN_areEqual(4)
         VectorN_inner(2) VectorN_inner(3) VectorN_inner(4) VectorN_norm(2) VectorN_norm(3)
           VectorN_norm(4) VectorN_normalize(2) VectorN_normalize(3) VectorN_normalize(4)
-            VectorN_transform(3) VectorN_transform(4) VectorN_print(2) VectorN_print(3)
-              VectorN_print(4)
+            VectorN_transform(3) VectorN_transform(4) VectorNf_transform(3)
+              VectorN_print(2) VectorN_print(3) VectorN_print(4)
@@ -42,6 +42,38 @@ typedef struct {
 typedef struct {
     float components[2];
 } Vector2f;
+// x, y and z the vector part and w the scalar, rotations are unit quaternions
+typedef struct {
+    float components[4];
+} Quaternionf;
+// a rotation then a translation t, the dual part is t real / 2 with t a pure quaternion
+typedef struct {
+    Quaternionf real;
+    Quaternionf dual;
+} DualQuaternionf;
+// the matrix of translation rotation scale, applied to points in the reverse order
+typedef struct {
+    Vector3f translation;
+    Quaternionf rotation;
+    Vector3f scale;
+} Transformf;
+// the fixed sizes of n rows and m columns, the square ones are also MatrixN
+#define MatrixNxM_types(N, M) \
+  typedef struct {            \
+      double elements[N * M]; \
+  } Matrix##N##x##M;          \
+  typedef struct {            \
+      float elements[N * M];  \
+  } Matrix##N##x##M##f;
+MatrixNxM_types(2, 3) MatrixNxM_types(2, 4) MatrixNxM_types(3, 2) MatrixNxM_types(3, 4)
+  MatrixNxM_types(4, 2) MatrixNxM_types(4, 3)
+#undef MatrixNxM_types
+typedef Matrix2 Matrix2x2;
+typedef Matrix3 Matrix3x3;
+typedef Matrix4 Matrix4x4;
+typedef Matrix2f Matrix2x2f;
+typedef Matrix3f Matrix3x3f;
+typedef Matrix4f Matrix4x4f;
 typedef struct {
     double* restrict components;
     size_t length;
@@ -51,17 +83,72 @@ typedef struct {
     size_t rows;
     size_t columns;
 } Matrix;
+// structures of arrays, element n of matrix i is elements[n][i], the arrays are 64 byte
+// aligned and padded to a whole number of cache lines
+typedef struct {
+    float* restrict elements[16];
+    size_t count;
+} Matrix4fBatch;
+typedef struct {
+    float* restrict components[3];
+    size_t count;
+} Vector3fBatch;
+// entry (n, m) is row[(m - n) mod length], only the row is stored
+typedef struct {
+    double* restrict row;
+    size_t length;
+    bool antisymmetric; // row[length - d] = -row[d], as for derivatives
+    bool cached; // kept by Circulant_differentiation, Circulant_destroy leaves it
+} Circulant;
+typedef struct Batch_pool Batch_pool;
+// a scratch allocator, its allocations are freed all at once by a rewind
+typedef struct Arena Arena;
+typedef struct Arena_block Arena_block;
+typedef struct {
+    Arena_block* block;
+    size_t used;
+} Arena_Mark;
 
+// the alignment of the elements of Matrix, Vector and the batches
+#define LINEAR_ALIGN (64)
+
+// heap allocations of LINEAR_ALIGN aligned memory, counted, released with free
+void* Linear_allocate(size_t size);
+size_t Linear_allocations();
+// releases the cached FFT plans and differentiation operators, none may be in use
+void Linear_clear();
+// the capacity of a block in bytes, larger allocations get a block of their own
+Arena* Arena_create(size_t capacity);
+void Arena_destroy(Arena* arena);
+// aligned to LINEAR_ALIGN and zeroed
+void* Arena_allocate(Arena* arena, size_t size);
+Arena_Mark Arena_mark(const Arena* arena);
+// frees everything allocated since the mark
+void Arena_rewind(Arena* arena, Arena_Mark mark);
+void Arena_reset(Arena* arena);
+
+// the elements follow the header in a single allocation
 Matrix* Matrix_create(size_t rows, size_t columns);
+// in the arena, freed by its rewind rather than Matrix_destroy
+Matrix* Matrix_createIn(Arena* arena, size_t rows, size_t columns);
 void Matrix_destroy(Matrix* matrix);
 void Matrix_fill(Matrix matrix[static 1], double value);
 void Matrix_setDiagonal(Matrix matrix[static 1], double value);
 void Matrix_add(Matrix a[static 1], Matrix b[static 1], Matrix result[static 1]);
+// result = a b into a matrix distinct from the inputs, with the shape of the product
 void Matrix_multiply(Matrix a[static 1], Matrix b[static 1], Matrix result[static 1]);
+// the blocks of rows of the result split across the pool
+void Matrix_multiplyParallel(
+  Batch_pool* pool,
+  Matrix a[static 1],
+  Matrix b[static 1],
+  Matrix result[static 1]);
+// the dense periodic differentiation matrix, Circulant_apply does without it
 void Matrix_differentiate(Matrix result[static 1]);
 void Matrix_print(Matrix matrix[static 1]);
 
 Vector* Vector_create(size_t length);
+Vector* Vector_createIn(Arena* arena, size_t length);
 void Vector_destroy(Vector* vector);
 void Vector_set(Vector vector[static 1], double values[static vector->length]);
 Vector* Vector_from(size_t length, double values[static length]);
@@ -71,10 +158,73 @@ void(Vector_add)(Vector a[static 1], Vector b[static 1], Vector result[static 1]
 void(Vector_subtract)(Vector a[static 1], Vector b[static 1], Vector* result);
 double(Vector_inner)(Vector a[static 1], Vector b[static 1]);
 double(Vector_norm)(Vector vector[static 1]);
+// the derivative of periodic samples over 2 pi into a vector distinct from the input,
+// by a fast Fourier transform for even lengths
 void Vector_differentiate(Vector input[static 1], Vector result[static 1]);
+// result = matrix v into a vector distinct from v
 void(Vector_transform)(Matrix matrix[static 1], Vector v[static 1], Vector* result);
 void(Vector_print)(Vector vector[static 1]);
 
+// zero threads uses every core, a null pool runs the batches on the calling thread
+Batch_pool* Batch_pool_create(size_t threads);
+void Batch_pool_destroy(Batch_pool* pool);
+// calls job on ranges of grain indices from begin to end across the pool and the calling
+// thread, the ranges start at begin plus a multiple of the grain
+typedef void (*Batch_job)(void* context, size_t begin, size_t end);
+void Batch_pool_run(
+  Batch_pool* pool,
+  Batch_job job,
+  void* context,
+  size_t begin,
+  size_t end,
+  size_t grain);
+// the threads a run is spread on, one for a null pool
+size_t Batch_pool_threads(const Batch_pool* pool);
+// the thread running a job below Batch_pool_threads, zero for the one that started the
+// run, so that a job indexes scratch allocated once per thread for the whole run
+size_t Batch_pool_worker(const Batch_pool* pool);
+// the header and the row in a single allocation, released with Circulant_destroy
+Circulant* Circulant_create(size_t length, const double row[static length]);
+// the derivative of periodic samples over 2 pi, created once per length and kept for
+// the first 16 lengths, the others are created every call
+Circulant* Circulant_differentiation(size_t length);
+void Circulant_destroy(Circulant* circulant);
+// releases the kept derivatives, part of Linear_clear
+void Circulant_clear();
+// every row of inputs is a vector of the length of the operator, the rows of results
+// receive the products, the vectors are split across the pool
+void Circulant_apply(
+  Batch_pool* pool,
+  const Circulant circulant[static 1],
+  Matrix inputs[static 1],
+  Matrix results[static 1]);
+Matrix4fBatch* Matrix4fBatch_create(size_t count);
+void Matrix4fBatch_destroy(Matrix4fBatch* batch);
+void Matrix4fBatch_set(Matrix4fBatch batch[static 1], size_t index, Matrix4f matrix);
+Matrix4f Matrix4fBatch_get(const Matrix4fBatch batch[static 1], size_t index);
+Vector3fBatch* Vector3fBatch_create(size_t count);
+void Vector3fBatch_destroy(Vector3fBatch* batch);
+// result[i] = a[i] b[i] into a batch distinct from the inputs
+void Matrix4f_multiplyBatch(
+  Batch_pool* pool,
+  const Matrix4fBatch a[static 1],
+  const Matrix4fBatch b[static 1],
+  Matrix4fBatch result[static 1]);
+// the points with a w of 1, the perspective division is left to the caller
+void Vector3f_transformBatch(
+  Batch_pool* pool,
+  Matrix4f matrix,
+  const Vector3fBatch points[static 1],
+  Vector3fBatch result[static 1]);
+// world[i] = world[parents[i]] local[i] with parents before their children and
+// BATCH_ROOT for the roots, a breadth first order makes every level one parallel batch
+#define BATCH_ROOT ((size_t)-1)
+void Matrix4f_composeBatch(
+  Batch_pool* pool,
+  const Matrix4fBatch local[static 1],
+  const size_t parents[],
+  Matrix4fBatch world[static 1]);
+
 #define Vector_scale(a, b)    \
   _Generic(                   \
     (b),                      \
@@ -184,6 +334,7 @@ Matrix4f Matrix4f_diagonal(float value);
 Matrix4f Matrix4f_transpose(Matrix4f matrix);
 Matrix4f Matrix4f_add(Matrix4f a, Matrix4f b);
 Matrix4f Matrix4f_multiply(Matrix4f a, Matrix4f b);
+Matrix4f Matrix4f_inverse(Matrix4f matrix);
 Matrix4f Matrix4f_orthographic(
   int left,
   int right,
@@ -194,6 +345,38 @@ Matrix4f Matrix4f_orthographic(
 Matrix4f Matrix4f_lookAt(Vector3f position, Vector3f target, Vector3f up);
 Matrix4f Matrix4f_perspective(float fov, float aspect, float near, float far);
 void Matrix4f_print(Matrix4f matrix);
+// the inverse transpose of the upper left 3x3 of model, for normals under non uniform
+// scale, in a 4x4 without translation
+Matrix4f Matrix4f_normal(Matrix4f model);
+// the scale of a mirroring matrix is negative along x
+Transformf Matrix4f_decompose(Matrix4f matrix);
+Matrix4f Transformf_compose(Transformf transform);
+
+Quaternionf Quaternionf_identity();
+// about a unit axis, counterclockwise looking down the axis
+Quaternionf Quaternionf_fromAxisAngle(Vector3f axis, float angle);
+// the rotation part of an orthonormal matrix
+Quaternionf Quaternionf_fromMatrix(Matrix4f matrix);
+// the rotation by b then by a
+Quaternionf Quaternionf_multiply(Quaternionf a, Quaternionf b);
+Quaternionf Quaternionf_conjugate(Quaternionf q);
+Quaternionf Quaternionf_normalize(Quaternionf q);
+float Quaternionf_inner(Quaternionf a, Quaternionf b);
+Vector3f Quaternionf_rotate(Quaternionf q, Vector3f v);
+// along the shorter arc, t from 0 at a to 1 at b
+Quaternionf Quaternionf_slerp(Quaternionf a, Quaternionf b, float t);
+Matrix4f Quaternionf_toMatrix(Quaternionf q);
+DualQuaternionf DualQuaternionf_make(Quaternionf rotation, Vector3f translation);
+// the transform by b then by a
+DualQuaternionf DualQuaternionf_multiply(DualQuaternionf a, DualQuaternionf b);
+Vector3f DualQuaternionf_transform(DualQuaternionf d, Vector3f point);
+// the normalized weighted sum of the skinning of a vertex by its bones, the rotations
+// are flipped to the hemisphere of the first one
+DualQuaternionf DualQuaternionf_blend(
+  size_t count,
+  const DualQuaternionf transforms[static count],
+  const float weights[static count]);
+Matrix4f DualQuaternionf_toMatrix(DualQuaternionf d);
 
 Vector4 Vector4_make(double x, double y, double z, double w);
 Vector4f Vector4f_make(float x, float y, float z, float w);
@@ -231,4 +414,82 @@ Vector3f Vector3f_cross(Vector3f v, Vector3f w);
 VectorN_declarations(2) VectorN_declarations(3) VectorN_declarations(4)
 #undef VectorN_declarations
 
+// the fixed size kernels are unrolled, a is n by m and b is m by p
+#define MatrixNxM_declarations(N, M, f)                                         \
+  Matrix##M##x##N##f Matrix##N##x##M##f##_transpose(Matrix##N##x##M##f matrix); \
+  Vector##N##f Matrix##N##x##M##f##_transform(                                  \
+    Matrix##N##x##M##f matrix, Vector##M##f v);                                 \
+  Matrix##N##x2##f Matrix##N##x##M##f##_multiply##M##x2(                        \
+    Matrix##N##x##M##f a, Matrix##M##x2##f b);                                  \
+  Matrix##N##x3##f Matrix##N##x##M##f##_multiply##M##x3(                        \
+    Matrix##N##x##M##f a, Matrix##M##x3##f b);                                  \
+  Matrix##N##x4##f Matrix##N##x##M##f##_multiply##M##x4(                        \
+    Matrix##N##x##M##f a, Matrix##M##x4##f b);
+#define MatrixNxM_shapes(f)                                             \
+  MatrixNxM_declarations(2, 2, f) MatrixNxM_declarations(2, 3, f)       \
+    MatrixNxM_declarations(2, 4, f) MatrixNxM_declarations(3, 2, f)     \
+      MatrixNxM_declarations(3, 3, f) MatrixNxM_declarations(3, 4, f)   \
+        MatrixNxM_declarations(4, 2, f) MatrixNxM_declarations(4, 3, f) \
+          MatrixNxM_declarations(4, 4, f)
+MatrixNxM_shapes() MatrixNxM_shapes(f)
+#undef MatrixNxM_shapes
+#undef MatrixNxM_declarations
+// the inverse of a singular matrix is not finite
+Matrix2x2 Matrix2x2_inverse(Matrix2x2 matrix);
+Matrix3x3 Matrix3x3_inverse(Matrix3x3 matrix);
+Matrix4x4 Matrix4x4_inverse(Matrix4x4 matrix);
+Matrix2x2f Matrix2x2f_inverse(Matrix2x2f matrix);
+Matrix3x3f Matrix3x3f_inverse(Matrix3x3f matrix);
+Matrix4x4f Matrix4x4f_inverse(Matrix4x4f matrix);
+
+// the kernel of the shapes of the operands, the inner selections of the other shapes
+// need a default, a mismatched b is then refused as an argument of the wrong type
+#define Matrix_products(b, N, M, f)                         \
+  Matrix##N##x##M##f: _Generic(                             \
+    (b),                                                    \
+    Matrix##M##x3##f: Matrix##N##x##M##f##_multiply##M##x3, \
+    Matrix##M##x4##f: Matrix##N##x##M##f##_multiply##M##x4, \
+    default: Matrix##N##x##M##f##_multiply##M##x2)
+#define Matrix_product(a, b)     \
+  _Generic(                      \
+    (a),                         \
+    Matrix_products(b, 2, 2, ),  \
+    Matrix_products(b, 2, 3, ),  \
+    Matrix_products(b, 2, 4, ),  \
+    Matrix_products(b, 3, 2, ),  \
+    Matrix_products(b, 3, 3, ),  \
+    Matrix_products(b, 3, 4, ),  \
+    Matrix_products(b, 4, 2, ),  \
+    Matrix_products(b, 4, 3, ),  \
+    Matrix_products(b, 4, 4, ),  \
+    Matrix_products(b, 2, 2, f), \
+    Matrix_products(b, 2, 3, f), \
+    Matrix_products(b, 2, 4, f), \
+    Matrix_products(b, 3, 2, f), \
+    Matrix_products(b, 3, 3, f), \
+    Matrix_products(b, 3, 4, f), \
+    Matrix_products(b, 4, 2, f), \
+    Matrix_products(b, 4, 3, f), \
+    Matrix_products(b, 4, 4, f))((a), (b))
+#define Matrix_shapes(name)                                                              \
+  Matrix2x2: Matrix2x2_##name, Matrix2x3: Matrix2x3_##name, Matrix2x4: Matrix2x4_##name, \
+  Matrix3x2: Matrix3x2_##name, Matrix3x3: Matrix3x3_##name, Matrix3x4: Matrix3x4_##name, \
+  Matrix4x2: Matrix4x2_##name, Matrix4x3: Matrix4x3_##name, Matrix4x4: Matrix4x4_##name, \
+  Matrix2x2f: Matrix2x2f_##name, Matrix2x3f: Matrix2x3f_##name,                          \
+  Matrix2x4f: Matrix2x4f_##name, Matrix3x2f: Matrix3x2f_##name,                          \
+  Matrix3x3f: Matrix3x3f_##name, Matrix3x4f: Matrix3x4f_##name,                          \
+  Matrix4x2f: Matrix4x2f_##name, Matrix4x3f: Matrix4x3f_##name,                          \
+  Matrix4x4f: Matrix4x4f_##name
+#define Matrix_transform(a, v) _Generic((a), Matrix_shapes(transform))((a), (v))
+#define Matrix_transpose(a)    _Generic((a), Matrix_shapes(transpose))(a)
+#define Matrix_inverse(a)           \
+  _Generic(                         \
+    (a),                            \
+    Matrix2x2: Matrix2x2_inverse,   \
+    Matrix3x3: Matrix3x3_inverse,   \
+    Matrix4x4: Matrix4x4_inverse,   \
+    Matrix2x2f: Matrix2x2f_inverse, \
+    Matrix3x3f: Matrix3x3f_inverse, \
+    Matrix4x4f: Matrix4x4f_inverse)(a)
+
 #endif // linear_algebra_H_
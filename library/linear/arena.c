@@ -0,0 +1,95 @@
+#include "algebra.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdatomic.h>
+
+// the blocks are chained, a rewind keeps them for the next allocations
+struct Arena_block {
+    Arena_block* next;
+    size_t capacity;
+    size_t used;
+};
+struct Arena {
+    Arena_block* first;
+    Arena_block* current;
+    size_t capacity;
+};
+#define ARENA_HEADER (LINEAR_ALIGN) // the data of a block follows its header
+
+static atomic_size_t allocations;
+
+static size_t align(size_t size) {
+  return (size + LINEAR_ALIGN - 1) / LINEAR_ALIGN * LINEAR_ALIGN;
+}
+void* Linear_allocate(size_t size) {
+  atomic_fetch_add_explicit(&allocations, 1, memory_order_relaxed);
+  return aligned_alloc(LINEAR_ALIGN, align(size ? size : 1));
+}
+size_t Linear_allocations() {
+  return atomic_load_explicit(&allocations, memory_order_relaxed);
+}
+static Arena_block* block_create(size_t capacity) {
+  Arena_block* result = Linear_allocate(ARENA_HEADER + capacity);
+  if (result) {
+    *result = (Arena_block){ .capacity = capacity };
+  }
+  return result;
+}
+Arena* Arena_create(size_t capacity) {
+  Arena* result = calloc(1, sizeof(*result));
+  if (result) {
+    result->capacity = align(capacity ? capacity : 1);
+    result->first = result->current = block_create(result->capacity);
+  }
+  if (!result || !result->first) {
+    perror("Arena allocation failed");
+    free(result);
+    result = 0;
+  }
+  return result;
+}
+void Arena_destroy(Arena* arena) {
+  if (arena) {
+    for (Arena_block* block = arena->first; block;) {
+      Arena_block* next = block->next;
+      free(block);
+      block = next;
+    }
+    free(arena);
+  }
+}
+void* Arena_allocate(Arena* arena, size_t size) {
+  size = align(size);
+  Arena_block* block = arena->current;
+  while (block->used + size > block->capacity) {
+    // the following blocks are free since the last rewind, a new one goes in front
+    if (block->next && block->next->capacity >= size) {
+      block = block->next;
+      block->used = 0;
+      continue;
+    }
+    Arena_block* created = block_create(size > arena->capacity ? size : arena->capacity);
+    if (!created) {
+      perror("Arena allocation failed");
+      return 0;
+    }
+    created->next = block->next;
+    block->next = created;
+    block = created;
+  }
+  arena->current = block;
+  unsigned char* result = (unsigned char*)block + ARENA_HEADER + block->used;
+  block->used += size;
+  return memset(result, 0, size);
+}
+Arena_Mark Arena_mark(const Arena* arena) {
+  return (Arena_Mark){ .block = arena->current, .used = arena->current->used };
+}
+void Arena_rewind(Arena* arena, Arena_Mark mark) {
+  arena->current = mark.block;
+  arena->current->used = mark.used;
+}
+void Arena_reset(Arena* arena) {
+  Arena_rewind(arena, (Arena_Mark){ .block = arena->first, .used = 0 });
+}
@@ -0,0 +1,339 @@
+#include "algebra.h"
+#include "simd.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdalign.h>
+#include <stdatomic.h>
+#include <threads.h>
+#ifdef __unix__
+  #include <unistd.h>
+#endif
+
+#define BATCH_THREADS (64)
+// matrices per task, a multiple of the floats in a cache line so that no two threads
+// write the same line
+#define BATCH_GRAIN   (1024)
+#define BATCH_PADDING (LINEAR_ALIGN / sizeof(float))
+
+struct Batch_pool {
+    size_t workers; // besides the calling thread
+    thrd_t threads[BATCH_THREADS];
+    mtx_t mutex;
+    cnd_t start;
+    cnd_t done;
+    size_t generation;
+    bool stop;
+    // the batch being run, the workers take grains until the end
+    Batch_job job;
+    void* context;
+    size_t end;
+    size_t grain;
+    atomic_size_t next;
+    size_t busy;
+    size_t joined; // the workers numbered so far
+};
+
+// the pool the thread works for and its number in it
+static thread_local const Batch_pool* localPool = 0;
+static thread_local size_t localWorker = 0;
+
+static size_t cores() {
+  long result = 1;
+#ifdef _SC_NPROCESSORS_ONLN
+  result = sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+  return result > 0 ? (size_t)result : 1;
+}
+static void work(Batch_pool pool[static 1]) {
+  for (size_t begin = atomic_fetch_add(&pool->next, pool->grain); pool->end > begin;
+       begin = atomic_fetch_add(&pool->next, pool->grain)) {
+    const size_t end = begin + pool->grain;
+    pool->job(pool->context, begin, end < pool->end ? end : pool->end);
+  }
+}
+// a worker joins every generation once, the caller waits for all of them to leave, the
+// workers start before the first generation even when they are scheduled after it
+static int worker(void* argument) {
+  Batch_pool* pool = argument;
+  size_t generation = 0;
+  mtx_lock(&pool->mutex);
+  localPool = pool;
+  localWorker = ++pool->joined;
+  while (true) {
+    while (!pool->stop && generation == pool->generation) {
+      cnd_wait(&pool->start, &pool->mutex);
+    }
+    if (pool->stop) {
+      break;
+    }
+    generation = pool->generation;
+    mtx_unlock(&pool->mutex);
+    work(pool);
+    mtx_lock(&pool->mutex);
+    if (!--pool->busy) {
+      cnd_signal(&pool->done);
+    }
+  }
+  mtx_unlock(&pool->mutex);
+  return 0;
+}
+Batch_pool* Batch_pool_create(size_t threads) {
+  Batch_pool* result = calloc(1, sizeof(*result));
+  if (!result) {
+    perror("Batch pool allocation failed");
+    return 0;
+  }
+  threads = threads ? threads : cores();
+  threads = threads > BATCH_THREADS ? BATCH_THREADS : threads;
+  mtx_init(&result->mutex, mtx_plain);
+  cnd_init(&result->start);
+  cnd_init(&result->done);
+  for (size_t i = 0; threads - 1 > i; i++) {
+    if (thrd_create(&result->threads[i], worker, result) != thrd_success) {
+      break;
+    }
+    result->workers++;
+  }
+  return result;
+}
+void Batch_pool_destroy(Batch_pool* pool) {
+  if (pool) {
+    mtx_lock(&pool->mutex);
+    pool->stop = true;
+    cnd_broadcast(&pool->start);
+    mtx_unlock(&pool->mutex);
+    for (size_t i = 0; pool->workers > i; i++) {
+      thrd_join(pool->threads[i], 0);
+    }
+    cnd_destroy(&pool->done);
+    cnd_destroy(&pool->start);
+    mtx_destroy(&pool->mutex);
+    free(pool);
+  }
+}
+void Batch_pool_run(
+  Batch_pool* pool,
+  Batch_job job,
+  void* context,
+  size_t begin,
+  size_t end,
+  size_t grain) {
+  if (!pool || !pool->workers || grain >= end - begin) {
+    job(context, begin, end);
+    return;
+  }
+  mtx_lock(&pool->mutex);
+  pool->job = job;
+  pool->context = context;
+  pool->end = end;
+  pool->grain = grain;
+  atomic_store(&pool->next, begin);
+  pool->busy = pool->workers;
+  pool->generation++;
+  cnd_broadcast(&pool->start);
+  mtx_unlock(&pool->mutex);
+  work(pool);
+  mtx_lock(&pool->mutex);
+  while (pool->busy) {
+    cnd_wait(&pool->done, &pool->mutex);
+  }
+  mtx_unlock(&pool->mutex);
+}
+size_t Batch_pool_threads(const Batch_pool* pool) {
+  return pool ? pool->workers + 1 : 1;
+}
+size_t Batch_pool_worker(const Batch_pool* pool) {
+  return pool && localPool == pool ? localWorker : 0;
+}
+
+// the arrays share one allocation
+static float* allocate(size_t count, size_t arrays, float* restrict pointers[]) {
+  const size_t stride = (count / BATCH_PADDING + 1) * BATCH_PADDING;
+  float* result = Linear_allocate(arrays * stride * sizeof(*result));
+  if (result) {
+    memset(result, 0, arrays * stride * sizeof(*result));
+    for (size_t n = 0; arrays > n; n++) {
+      pointers[n] = result + n * stride;
+    }
+  }
+  return result;
+}
+Matrix4fBatch* Matrix4fBatch_create(size_t count) {
+  Matrix4fBatch* result = calloc(1, sizeof(*result));
+  if (!result || !allocate(count, 16, result->elements)) {
+    perror("Batch allocation failed");
+    free(result);
+    return 0;
+  }
+  result->count = count;
+  return result;
+}
+void Matrix4fBatch_destroy(Matrix4fBatch* batch) {
+  if (batch) {
+    free(batch->elements[0]);
+    free(batch);
+  }
+}
+void Matrix4fBatch_set(Matrix4fBatch batch[static 1], size_t index, Matrix4f matrix) {
+  for (size_t n = 0; 16 > n; n++) {
+    batch->elements[n][index] = matrix.elements[n];
+  }
+}
+Matrix4f Matrix4fBatch_get(const Matrix4fBatch batch[static 1], size_t index) {
+  Matrix4f result = { 0 };
+  for (size_t n = 0; 16 > n; n++) {
+    result.elements[n] = batch->elements[n][index];
+  }
+  return result;
+}
+Vector3fBatch* Vector3fBatch_create(size_t count) {
+  Vector3fBatch* result = calloc(1, sizeof(*result));
+  if (!result || !allocate(count, 3, result->components)) {
+    perror("Batch allocation failed");
+    free(result);
+    return 0;
+  }
+  result->count = count;
+  return result;
+}
+void Vector3fBatch_destroy(Vector3fBatch* batch) {
+  if (batch) {
+    free(batch->components[0]);
+    free(batch);
+  }
+}
+
+// a product in every lane, the rows of a weight the rows of b, a row at a time so that
+// the operands stay in registers, the arrays are offset by their index
+static void multiply(
+  float* restrict const a[static 16],
+  size_t ia,
+  float* restrict const b[static 16],
+  size_t ib,
+  float* restrict const result[static 16],
+  size_t ir) {
+  for (size_t n = 0; 4 > n; n++) {
+    const linear_lanes row[4] = {
+      linear_load(&a[4 * n][ia]),
+      linear_load(&a[4 * n + 1][ia]),
+      linear_load(&a[4 * n + 2][ia]),
+      linear_load(&a[4 * n + 3][ia]),
+    };
+    for (size_t m = 0; 4 > m; m++) {
+      linear_lanes sum = linear_multiply(row[0], linear_load(&b[m][ib]));
+      sum = linear_maddLanes(row[1], linear_load(&b[4 + m][ib]), sum);
+      sum = linear_maddLanes(row[2], linear_load(&b[8 + m][ib]), sum);
+      sum = linear_maddLanes(row[3], linear_load(&b[12 + m][ib]), sum);
+      linear_store(&result[4 * n + m][ir], sum);
+    }
+  }
+}
+// the loops run over whole lanes, the arrays are padded past the count
+typedef struct {
+    const Matrix4fBatch* a;
+    const Matrix4fBatch* b;
+    Matrix4fBatch* result;
+} Multiply;
+static void multiply_run(void* argument, size_t begin, size_t end) {
+  const Multiply* context = argument;
+  for (size_t i = begin; end > i; i += LINEAR_LANES) {
+    float* restrict const* result = context->result->elements;
+    multiply(context->a->elements, i, context->b->elements, i, result, i);
+  }
+}
+void Matrix4f_multiplyBatch(
+  Batch_pool* pool,
+  const Matrix4fBatch a[static 1],
+  const Matrix4fBatch b[static 1],
+  Matrix4fBatch result[static 1]) {
+  Multiply context = { .a = a, .b = b, .result = result };
+  Batch_pool_run(pool, multiply_run, &context, 0, result->count, BATCH_GRAIN);
+}
+typedef struct {
+    Matrix4f matrix;
+    const Vector3fBatch* points;
+    Vector3fBatch* result;
+} Transform;
+static void transform_run(void* argument, size_t begin, size_t end) {
+  const Transform* context = argument;
+  linear_lanes matrix[12];
+  for (size_t n = 0; 12 > n; n++) {
+    matrix[n] = linear_fill(context->matrix.elements[n]);
+  }
+  for (size_t i = begin; end > i; i += LINEAR_LANES) {
+    const linear_lanes x = linear_load(&context->points->components[0][i]);
+    const linear_lanes y = linear_load(&context->points->components[1][i]);
+    const linear_lanes z = linear_load(&context->points->components[2][i]);
+    for (size_t n = 0; 3 > n; n++) {
+      linear_lanes sum = linear_maddLanes(matrix[4 * n], x, matrix[4 * n + 3]);
+      sum = linear_maddLanes(matrix[4 * n + 1], y, sum);
+      sum = linear_maddLanes(matrix[4 * n + 2], z, sum);
+      linear_store(&context->result->components[n][i], sum);
+    }
+  }
+}
+void Vector3f_transformBatch(
+  Batch_pool* pool,
+  Matrix4f matrix,
+  const Vector3fBatch points[static 1],
+  Vector3fBatch result[static 1]) {
+  Transform context = { .matrix = matrix, .points = points, .result = result };
+  Batch_pool_run(pool, transform_run, &context, 0, result->count, BATCH_GRAIN);
+}
+typedef struct {
+    const Matrix4fBatch* local;
+    const size_t* parents;
+    Matrix4fBatch* world;
+} Compose;
+// the parents are gathered lane by lane, the roots and the lanes past the end of the
+// grain take the identity, the parents of those lanes may be written by another worker
+static void compose_run(void* argument, size_t begin, size_t end) {
+  const Compose* context = argument;
+  alignas(sizeof(linear_lanes)) float parent[16][LINEAR_LANES];
+  float* restrict rows[16];
+  for (size_t n = 0; 16 > n; n++) {
+    rows[n] = parent[n];
+  }
+  for (size_t i = begin; end > i; i += LINEAR_LANES) {
+    for (size_t lane = 0; LINEAR_LANES > lane; lane++) {
+      const size_t index = i + lane;
+      const size_t p = end > index ? context->parents[index] : BATCH_ROOT;
+      for (size_t n = 0; 16 > n; n++) {
+        parent[n][lane] =
+          p == BATCH_ROOT ? (n % 5 ? 0.0f : 1.0f) : context->world->elements[n][p];
+      }
+    }
+    multiply(rows, 0, context->local->elements, i, context->world->elements, i);
+  }
+}
+void Matrix4f_composeBatch(
+  Batch_pool* pool,
+  const Matrix4fBatch local[static 1],
+  const size_t parents[],
+  Matrix4fBatch world[static 1]) {
+  Compose context = { .local = local, .parents = parents, .world = world };
+  // runs of nodes whose parents all come before the run, the lanes past the end of a
+  // run are written again by the next one
+  for (size_t begin = 0; world->count > begin;) {
+    size_t end = begin + 1;
+    while (world->count > end && (parents[end] == BATCH_ROOT || begin > parents[end])) {
+      end++;
+    }
+    // the first lanes of an unaligned run one by one
+    const size_t aligned = (begin + LINEAR_LANES - 1) / LINEAR_LANES * LINEAR_LANES;
+    for (; end > begin && aligned > begin; begin++) {
+      const Matrix4f matrix = Matrix4fBatch_get(local, begin);
+      Matrix4fBatch_set(
+        world,
+        begin,
+        parents[begin] == BATCH_ROOT
+          ? matrix
+          : Matrix4f_multiply(Matrix4fBatch_get(world, parents[begin]), matrix));
+    }
+    if (end > begin) {
+      Batch_pool_run(pool, compose_run, &context, begin, end, BATCH_GRAIN);
+    }
+    begin = end;
+  }
+}
@@ -0,0 +1,660 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#ifdef __linux__
+  #include <unistd.h>
+  #include <sys/syscall.h>
+  #include <linux/perf_event.h>
+#endif
+#include "algebra.h"
+#include "simd.h"
+
+#define ITERATIONS  (1 << 22)
+#define RING        (256)
+#define RESULTS     (64)
+#define RESULT_NAME (32)
+#ifdef __FMA__
+  #define FMA " fma"
+#else
+  #define FMA ""
+#endif
+#if LINEAR_SSE && defined(__AVX__)
+  #define KERNELS "avx" FMA
+#elif LINEAR_SSE
+  #define KERNELS "sse" FMA
+#elif LINEAR_NEON
+  #define KERNELS "neon"
+#else
+  #define KERNELS "scalar"
+#endif
+#ifndef LINEAR_FLAGS
+  #define LINEAR_FLAGS ""
+#endif
+#ifdef __VERSION__
+  #define COMPILER __VERSION__
+#else
+  #define COMPILER "unknown"
+#endif
+
+typedef struct {
+    char name[RESULT_NAME];
+    double nanoseconds; // per operation
+    double cycles; // per operation on the calling thread, negative without a counter
+} Result;
+typedef struct {
+    double nanoseconds;
+    double cycles;
+} Clock;
+
+static Result results[RESULTS];
+static size_t recorded;
+static int counter = -1; // the cycles of the calling thread in user space
+
+static double now() {
+  struct timespec time = { 0 };
+  clock_gettime(CLOCK_MONOTONIC, &time);
+  return (double)time.tv_sec * 1e9 + (double)time.tv_nsec;
+}
+// the counter stays closed where perf_event_open is missing or not permitted
+static void counter_open() {
+#ifdef __linux__
+  struct perf_event_attr attributes = {
+    .type = PERF_TYPE_HARDWARE,
+    .size = sizeof(attributes),
+    .config = PERF_COUNT_HW_CPU_CYCLES,
+    .exclude_kernel = 1,
+    .exclude_hv = 1,
+  };
+  counter = (int)syscall(SYS_perf_event_open, &attributes, 0, -1, -1, 0);
+#endif
+}
+static double cycles() {
+  long long result = 0;
+#ifdef __linux__
+  if (0 <= counter && read(counter, &result, sizeof(result)) != sizeof(result)) {
+    result = 0;
+  }
+#endif
+  return (double)result;
+}
+static Clock start() {
+  return (Clock){ .cycles = cycles(), .nanoseconds = now() };
+}
+// prints and keeps the rates of the operations since the clock started, the sum of the
+// results is printed so that the loops are not optimized away
+static void record(const char* name, Clock clock, double operations, float sink) {
+  Result result = {
+    .nanoseconds = (now() - clock.nanoseconds) / operations,
+    .cycles = 0 <= counter ? (cycles() - clock.cycles) / operations : -1,
+  };
+  snprintf(result.name, sizeof(result.name), "%s", name);
+  printf("%-26s %10.2f ns/op %12.4g ops/s", name, result.nanoseconds,
+         1e9 / result.nanoseconds);
+  if (0 <= result.cycles) {
+    printf(" %8.2f cycles/op", result.cycles);
+  }
+  printf(" (%g)\n", sink);
+  if (RESULTS > recorded) {
+    results[recorded++] = result;
+  }
+}
+// quoted with the characters JSON does not allow in strings escaped
+static void write_string(FILE* file, const char* string) {
+  fputc('"', file);
+  for (const unsigned char* c = (const unsigned char*)string; *c; c++) {
+    if ('"' == *c || '\\' == *c) {
+      fprintf(file, "\\%c", *c);
+    }
+    else if (0x20 > *c) {
+      fprintf(file, "\\u%04x", *c);
+    }
+    else {
+      fputc(*c, file);
+    }
+  }
+  fputc('"', file);
+}
+// the cycles only count the calling thread, a run on a pool has most of them elsewhere
+static bool write_json(const char* path) {
+  FILE* file = fopen(path, "w");
+  if (!file) {
+    perror(path);
+    return false;
+  }
+  fprintf(file, "{\n  \"kernels\": ");
+  write_string(file, KERNELS);
+  fprintf(file, ",\n  \"compiler\": ");
+  write_string(file, COMPILER);
+  fprintf(file, ",\n  \"flags\": ");
+  write_string(file, LINEAR_FLAGS);
+  fprintf(file, ",\n  \"cycles\": \"calling thread, user space\",\n  \"results\": [");
+  for (size_t i = 0; recorded > i; i++) {
+    const Result* result = &results[i];
+    fprintf(file, "%s\n    { \"name\": ", i ? "," : "");
+    write_string(file, result->name);
+    fprintf(file, ", \"ns_per_op\": %.4f, \"ops_per_s\": %.6g",
+            result->nanoseconds, 1e9 / result->nanoseconds);
+    if (0 <= result->cycles) {
+      fprintf(file, ", \"cycles_per_op\": %.4f }", result->cycles);
+    }
+    else {
+      fprintf(file, ", \"cycles_per_op\": null }");
+    }
+  }
+  fprintf(file, "\n  ]\n}\n");
+  return !fclose(file);
+}
+// a balanced tree with 8 children per node, in breadth first order
+static size_t parent(size_t index) {
+  return index ? (index - 1) / 8 : BATCH_ROOT;
+}
+// the batches at growing counts, the one at a time functions over an array of
+// structures for comparison, with and without a pool of every core
+static void batches(Batch_pool* pool, float sink[static 1]) {
+  const size_t counts[] = { 1000, 100000, 1000000 };
+  for (size_t c = 0; sizeof(counts) / sizeof(*counts) > c; c++) {
+    const size_t count = counts[c];
+    const size_t repeats = 100000000 / count / 16 + 1;
+    Matrix4fBatch* a = Matrix4fBatch_create(count);
+    Matrix4fBatch* b = Matrix4fBatch_create(count);
+    Matrix4fBatch* result = Matrix4fBatch_create(count);
+    Vector3fBatch* points = Vector3fBatch_create(count);
+    Vector3fBatch* transformed = Vector3fBatch_create(count);
+    Matrix4f* single = malloc(count * sizeof(*single));
+    Matrix4f* products = malloc(count * sizeof(*products));
+    size_t* parents = malloc(count * sizeof(*parents));
+    for (size_t i = 0; count > i; i++) {
+      const float angle = (float)i * 1e-3f;
+      Matrix4f matrix = Matrix4f_diagonal(1.0f);
+      matrix.elements[0] = matrix.elements[10] = cosf(angle);
+      matrix.elements[2] = sinf(angle);
+      matrix.elements[8] = -sinf(angle);
+      matrix.elements[3] = angle;
+      Matrix4fBatch_set(a, i, matrix);
+      Matrix4fBatch_set(b, i, matrix);
+      single[i] = matrix;
+      for (size_t n = 0; 3 > n; n++) {
+        points->components[n][i] = matrix.elements[n];
+      }
+      parents[i] = parent(i);
+    }
+    double begin = now();
+    for (size_t r = 0; repeats > r; r++) {
+      for (size_t i = 0; count > i; i++) {
+        products[i] = Matrix4f_multiply(single[i], single[(i + 1) % count]);
+      }
+    }
+    double seconds = (now() - begin) / 1e9;
+    *sink += products[count / 2].elements[0];
+    printf("%8zu Matrix4f_multiply       %10.3g matrices/s\n",
+           count, (double)(count * repeats) / seconds);
+    begin = now();
+    for (size_t r = 0; repeats > r; r++) {
+      Matrix4f_multiplyBatch(pool, a, b, result);
+    }
+    seconds = (now() - begin) / 1e9;
+    *sink += result->elements[0][count / 2];
+    printf("%8zu Matrix4f_multiplyBatch  %10.3g matrices/s\n",
+           count, (double)(count * repeats) / seconds);
+    begin = now();
+    for (size_t r = 0; repeats > r; r++) {
+      Vector3f_transformBatch(pool, single[0], points, transformed);
+    }
+    seconds = (now() - begin) / 1e9;
+    *sink += transformed->components[0][count / 2];
+    printf("%8zu Vector3f_transformBatch %10.3g points/s\n",
+           count, (double)(count * repeats) / seconds);
+    begin = now();
+    for (size_t r = 0; repeats > r; r++) {
+      Matrix4f_composeBatch(pool, a, parents, result);
+    }
+    seconds = (now() - begin) / 1e9;
+    *sink += result->elements[0][count / 2];
+    printf("%8zu Matrix4f_composeBatch   %10.3g matrices/s\n",
+           count, (double)(count * repeats) / seconds);
+    free(parents);
+    free(products);
+    free(single);
+    Vector3fBatch_destroy(transformed);
+    Vector3fBatch_destroy(points);
+    Matrix4fBatch_destroy(result);
+    Matrix4fBatch_destroy(b);
+    Matrix4fBatch_destroy(a);
+  }
+}
+// square products until a second or so of work each
+static void products(Batch_pool* pool, float sink[static 1]) {
+  for (size_t size = 64; 4096 >= size; size *= 2) {
+    Matrix* a = Matrix_create(size, size);
+    Matrix* b = Matrix_create(size, size);
+    Matrix* result = Matrix_create(size, size);
+    for (size_t n = 0; size * size > n; n++) {
+      a->elements[n] = (double)(n % 17) / 17.0;
+      b->elements[n] = (double)(n % 13) / 13.0;
+    }
+    const double operations = 2.0 * (double)size * (double)size * (double)size;
+    const size_t repeats = (size_t)(4e9 / operations) + 1;
+    const double begin = now();
+    for (size_t r = 0; repeats > r; r++) {
+      Matrix_multiplyParallel(pool, a, b, result);
+    }
+    const double seconds = (now() - begin) / 1e9;
+    *sink += (float)result->elements[size + 1];
+    const double gigaflops = operations * (double)repeats / seconds / 1e9;
+    printf("%8zu Matrix_multiply %8.2f GFLOP/s\n", size, gigaflops);
+    Matrix_destroy(result);
+    Matrix_destroy(b);
+    Matrix_destroy(a);
+  }
+}
+// the derivative of a sampled periodic function with its temporaries on the heap and in
+// an arena rewound every step
+static void differentiation(float sink[static 1]) {
+  const size_t length = 64;
+  const size_t steps = 2000;
+  Arena* arena = Arena_create(64 * 1024);
+  for (size_t scratch = 0; 2 > scratch; scratch++) {
+    const size_t before = Linear_allocations();
+    const double begin = now();
+    for (size_t step = 0; steps > step; step++) {
+      const Arena_Mark mark = Arena_mark(arena);
+      Vector* u = scratch ? Vector_createIn(arena, length) : Vector_create(length);
+      Vector* derivative =
+        scratch ? Vector_createIn(arena, length) : Vector_create(length);
+      Matrix* matrix =
+        scratch ? Matrix_createIn(arena, length, length) : Matrix_create(length, length);
+      for (size_t n = 0; length > n; n++) {
+        u->components[n] = sin(2 * M_PI * (double)(n + step) / (double)length);
+      }
+      Matrix_differentiate(matrix);
+      (Vector_transform)(matrix, u, derivative);
+      *sink += (float)derivative->components[step % length];
+      if (scratch) {
+        Arena_rewind(arena, mark);
+      }
+      else {
+        Matrix_destroy(matrix);
+        Vector_destroy(derivative);
+        Vector_destroy(u);
+      }
+    }
+    printf("%zu samples differentiated %-5s %6.2f allocations/step %8.2f us/step\n",
+           length,
+           scratch ? "arena" : "heap",
+           (double)(Linear_allocations() - before) / steps,
+           (now() - begin) / 1e3 / steps);
+  }
+  Arena_destroy(arena);
+}
+// the spectral derivative from 16 to 1M samples, the dense operator built and applied
+// as before for the smaller lengths
+static void derivatives(float sink[static 1]) {
+  for (size_t length = 16; (1 << 20) >= length; length *= 4) {
+    Vector* u = Vector_create(length);
+    Vector* derivative = Vector_create(length);
+    for (size_t n = 0; length > n; n++) {
+      u->components[n] = sin(2 * M_PI * (double)n / (double)length);
+    }
+    const size_t repeats = (1 << 24) / length + 1;
+    double begin = now();
+    for (size_t r = 0; repeats > r; r++) {
+      Vector_differentiate(u, derivative);
+    }
+    double nanoseconds = (now() - begin) / repeats;
+    *sink += (float)derivative->components[length / 2];
+    printf("%8zu Vector_differentiate %12.0f ns %8.2f ns/sample\n",
+           length, nanoseconds, nanoseconds / length);
+    if (1024 >= length) {
+      Matrix* operator = Matrix_create(length, length);
+      const size_t dense = (1 << 16) / length + 1;
+      begin = now();
+      for (size_t r = 0; dense > r; r++) {
+        Matrix_differentiate(operator);
+        (Vector_transform)(operator, u, derivative);
+      }
+      nanoseconds = (now() - begin) / dense;
+      *sink += (float)derivative->components[length / 2];
+      printf("%8zu dense operator       %12.0f ns %8.2f ns/sample\n",
+             length, nanoseconds, nanoseconds / length);
+      Matrix_destroy(operator);
+    }
+    Vector_destroy(derivative);
+    Vector_destroy(u);
+  }
+}
+// the circulant operator on many vectors at once, its rate counts the multiply adds of
+// the dense product, against the transforms one vector at a time
+static void circulants(Batch_pool* pool, float sink[static 1]) {
+  const size_t count = 10000;
+  for (size_t length = 256; 4096 >= length; length *= 2) {
+    Matrix* inputs = Matrix_create(count, length);
+    Matrix* results = Matrix_create(count, length);
+    for (size_t i = 0; count * length > i; i++) {
+      inputs->elements[i] = sin((double)i * 1e-3);
+    }
+    Circulant* operator = Circulant_differentiation(length);
+    double begin = now();
+    Circulant_apply(pool, operator, inputs, results);
+    double seconds = (now() - begin) * 1e-9;
+    *sink += (float)results->elements[length / 2];
+    printf("%8zu Circulant_apply      %10.0f vectors/s %6.2f GFLOP/s\n",
+           length, count / seconds, 2e-9 * count * length * length / seconds);
+    begin = now();
+    for (size_t v = 0; count > v; v++) {
+      Vector input = { .components = &inputs->elements[v * length], .length = length };
+      Vector result = { .components = &results->elements[v * length], .length = length };
+      Vector_differentiate(&input, &result);
+    }
+    seconds = (now() - begin) * 1e-9;
+    *sink += (float)results->elements[length / 2];
+    printf("%8zu Vector_differentiate %10.0f vectors/s\n", length, count / seconds);
+    Circulant_destroy(operator);
+    Matrix_destroy(results);
+    Matrix_destroy(inputs);
+  }
+}
+// the unrolled fixed size products against the dynamic Matrix of the same size, over a
+// ring of inputs
+#define FIXED_SIZE(N)                                                                   \
+  do {                                                                                  \
+    Matrix##N##x##N fixed[RING] = { 0 };                                                \
+    Matrix* dynamic[RING + 1] = { 0 };                                                  \
+    for (size_t i = 0; RING >= i; i++) {                                                \
+      dynamic[i] = Matrix_create(N, N);                                                 \
+      for (size_t n = 0; N * N > n; n++) {                                              \
+        const double value = (double)((i * 7 + n * 3) % 19) / 19.0 - 0.5;               \
+        dynamic[i]->elements[n] = value;                                                \
+        fixed[i % RING].elements[n] = value;                                            \
+      }                                                                                 \
+    }                                                                                   \
+    Clock clock = start();                                                              \
+    for (size_t i = 0; ITERATIONS > i; i++) {                                           \
+      const Matrix##N##x##N m = Matrix_product(fixed[i % RING], fixed[(i + 1) % RING]); \
+      *sink += (float)m.elements[i % (N * N)];                                          \
+    }                                                                                   \
+    record("Matrix" #N "x" #N "_multiply" #N "x" #N, clock, ITERATIONS, *sink);         \
+    clock = start();                                                                    \
+    for (size_t i = 0; ITERATIONS / 16 > i; i++) {                                      \
+      Matrix_multiply(dynamic[i % RING], dynamic[(i + 1) % RING], dynamic[RING]);       \
+      *sink += (float)dynamic[RING]->elements[i % (N * N)];                             \
+    }                                                                                   \
+    record("Matrix_multiply/" #N, clock, ITERATIONS / 16, *sink);                       \
+    for (size_t i = 0; RING >= i; i++) {                                                \
+      Matrix_destroy(dynamic[i]);                                                       \
+    }                                                                                   \
+  } while (false)
+static void fixedSizes(float sink[static 1]) {
+  FIXED_SIZE(2);
+  FIXED_SIZE(3);
+  FIXED_SIZE(4);
+  // a transform of a shape that has no dynamic counterpart
+  Matrix3x4 affine = { .elements = { 1, 0, 0, 1, 0, 1, 0, 2, 0, 0, 1, 3 } };
+  Vector4 points[RING] = { 0 };
+  for (size_t i = 0; RING > i; i++) {
+    points[i] = Vector4_make((double)i, 1.0, -(double)i, 1.0);
+  }
+  const Clock clock = start();
+  for (size_t i = 0; ITERATIONS > i; i++) {
+    *sink += (float)Matrix_transform(affine, points[i % RING]).components[i % 3];
+    affine.elements[3] = (double)(i % 7);
+  }
+  record("Matrix3x4_transform", clock, ITERATIONS, *sink);
+}
+// the per object updates and the skinning against the 4x4 products they replace
+static void transforms(float sink[static 1]) {
+  Transformf objects[RING] = { 0 };
+  DualQuaternionf bones[RING] = { 0 };
+  Vector3f points[RING] = { 0 };
+  for (size_t i = 0; RING > i; i++) {
+    const float angle = (float)i * 0.1f;
+    const Vector3f axis = Vector3f_normalize(Vector3f_make(1.0f, (float)i, 2.0f));
+    objects[i] = (Transformf){
+      .translation = Vector3f_make((float)i, 1.0f, -(float)i),
+      .rotation = Quaternionf_fromAxisAngle(axis, angle),
+      .scale = Vector3f_make(1.0f, 2.0f, 0.5f + angle),
+    };
+    bones[i] = DualQuaternionf_make(objects[i].rotation, objects[i].translation);
+    points[i] = Vector3f_make(angle, 1.0f - angle, 2.0f);
+  }
+  Clock clock = start();
+  for (size_t i = 0; ITERATIONS > i; i++) {
+    const Quaternionf q =
+      Quaternionf_multiply(objects[i % RING].rotation, objects[(i + 1) % RING].rotation);
+    *sink += q.components[i % 4];
+  }
+  record("Quaternionf_multiply", clock, ITERATIONS, *sink);
+  clock = start();
+  for (size_t i = 0; ITERATIONS > i; i++) {
+    const Vector3f v =
+      Quaternionf_rotate(objects[i % RING].rotation, points[(i + 1) % RING]);
+    *sink += v.components[i % 3];
+  }
+  record("Quaternionf_rotate", clock, ITERATIONS, *sink);
+  clock = start();
+  for (size_t i = 0; ITERATIONS > i; i++) {
+    const Quaternionf q = Quaternionf_slerp(
+      objects[i % RING].rotation, objects[(i + 1) % RING].rotation, 0.25f);
+    *sink += q.components[i % 4];
+  }
+  record("Quaternionf_slerp", clock, ITERATIONS, *sink);
+  clock = start();
+  for (size_t i = 0; ITERATIONS > i; i++) {
+    *sink += Transformf_compose(objects[i % RING]).elements[i % 16];
+  }
+  record("Transformf_compose", clock, ITERATIONS, *sink);
+  Matrix4f models[RING] = { 0 };
+  for (size_t i = 0; RING > i; i++) {
+    models[i] = Transformf_compose(objects[i]);
+  }
+  clock = start();
+  for (size_t i = 0; ITERATIONS > i; i++) {
+    *sink += Matrix4f_decompose(models[i % RING]).scale.components[i % 3];
+  }
+  record("Matrix4f_decompose", clock, ITERATIONS, *sink);
+  clock = start();
+  for (size_t i = 0; ITERATIONS > i; i++) {
+    *sink += Matrix4f_normal(models[i % RING]).elements[i % 16];
+  }
+  record("Matrix4f_normal", clock, ITERATIONS, *sink);
+  clock = start();
+  for (size_t i = 0; ITERATIONS > i; i++) {
+    *sink += Matrix4f_transpose(Matrix4f_inverse(models[i % RING])).elements[i % 16];
+  }
+  record("Matrix4f_inverse+transpose", clock, ITERATIONS, *sink);
+  clock = start();
+  for (size_t i = 0; ITERATIONS > i; i++) {
+    const DualQuaternionf d =
+      DualQuaternionf_multiply(bones[i % RING], bones[(i + 1) % RING]);
+    *sink += d.dual.components[i % 4];
+  }
+  record("DualQuaternionf_multiply", clock, ITERATIONS, *sink);
+  clock = start();
+  for (size_t i = 0; ITERATIONS > i; i++) {
+    const Vector3f v = DualQuaternionf_transform(bones[i % RING], points[(i + 1) % RING]);
+    *sink += v.components[i % 3];
+  }
+  record("DualQuaternionf_transform", clock, ITERATIONS, *sink);
+  // four bones a vertex
+  const float weights[4] = { 0.4f, 0.3f, 0.2f, 0.1f };
+  clock = start();
+  for (size_t i = 0; ITERATIONS > i; i++) {
+    const DualQuaternionf d = DualQuaternionf_blend(4, &bones[i % (RING - 3)], weights);
+    *sink += d.real.components[i % 4];
+  }
+  record("DualQuaternionf_blend/4", clock, ITERATIONS, *sink);
+}
+// the suite, small kernels over the ring and the dynamic types at a few sizes
+static void suite(float sink[static 1]) {
+  // a ring of inputs that stays in the first level cache, the results are summed
+  Matrix4f inputs[RING] = { 0 };
+  Vector4f vectors[RING] = { 0 };
+  unsigned seed = 1;
+  for (size_t i = 0; RING > i; i++) {
+    for (size_t n = 0; 16 > n; n++) {
+      seed = seed * 1103515245u + 12345u;
+      inputs[i].elements[n] = (float)((seed >> 8) % 2001) / 1000.0f - 1.0f;
+    }
+    for (size_t n = 0; 4 > n; n++) {
+      inputs[i].elements[5 * n] += 4.0f;
+      vectors[i].components[n] = inputs[i].elements[n];
+    }
+  }
+  const Vector3f up = { .components = { 0.0f, 1.0f, 0.0f } };
+  Clock clock = start();
+  for (size_t i = 0; ITERATIONS > i; i++) {
+    const Matrix4f m = Matrix4f_multiply(inputs[i % RING], inputs[(i + 1) % RING]);
+    *sink += m.elements[i % 16];
+  }
+  record("Matrix4f_multiply", clock, ITERATIONS, *sink);
+  clock = start();
+  for (size_t i = 0; ITERATIONS > i; i++) {
+    *sink += Matrix4f_transpose(inputs[i % RING]).elements[i % 16];
+  }
+  record("Matrix4f_transpose", clock, ITERATIONS, *sink);
+  clock = start();
+  for (size_t i = 0; ITERATIONS > i; i++) {
+    *sink += Matrix4f_inverse(inputs[i % RING]).elements[i % 16];
+  }
+  record("Matrix4f_inverse", clock, ITERATIONS, *sink);
+  clock = start();
+  for (size_t i = 0; ITERATIONS > i; i++) {
+    const Vector4f v = Vector4f_transform(inputs[i % RING], vectors[(i + 1) % RING]);
+    *sink += v.components[i % 4];
+  }
+  record("Vector4f_transform", clock, ITERATIONS, *sink);
+  clock = start();
+  for (size_t i = 0; ITERATIONS > i; i++) {
+    const Vector3f position = { .components = {
+                                  vectors[i % RING].components[0],
+                                  vectors[i % RING].components[1],
+                                  vectors[i % RING].components[2] + 5.0f,
+                                } };
+    *sink += Matrix4f_lookAt(position, (Vector3f){ 0 }, up).elements[i % 16];
+  }
+  record("Matrix4f_lookAt", clock, ITERATIONS, *sink);
+  clock = start();
+  for (size_t i = 0; ITERATIONS > i; i++) {
+    const float fov = 1.0f + vectors[i % RING].components[0] * 0.1f;
+    *sink += Matrix4f_perspective(fov, 16.0f / 9.0f, 0.1f, 100.0f).elements[i % 16];
+  }
+  record("Matrix4f_perspective", clock, ITERATIONS, *sink);
+  clock = start();
+  for (size_t i = 0; ITERATIONS > i; i++) {
+    const Vector3f v = { .components = {
+                           vectors[i % RING].components[0],
+                           vectors[i % RING].components[1],
+                           vectors[i % RING].components[2],
+                         } };
+    *sink += Vector3f_normalize(v).components[i % 3];
+  }
+  record("Vector3f_normalize", clock, ITERATIONS, *sink);
+  clock = start();
+  for (size_t i = 0; ITERATIONS > i; i++) {
+    *sink += Vector4f_normalize(vectors[i % RING]).components[i % 4];
+  }
+  record("Vector4f_normalize", clock, ITERATIONS, *sink);
+  clock = start();
+  for (size_t i = 0; ITERATIONS > i; i++) {
+    const Vector3 v = Vector3_make(
+      vectors[i % RING].components[0],
+      vectors[i % RING].components[1],
+      vectors[i % RING].components[2]);
+    *sink += (float)Vector3_normalize(v).components[i % 3];
+  }
+  record("Vector3_normalize", clock, ITERATIONS, *sink);
+  char name[RESULT_NAME];
+  const size_t sizes[] = { 64, 256 };
+  for (size_t s = 0; sizeof(sizes) / sizeof(*sizes) > s; s++) {
+    const size_t size = sizes[s];
+    Matrix* a = Matrix_create(size, size);
+    Matrix* b = Matrix_create(size, size);
+    Matrix* result = Matrix_create(size, size);
+    for (size_t n = 0; size * size > n; n++) {
+      a->elements[n] = (double)(n % 17) / 17.0;
+      b->elements[n] = (double)(n % 13) / 13.0;
+    }
+    const size_t repeats = (1 << 28) / (size * size * size) + 1;
+    clock = start();
+    for (size_t r = 0; repeats > r; r++) {
+      Matrix_multiply(a, b, result);
+    }
+    *sink += (float)result->elements[size + 1];
+    snprintf(name, sizeof(name), "Matrix_multiply/%zu", size);
+    record(name, clock, (double)repeats, *sink);
+    Matrix_destroy(result);
+    Matrix_destroy(b);
+    Matrix_destroy(a);
+  }
+  const size_t lengths[] = { 256, 4096 };
+  for (size_t l = 0; sizeof(lengths) / sizeof(*lengths) > l; l++) {
+    const size_t length = lengths[l];
+    Vector* u = Vector_create(length);
+    Vector* derivative = Vector_create(length);
+    for (size_t n = 0; length > n; n++) {
+      u->components[n] = sin(2 * M_PI * (double)n / (double)length);
+    }
+    const size_t repeats = (1 << 24) / length + 1;
+    clock = start();
+    for (size_t r = 0; repeats > r; r++) {
+      Vector_differentiate(u, derivative);
+    }
+    *sink += (float)derivative->components[length / 2];
+    snprintf(name, sizeof(name), "Vector_differentiate/%zu", length);
+    record(name, clock, (double)repeats, *sink);
+    Vector_destroy(derivative);
+    Vector_destroy(u);
+  }
+  fixedSizes(sink);
+  transforms(sink);
+}
+
+// --suite skips the tables of throughputs, --json path writes the suite there
+int main(int argc, char* argv[]) {
+  bool tables = true;
+  const char* json = 0;
+  for (int i = 1; argc > i; i++) {
+    if (!strcmp(argv[i], "--suite")) {
+      tables = false;
+    }
+    else if (!strcmp(argv[i], "--json") && argc > i + 1) {
+      json = argv[++i];
+    }
+    else {
+      fprintf(stderr, "usage: %s [--suite] [--json path]\n", argv[0]);
+      return EXIT_FAILURE;
+    }
+  }
+  printf("kernels: %s\n", KERNELS);
+  counter_open();
+  float sink = 0;
+  suite(&sink);
+  if (json && !write_json(json)) {
+    return EXIT_FAILURE;
+  }
+  if (!tables) {
+    printf("(%g)\n", sink);
+    return EXIT_SUCCESS;
+  }
+  printf("batches on the calling thread\n");
+  batches(0, &sink);
+  Batch_pool* pool = Batch_pool_create(0);
+  printf("batches on every core\n");
+  batches(pool, &sink);
+  printf("products on the calling thread\n");
+  products(0, &sink);
+  printf("products on every core\n");
+  products(pool, &sink);
+  differentiation(&sink);
+  derivatives(&sink);
+  printf("circulants on every core\n");
+  circulants(pool, &sink);
+  Batch_pool_destroy(pool);
+  printf("(%g)\n", sink);
+  return EXIT_SUCCESS;
+}
+// cmake -S . -B build -DCMAKE_BUILD_TYPE=Release && cmake --build build
+// build/linear_benchmarks --suite --json results.json
+// with -DLINEAR_SCALAR=ON for the plain loops or -DLINEAR_NATIVE=ON for the instructions
+// of the machine, such as the fused multiply adds
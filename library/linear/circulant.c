@@ -0,0 +1,199 @@
+#include "algebra.h"
+#include "simd.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <tgmath.h>
+#include <threads.h>
+
+// A circulant operator is applied to a vector by sliding its row along the vector
+// repeated three times, so that the products of a diagonal are contiguous in both. A
+// block of CIRCULANT_SUMS lanes of the result stays in registers while the row is
+// swept, and an antisymmetric row pairs its diagonals to halve the products.
+#define CIRCULANT_SUMS   (4)
+#define CIRCULANT_BLOCK  (CIRCULANT_SUMS * LINEAR_DOUBLES)
+#define CIRCULANT_GRAIN  (8) // vectors per task
+#define CIRCULANT_CACHED (16) // lengths with a kept derivative
+// the header padded to the alignment of the row
+#define CIRCULANT_HEADER \
+  ((sizeof(Circulant) + LINEAR_ALIGN - 1) / LINEAR_ALIGN * LINEAR_ALIGN)
+
+static Circulant* derivatives[CIRCULANT_CACHED];
+static mtx_t derivativesMutex;
+static once_flag derivativesOnce = ONCE_FLAG_INIT;
+
+static void derivatives_initialize() {
+  mtx_init(&derivativesMutex, mtx_plain);
+}
+static Circulant* Circulant_allocate(size_t length) {
+  Circulant* result = Linear_allocate(CIRCULANT_HEADER + length * sizeof(double));
+  if (!result) {
+    perror("Circulant allocation failed");
+    return 0;
+  }
+  *result = (Circulant){
+    .row = (double*)((unsigned char*)result + CIRCULANT_HEADER),
+    .length = length,
+  };
+  return result;
+}
+static bool isAntisymmetric(size_t length, const double row[static length]) {
+  bool result = length && !row[0];
+  for (size_t d = 1; length > d && result; d++) {
+    result = row[length - d] == -row[d];
+  }
+  return result;
+}
+// -(-1)^d cot(d pi / length) / 2 for even lengths and the cosecant for odd ones, the
+// second half mirrors the first so that the row is exactly antisymmetric
+static void differentiation_row(size_t length, double row[static length]) {
+  memset(row, 0, length * sizeof(*row));
+  for (size_t d = 1; length > 2 * d; d++) {
+    const double angle = (double)d * M_PI / (double)length;
+    const double sign = d % 2 ? 0.5 : -0.5;
+    row[d] = sign * (length % 2 ? 1 : cos(angle)) / sin(angle);
+    row[length - d] = -row[d];
+  }
+}
+Circulant* Circulant_create(size_t length, const double row[static length]) {
+  Circulant* result = Circulant_allocate(length);
+  if (result) {
+    memcpy(result->row, row, length * sizeof(*row));
+    result->antisymmetric = isAntisymmetric(length, row);
+  }
+  return result;
+}
+// the kept one, or one owned by the caller when every slot is taken
+Circulant* Circulant_differentiation(size_t length) {
+  call_once(&derivativesOnce, derivatives_initialize);
+  mtx_lock(&derivativesMutex);
+  Circulant* result = 0;
+  size_t empty = CIRCULANT_CACHED;
+  for (size_t i = 0; CIRCULANT_CACHED > i && !result; i++) {
+    if (derivatives[i] && derivatives[i]->length == length) {
+      result = derivatives[i];
+    }
+    else if (!derivatives[i] && CIRCULANT_CACHED == empty) {
+      empty = i;
+    }
+  }
+  if (!result && (result = Circulant_allocate(length))) {
+    differentiation_row(length, result->row);
+    result->antisymmetric = isAntisymmetric(length, result->row);
+    if (CIRCULANT_CACHED > empty) {
+      result->cached = true;
+      derivatives[empty] = result;
+    }
+  }
+  mtx_unlock(&derivativesMutex);
+  return result;
+}
+void Circulant_destroy(Circulant* circulant) {
+  if (circulant && !circulant->cached) {
+    free(circulant);
+  }
+}
+void Circulant_clear() {
+  call_once(&derivativesOnce, derivatives_initialize);
+  mtx_lock(&derivativesMutex);
+  for (size_t i = 0; CIRCULANT_CACHED > i; i++) {
+    free(derivatives[i]);
+    derivatives[i] = 0;
+  }
+  mtx_unlock(&derivativesMutex);
+}
+// the rows are the shifts of the first one
+void Matrix_differentiate(Matrix result[static 1]) {
+  const size_t length = result->columns;
+  differentiation_row(length, result->elements);
+  for (size_t n = 1; length > n; n++) {
+    for (size_t m = 0; length > m; m++) {
+      result->elements[n * length + m] = result->elements[(length + m - n) % length];
+    }
+  }
+}
+
+// result[n] = sum of row[d] u[n + d], u is the middle of the repeated vector
+static void apply(
+  const Circulant circulant[static 1],
+  const double* restrict u,
+  double* restrict result) {
+  const size_t length = circulant->length;
+  const double* row = circulant->row;
+  size_t n = 0;
+  for (; length >= n + CIRCULANT_BLOCK; n += CIRCULANT_BLOCK) {
+    linear_doubles sums[CIRCULANT_SUMS];
+    for (size_t s = 0; CIRCULANT_SUMS > s; s++) {
+      sums[s] = linear_fillDoubles(0.0);
+    }
+    if (circulant->antisymmetric) {
+      for (size_t d = 1; length > 2 * d; d++) {
+        const linear_doubles weight = linear_fillDoubles(row[d]);
+        for (size_t s = 0; CIRCULANT_SUMS > s; s++) {
+          const size_t i = n + s * LINEAR_DOUBLES;
+          const linear_doubles difference = linear_subtractDoubles(
+            linear_loadDoubles(&u[i + d]), linear_loadDoubles(&u[i - d]));
+          sums[s] = linear_maddDoubles(weight, difference, sums[s]);
+        }
+      }
+    }
+    else {
+      for (size_t d = 0; length > d; d++) {
+        const linear_doubles weight = linear_fillDoubles(row[d]);
+        for (size_t s = 0; CIRCULANT_SUMS > s; s++) {
+          const linear_doubles value = linear_loadDoubles(&u[n + s * LINEAR_DOUBLES + d]);
+          sums[s] = linear_maddDoubles(weight, value, sums[s]);
+        }
+      }
+    }
+    for (size_t s = 0; CIRCULANT_SUMS > s; s++) {
+      linear_storeDoubles(&result[n + s * LINEAR_DOUBLES], sums[s]);
+    }
+  }
+  for (; length > n; n++) {
+    double sum = 0;
+    for (size_t d = 0; length > d; d++) {
+      sum += row[d] * u[n + d];
+    }
+    result[n] = sum;
+  }
+}
+typedef struct {
+    const Batch_pool* pool;
+    const Circulant* circulant;
+    const Matrix* inputs;
+    Matrix* results;
+    double* repeated; // three copies of an input per thread
+} Apply;
+static void apply_run(void* argument, size_t begin, size_t end) {
+  const Apply* context = argument;
+  const size_t length = context->circulant->length;
+  double* repeated = &context->repeated[Batch_pool_worker(context->pool) * 3 * length];
+  for (size_t v = begin; end > v; v++) {
+    const double* input = &context->inputs->elements[v * length];
+    for (size_t copy = 0; 3 > copy; copy++) {
+      memcpy(&repeated[copy * length], input, length * sizeof(*input));
+    }
+    apply(context->circulant, repeated + length, &context->results->elements[v * length]);
+  }
+}
+void Circulant_apply(
+  Batch_pool* pool,
+  const Circulant circulant[static 1],
+  Matrix inputs[static 1],
+  Matrix results[static 1]) {
+  const size_t size = Batch_pool_threads(pool) * 3 * circulant->length;
+  Apply context = {
+    .pool = pool,
+    .circulant = circulant,
+    .inputs = inputs,
+    .results = results,
+    .repeated = Linear_allocate(size * sizeof(*context.repeated)),
+  };
+  if (!context.repeated) {
+    perror("Circulant_apply allocation failed");
+    return;
+  }
+  Batch_pool_run(pool, apply_run, &context, 0, inputs->rows, CIRCULANT_GRAIN);
+  free(context.repeated);
+}
@@ -0,0 +1,263 @@
+#include "algebra.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <complex.h>
+#include <tgmath.h>
+#include <threads.h>
+
+// The periodic spectral derivative of an even length goes through a real to complex
+// transform: the samples are packed in half as many complex numbers, transformed by a
+// mixed radix Cooley-Tukey, multiplied by i k with the Nyquist mode dropped and brought
+// back by the inverse. Odd and small lengths keep the dense sum.
+#define FFT_DENSE   (8) // lengths up to this one are summed directly, measured
+#define FFT_PLANS   (16) // lengths with a cached plan, the others plan every call
+#define FFT_FACTORS (64)
+
+typedef struct {
+    size_t length; // of the real input, twice that of the complex transform
+    size_t factors[FFT_FACTORS]; // pairs of radix and remaining length
+    size_t radix; // largest of the factors
+    double complex* twiddles; // e^(-2 pi i k / (length / 2))
+    double complex* split; // e^(-2 pi i k / length)
+} Plan;
+
+static Plan* plans[FFT_PLANS];
+static mtx_t plansMutex;
+static once_flag plansOnce = ONCE_FLAG_INIT;
+
+static void plans_initialize() {
+  mtx_init(&plansMutex, mtx_plain);
+}
+// fours first, then twos and the odd primes
+static void factorize(Plan plan[static 1], size_t n) {
+  size_t* factor = plan->factors;
+  size_t radix = 4;
+  plan->radix = 1;
+  while (n > 1) {
+    while (n % radix) {
+      radix = radix == 4 ? 2 : radix == 2 ? 3 : radix + 2;
+      if (radix * radix > n) {
+        radix = n;
+      }
+    }
+    n /= radix;
+    *factor++ = radix;
+    *factor++ = n;
+    plan->radix = radix > plan->radix ? radix : plan->radix;
+  }
+}
+static void Plan_destroy(Plan* plan) {
+  if (plan) {
+    free(plan->twiddles);
+    free(plan);
+  }
+}
+static Plan* Plan_create(size_t length) {
+  Plan* result = calloc(1, sizeof(*result));
+  if (!result) {
+    return 0;
+  }
+  const size_t n = length / 2;
+  result->length = length;
+  result->twiddles = Linear_allocate(2 * n * sizeof(*result->twiddles));
+  if (!result->twiddles) {
+    free(result);
+    return 0;
+  }
+  result->split = result->twiddles + n;
+  for (size_t k = 0; n > k; k++) {
+    result->twiddles[k] = cexp(-2.0 * M_PI * I * (double)k / (double)n);
+    result->split[k] = cexp(-2.0 * M_PI * I * (double)k / (double)length);
+  }
+  factorize(result, n);
+  return result;
+}
+// the cached plan, or one owned by the caller when the cache is full
+static Plan* Plan_get(size_t length, bool owned[static 1]) {
+  call_once(&plansOnce, plans_initialize);
+  mtx_lock(&plansMutex);
+  Plan* result = 0;
+  size_t empty = FFT_PLANS;
+  for (size_t i = 0; FFT_PLANS > i && !result; i++) {
+    if (plans[i] && plans[i]->length == length) {
+      result = plans[i];
+    }
+    else if (!plans[i] && FFT_PLANS == empty) {
+      empty = i;
+    }
+  }
+  *owned = false;
+  if (!result && (result = Plan_create(length))) {
+    if (FFT_PLANS > empty) {
+      plans[empty] = result;
+    }
+    else {
+      *owned = true;
+    }
+  }
+  mtx_unlock(&plansMutex);
+  return result;
+}
+
+static void butterfly2(
+  const Plan plan[static 1],
+  double complex* out,
+  size_t stride,
+  size_t m) {
+  for (size_t k = 0; m > k; k++) {
+    const double complex t = out[m + k] * plan->twiddles[k * stride];
+    out[m + k] = out[k] - t;
+    out[k] += t;
+  }
+}
+static void butterfly4(
+  const Plan plan[static 1],
+  double complex* out,
+  size_t stride,
+  size_t m) {
+  for (size_t k = 0; m > k; k++) {
+    const double complex s0 = out[k + m] * plan->twiddles[k * stride];
+    const double complex s1 = out[k + 2 * m] * plan->twiddles[2 * k * stride];
+    const double complex s2 = out[k + 3 * m] * plan->twiddles[3 * k * stride];
+    const double complex s3 = s0 + s2;
+    const double complex s4 = s0 - s2;
+    const double complex s5 = out[k] - s1;
+    const double complex s6 = out[k] + s1;
+    out[k] = s6 + s3;
+    out[k + 2 * m] = s6 - s3;
+    out[k + m] = s5 - I * s4;
+    out[k + 3 * m] = s5 + I * s4;
+  }
+}
+// any radix p in O(p^2), scratch holds p values
+static void butterfly(
+  const Plan plan[static 1],
+  double complex* out,
+  size_t stride,
+  size_t m,
+  size_t p,
+  double complex* scratch) {
+  const size_t n = plan->length / 2;
+  for (size_t u = 0; m > u; u++) {
+    for (size_t q = 0; p > q; q++) {
+      scratch[q] = out[u + q * m];
+    }
+    for (size_t q = 0; p > q; q++) {
+      const size_t k = u + q * m;
+      double complex sum = scratch[0];
+      size_t twiddle = 0;
+      for (size_t j = 1; p > j; j++) {
+        twiddle = (twiddle + stride * k) % n;
+        sum += scratch[j] * plan->twiddles[twiddle];
+      }
+      out[k] = sum;
+    }
+  }
+}
+// decimation in time, out receives the transform of every stride-th input
+static void transform(
+  const Plan plan[static 1],
+  double complex* out,
+  const double complex* in,
+  size_t stride,
+  const size_t* factors,
+  double complex* scratch) {
+  const size_t p = factors[0];
+  const size_t m = factors[1];
+  if (1 == m) {
+    for (size_t j = 0; p > j; j++) {
+      out[j] = in[j * stride];
+    }
+  }
+  else {
+    for (size_t j = 0; p > j; j++) {
+      transform(plan, out + j * m, in + j * stride, stride * p, factors + 2, scratch);
+    }
+  }
+  switch (p) {
+  case 2:
+    butterfly2(plan, out, stride, m);
+    break;
+  case 4:
+    butterfly4(plan, out, stride, m);
+    break;
+  default:
+    butterfly(plan, out, stride, m, p, scratch);
+  }
+}
+static void differentiate_spectral(
+  const Plan plan[static 1],
+  const double* input,
+  double* result,
+  double complex* buffer) {
+  const size_t n = plan->length / 2;
+  double complex* packed = buffer; // with room for the Nyquist mode
+  double complex* spectrum = packed + n + 1;
+  double complex* scratch = spectrum + n + 1;
+  for (size_t j = 0; n > j; j++) {
+    packed[j] = input[2 * j] + I * input[2 * j + 1];
+  }
+  transform(plan, spectrum, packed, 1, plan->factors, scratch);
+  // the halves of the real spectrum from the even and odd samples, times i k
+  for (size_t k = 0; n > k; k++) {
+    const double complex z = spectrum[k];
+    const double complex w = conj(spectrum[(n - k) % n]);
+    const double complex even = 0.5 * (z + w);
+    const double complex odd = -0.5 * I * (z - w);
+    packed[k] = I * (double)k * (even + plan->split[k] * odd);
+  }
+  packed[n] = 0;
+  // and back, the inverse by conjugation, the packed spectrum is conjugated on the way
+  for (size_t k = 0; n > k; k++) {
+    const double complex z = packed[k];
+    const double complex w = conj(packed[n - k]);
+    const double complex even = 0.5 * (z + w);
+    const double complex odd = 0.5 * (z - w) * conj(plan->split[k]);
+    spectrum[k] = conj(even + I * odd);
+  }
+  transform(plan, packed, spectrum, 1, plan->factors, scratch);
+  for (size_t j = 0; n > j; j++) {
+    const double complex z = conj(packed[j]) / (double)n;
+    result[2 * j] = creal(z);
+    result[2 * j + 1] = cimag(z);
+  }
+}
+// the vectors as matrices of a single row, the operator is kept for the next call
+static void differentiate_dense(size_t length, double* input, double* result) {
+  Circulant* operator = Circulant_differentiation(length);
+  if (!operator) {
+    return;
+  }
+  Matrix inputs = { .elements = input, .rows = 1, .columns = length };
+  Matrix results = { .elements = result, .rows = 1, .columns = length };
+  Circulant_apply(0, operator, &inputs, &results);
+  Circulant_destroy(operator);
+}
+void Vector_differentiate(Vector input[static 1], Vector result[static 1]) {
+  const size_t length = input->length;
+  bool owned = false;
+  Plan* plan = length % 2 || FFT_DENSE >= length ? 0 : Plan_get(length, &owned);
+  double complex* buffer =
+    plan ? Linear_allocate((2 * (length / 2 + 1) + plan->radix) * sizeof(*buffer)) : 0;
+  if (buffer) {
+    differentiate_spectral(plan, input->components, result->components, buffer);
+    free(buffer);
+  }
+  else {
+    differentiate_dense(length, input->components, result->components);
+  }
+  if (owned) {
+    Plan_destroy(plan);
+  }
+}
+void Linear_clear() {
+  call_once(&plansOnce, plans_initialize);
+  mtx_lock(&plansMutex);
+  for (size_t i = 0; FFT_PLANS > i; i++) {
+    Plan_destroy(plans[i]);
+    plans[i] = 0;
+  }
+  mtx_unlock(&plansMutex);
+  Circulant_clear();
+}
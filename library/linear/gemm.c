@@ -0,0 +1,183 @@
+#include "algebra.h"
+#include "simd.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+// The product is blocked for the caches: panels of b of GEMM_KC rows and GEMM_NC columns
+// are packed once and shared, blocks of a of GEMM_MC rows are packed by the thread that
+// owns them, and a register kernel updates GEMM_MR by GEMM_NR tiles of the result from
+// the packed slivers, which it reads contiguously.
+#define GEMM_MR    (4)
+#define GEMM_NR    (2 * LINEAR_DOUBLES)
+#define GEMM_KC    (256) // a sliver of b stays in the first level cache
+#define GEMM_MC    (64) // a block of a stays in the second level cache
+#define GEMM_NC    (2048) // a panel of b stays in the last level cache
+// products below this many multiply adds are not worth packing
+#define GEMM_SMALL (32 * 32 * 32)
+
+static size_t min(size_t a, size_t b) {
+  return a < b ? a : b;
+}
+// slivers of GEMM_MR rows, a column of the sliver after the other, zero past the edges
+static void pack_a(
+  const Matrix a[static 1],
+  size_t row,
+  size_t rows,
+  size_t column,
+  size_t columns,
+  double* restrict packed) {
+  for (size_t s = 0; rows > s; s += GEMM_MR) {
+    for (size_t k = 0; columns > k; k++) {
+      for (size_t r = 0; GEMM_MR > r; r++) {
+        const size_t index = (row + s + r) * a->columns + column + k;
+        *packed++ = rows > s + r ? a->elements[index] : 0;
+      }
+    }
+  }
+}
+// slivers of GEMM_NR columns, a row of the sliver after the other
+static void pack_b(
+  const Matrix b[static 1],
+  size_t row,
+  size_t rows,
+  size_t column,
+  size_t columns,
+  double* restrict packed) {
+  for (size_t s = 0; columns > s; s += GEMM_NR) {
+    const size_t width = min(GEMM_NR, columns - s);
+    for (size_t k = 0; rows > k; k++) {
+      const double* source = &b->elements[(row + k) * b->columns + column + s];
+      memcpy(packed, source, width * sizeof(*source));
+      memset(packed + width, 0, (GEMM_NR - width) * sizeof(double));
+      packed += GEMM_NR;
+    }
+  }
+}
+// adds the product of the slivers to the tile, the edge tiles go through a buffer
+static void kernel(
+  size_t depth,
+  const double* restrict a,
+  const double* restrict b,
+  double* restrict c,
+  size_t stride,
+  size_t rows,
+  size_t columns) {
+  linear_doubles sums[GEMM_MR][2];
+  for (size_t r = 0; GEMM_MR > r; r++) {
+    sums[r][0] = sums[r][1] = linear_fillDoubles(0.0);
+  }
+  for (size_t k = 0; depth > k; k++) {
+    const linear_doubles low = linear_loadDoubles(&b[k * GEMM_NR]);
+    const linear_doubles high = linear_loadDoubles(&b[k * GEMM_NR + LINEAR_DOUBLES]);
+    for (size_t r = 0; GEMM_MR > r; r++) {
+      const linear_doubles weight = linear_fillDoubles(a[k * GEMM_MR + r]);
+      sums[r][0] = linear_maddDoubles(weight, low, sums[r][0]);
+      sums[r][1] = linear_maddDoubles(weight, high, sums[r][1]);
+    }
+  }
+  if (GEMM_MR == rows && GEMM_NR == columns) {
+    for (size_t r = 0; GEMM_MR > r; r++) {
+      double* row = &c[r * stride];
+      linear_storeDoubles(row, linear_addDoubles(linear_loadDoubles(row), sums[r][0]));
+      double* half = row + LINEAR_DOUBLES;
+      linear_storeDoubles(half, linear_addDoubles(linear_loadDoubles(half), sums[r][1]));
+    }
+    return;
+  }
+  double tile[GEMM_MR][GEMM_NR];
+  for (size_t r = 0; GEMM_MR > r; r++) {
+    linear_storeDoubles(&tile[r][0], sums[r][0]);
+    linear_storeDoubles(&tile[r][LINEAR_DOUBLES], sums[r][1]);
+  }
+  for (size_t r = 0; rows > r; r++) {
+    for (size_t s = 0; columns > s; s++) {
+      c[r * stride + s] += tile[r][s];
+    }
+  }
+}
+typedef struct {
+    const Batch_pool* pool;
+    const Matrix* a;
+    Matrix* result;
+    const double* panel; // packed b
+    double* packed; // GEMM_MC by GEMM_KC per thread
+    size_t row; // of the panel in b
+    size_t rows;
+    size_t column;
+    size_t columns;
+} Gemm;
+// the blocks of GEMM_MC rows of the result from begin to end, a thread packs them in its
+// own part of the scratch
+static void blocks_run(void* argument, size_t begin, size_t end) {
+  const Gemm* context = argument;
+  double* packed = &context->packed[Batch_pool_worker(context->pool) * GEMM_MC * GEMM_KC];
+  Matrix* result = context->result;
+  for (size_t block = begin; end > block; block++) {
+    const size_t row = block * GEMM_MC;
+    const size_t rows = min(GEMM_MC, result->rows - row);
+    pack_a(context->a, row, rows, context->row, context->rows, packed);
+    for (size_t s = 0; context->columns > s; s += GEMM_NR) {
+      for (size_t r = 0; rows > r; r += GEMM_MR) {
+        kernel(
+          context->rows,
+          &packed[r * context->rows],
+          &context->panel[s * context->rows],
+          &result->elements[(row + r) * result->columns + context->column + s],
+          result->columns,
+          min(GEMM_MR, rows - r),
+          min(GEMM_NR, context->columns - s));
+      }
+    }
+  }
+}
+void Matrix_multiplyParallel(
+  Batch_pool* pool,
+  Matrix a[static 1],
+  Matrix b[static 1],
+  Matrix result[static 1]) {
+  memset(result->elements, 0, result->rows * result->columns * sizeof(*result->elements));
+  if (GEMM_SMALL >= a->rows * a->columns * b->columns) {
+    // the rows of b are read contiguously
+    for (size_t n = 0; a->rows > n; n++) {
+      for (size_t k = 0; a->columns > k; k++) {
+        const double weight = a->elements[n * a->columns + k];
+        double* row = &result->elements[n * result->columns];
+        for (size_t m = 0; b->columns > m; m++) {
+          row[m] += weight * b->elements[k * b->columns + m];
+        }
+      }
+    }
+    return;
+  }
+  // the panel of b and the blocks of a of every thread in one allocation
+  const size_t threads = Batch_pool_threads(pool);
+  double* panel =
+    Linear_allocate((GEMM_KC * GEMM_NC + threads * GEMM_MC * GEMM_KC) * sizeof(*panel));
+  if (!panel) {
+    perror("Matrix_multiply allocation failed");
+    return;
+  }
+  Gemm context = {
+    .pool = pool,
+    .a = a,
+    .result = result,
+    .panel = panel,
+    .packed = &panel[GEMM_KC * GEMM_NC],
+  };
+  const size_t blocks = (a->rows + GEMM_MC - 1) / GEMM_MC;
+  for (size_t column = 0; b->columns > column; column += GEMM_NC) {
+    context.column = column;
+    context.columns = min(GEMM_NC, b->columns - column);
+    for (size_t row = 0; b->rows > row; row += GEMM_KC) {
+      context.row = row;
+      context.rows = min(GEMM_KC, b->rows - row);
+      pack_b(b, context.row, context.rows, context.column, context.columns, panel);
+      Batch_pool_run(pool, blocks_run, &context, 0, blocks, 1);
+    }
+  }
+  free(panel);
+}
+void Matrix_multiply(Matrix a[static 1], Matrix b[static 1], Matrix result[static 1]) {
+  Matrix_multiplyParallel(0, a, b, result);
+}
@@ -0,0 +1,441 @@
+#include "algebra.h"
+#include "simd.h"
+#include <float.h>
+#include <tgmath.h>
+
+// Quaternions keep the vector part in the first three lanes so that a quaternion is a
+// single 128 bit register. The products are sums of the other one swizzled and signed
+// by a lane of the first, a rotation of a vector two cross products, and the normal
+// matrix three cross products of the rows.
+#if LINEAR_SSE
+// by halves, a quaternion argument comes in two 64 bit registers and a 128 bit load of
+// their spill would wait for both stores
+static inline __m128 load(Quaternionf q) {
+  const __m128 low = _mm_loadl_pi(_mm_setzero_ps(), (const __m64*)&q.components[0]);
+  return _mm_loadh_pi(low, (const __m64*)&q.components[2]);
+}
+static inline __m128 load3(Vector3f v) {
+  return _mm_setr_ps(v.components[0], v.components[1], v.components[2], 0.0f);
+}
+static inline Vector3f store3(__m128 v) {
+  float lanes[4];
+  _mm_storeu_ps(lanes, v);
+  return (Vector3f){ .components = { lanes[0], lanes[1], lanes[2] } };
+}
+// the fourth lane is zero for finite inputs
+static inline __m128 cross(__m128 a, __m128 b) {
+  return _mm_sub_ps(
+    _mm_mul_ps(LINEAR_SWIZZLE(a, 1, 2, 0, 3), LINEAR_SWIZZLE(b, 2, 0, 1, 3)),
+    _mm_mul_ps(LINEAR_SWIZZLE(a, 2, 0, 1, 3), LINEAR_SWIZZLE(b, 1, 2, 0, 3)));
+}
+// the sum in every lane
+static inline __m128 inner(__m128 a, __m128 b) {
+  __m128 products = _mm_mul_ps(a, b);
+  products = _mm_add_ps(products, LINEAR_SWIZZLE(products, 1, 0, 3, 2));
+  return _mm_add_ps(products, LINEAR_SWIZZLE(products, 2, 3, 0, 1));
+}
+static inline __m128 multiply(__m128 a, __m128 b) {
+  __m128 result = _mm_mul_ps(LINEAR_SWIZZLE(a, 3, 3, 3, 3), b);
+  result = linear_madd(
+    LINEAR_SWIZZLE(a, 0, 0, 0, 0),
+    _mm_mul_ps(LINEAR_SWIZZLE(b, 3, 2, 1, 0), _mm_setr_ps(1.0f, -1.0f, 1.0f, -1.0f)),
+    result);
+  result = linear_madd(
+    LINEAR_SWIZZLE(a, 1, 1, 1, 1),
+    _mm_mul_ps(LINEAR_SWIZZLE(b, 2, 3, 0, 1), _mm_setr_ps(1.0f, 1.0f, -1.0f, -1.0f)),
+    result);
+  return linear_madd(
+    LINEAR_SWIZZLE(a, 2, 2, 2, 2),
+    _mm_mul_ps(LINEAR_SWIZZLE(b, 1, 0, 3, 2), _mm_setr_ps(-1.0f, 1.0f, 1.0f, -1.0f)),
+    result);
+}
+// v + w t + u x t with t = 2 u x v, the scalar part w of q drops out of the products
+static inline __m128 rotate(__m128 q, __m128 v) {
+  const __m128 half = cross(q, v);
+  const __m128 t = _mm_add_ps(half, half);
+  return _mm_add_ps(linear_madd(LINEAR_SWIZZLE(q, 3, 3, 3, 3), t, v), cross(q, t));
+}
+// twice the vector part of dual conj(real), 2 (w d - s r + r x d) with r and d the
+// vector parts and w and s the scalar ones
+static inline __m128 displacement(__m128 real, __m128 dual) {
+  const __m128 t = _mm_sub_ps(
+    _mm_add_ps(_mm_mul_ps(LINEAR_SWIZZLE(real, 3, 3, 3, 3), dual), cross(real, dual)),
+    _mm_mul_ps(LINEAR_SWIZZLE(dual, 3, 3, 3, 3), real));
+  return _mm_add_ps(t, t);
+}
+#else
+static inline void cross(
+  const float a[static 3],
+  const float b[static 3],
+  float result[static 3]) {
+  result[0] = a[1] * b[2] - a[2] * b[1];
+  result[1] = a[2] * b[0] - a[0] * b[2];
+  result[2] = a[0] * b[1] - a[1] * b[0];
+}
+static inline Vector3f rotate(Quaternionf q, Vector3f v) {
+  float t[3];
+  float u[3];
+  cross(q.components, v.components, t);
+  for (size_t n = 0; 3 > n; n++) {
+    t[n] *= 2.0f;
+  }
+  cross(q.components, t, u);
+  for (size_t n = 0; 3 > n; n++) {
+    v.components[n] += q.components[3] * t[n] + u[n];
+  }
+  return v;
+}
+static inline Vector3f displacement(DualQuaternionf d) {
+  const float* r = d.real.components;
+  const float* v = d.dual.components;
+  Vector3f result = { 0 };
+  cross(r, v, result.components);
+  for (size_t n = 0; 3 > n; n++) {
+    result.components[n] = 2.0f * (r[3] * v[n] - v[3] * r[n] + result.components[n]);
+  }
+  return result;
+}
+#endif
+
+Quaternionf Quaternionf_identity() {
+  return (Quaternionf){ .components = { 0.0f, 0.0f, 0.0f, 1.0f } };
+}
+Quaternionf Quaternionf_fromAxisAngle(Vector3f axis, float angle) {
+  const float s = sin(0.5f * angle);
+  return (Quaternionf){ .components = {
+                          s * axis.components[0],
+                          s * axis.components[1],
+                          s * axis.components[2],
+                          cos(0.5f * angle),
+                        } };
+}
+// from the largest of the diagonal and the trace, Shepperd's choice
+Quaternionf Quaternionf_fromMatrix(Matrix4f matrix) {
+  const float* m = matrix.elements;
+  const float trace = m[0] + m[5] + m[10];
+  Quaternionf result = { 0 };
+  float* q = result.components;
+  if (trace > 0) {
+    const float s = 2.0f * sqrt(1.0f + trace);
+    q[0] = (m[9] - m[6]) / s;
+    q[1] = (m[2] - m[8]) / s;
+    q[2] = (m[4] - m[1]) / s;
+    q[3] = 0.25f * s;
+  }
+  else if (m[0] > m[5] && m[0] > m[10]) {
+    const float s = 2.0f * sqrt(1.0f + m[0] - m[5] - m[10]);
+    q[0] = 0.25f * s;
+    q[1] = (m[1] + m[4]) / s;
+    q[2] = (m[2] + m[8]) / s;
+    q[3] = (m[9] - m[6]) / s;
+  }
+  else if (m[5] > m[10]) {
+    const float s = 2.0f * sqrt(1.0f + m[5] - m[0] - m[10]);
+    q[0] = (m[1] + m[4]) / s;
+    q[1] = 0.25f * s;
+    q[2] = (m[6] + m[9]) / s;
+    q[3] = (m[2] - m[8]) / s;
+  }
+  else {
+    const float s = 2.0f * sqrt(1.0f + m[10] - m[0] - m[5]);
+    q[0] = (m[2] + m[8]) / s;
+    q[1] = (m[6] + m[9]) / s;
+    q[2] = 0.25f * s;
+    q[3] = (m[4] - m[1]) / s;
+  }
+  return result;
+}
+Quaternionf Quaternionf_multiply(Quaternionf a, Quaternionf b) {
+  Quaternionf result = { 0 };
+#if LINEAR_SSE
+  _mm_storeu_ps(
+    result.components,
+    multiply(load(a), load(b)));
+#else
+  const float* p = a.components;
+  const float* q = b.components;
+  result.components[0] = p[3] * q[0] + p[0] * q[3] + p[1] * q[2] - p[2] * q[1];
+  result.components[1] = p[3] * q[1] - p[0] * q[2] + p[1] * q[3] + p[2] * q[0];
+  result.components[2] = p[3] * q[2] + p[0] * q[1] - p[1] * q[0] + p[2] * q[3];
+  result.components[3] = p[3] * q[3] - p[0] * q[0] - p[1] * q[1] - p[2] * q[2];
+#endif
+  return result;
+}
+Quaternionf Quaternionf_conjugate(Quaternionf q) {
+  return (Quaternionf){ .components = {
+                          -q.components[0],
+                          -q.components[1],
+                          -q.components[2],
+                          q.components[3],
+                        } };
+}
+float Quaternionf_inner(Quaternionf a, Quaternionf b) {
+  float result = 0;
+  for (size_t n = 0; 4 > n; n++) {
+    result += a.components[n] * b.components[n];
+  }
+  return result;
+}
+Quaternionf Quaternionf_normalize(Quaternionf q) {
+  const float reciprocal = 1.0f / sqrt(Quaternionf_inner(q, q));
+  for (size_t n = 0; 4 > n; n++) {
+    q.components[n] *= reciprocal;
+  }
+  return q;
+}
+Vector3f Quaternionf_rotate(Quaternionf q, Vector3f v) {
+#if LINEAR_SSE
+  return store3(rotate(load(q), load3(v)));
+#else
+  return rotate(q, v);
+#endif
+}
+// a normalized linear interpolation when the quaternions are too close for the sine
+Quaternionf Quaternionf_slerp(Quaternionf a, Quaternionf b, float t) {
+  float cosine = Quaternionf_inner(a, b);
+  const float sign = 0 > cosine ? -1.0f : 1.0f;
+  cosine *= sign;
+  float wa = 1.0f - t;
+  float wb = t;
+  if (0.9995f > cosine) {
+    const float angle = acos(cosine);
+    const float reciprocal = 1.0f / sin(angle);
+    wa = sin(wa * angle) * reciprocal;
+    wb = sin(wb * angle) * reciprocal;
+  }
+  Quaternionf result = { 0 };
+  for (size_t n = 0; 4 > n; n++) {
+    result.components[n] = wa * a.components[n] + sign * wb * b.components[n];
+  }
+  return Quaternionf_normalize(result);
+}
+Matrix4f Quaternionf_toMatrix(Quaternionf q) {
+  const float x = q.components[0];
+  const float y = q.components[1];
+  const float z = q.components[2];
+  const float w = q.components[3];
+  return (Matrix4f){ .elements = {
+                       1.0f - 2.0f * (y * y + z * z),
+                       2.0f * (x * y - w * z),
+                       2.0f * (x * z + w * y),
+                       0.0f,
+                       2.0f * (x * y + w * z),
+                       1.0f - 2.0f * (x * x + z * z),
+                       2.0f * (y * z - w * x),
+                       0.0f,
+                       2.0f * (x * z - w * y),
+                       2.0f * (y * z + w * x),
+                       1.0f - 2.0f * (x * x + y * y),
+                       0.0f,
+                       0.0f,
+                       0.0f,
+                       0.0f,
+                       1.0f,
+                     } };
+}
+
+DualQuaternionf DualQuaternionf_make(Quaternionf rotation, Vector3f translation) {
+  const Quaternionf t = { .components = {
+                            0.5f * translation.components[0],
+                            0.5f * translation.components[1],
+                            0.5f * translation.components[2],
+                            0.0f,
+                          } };
+  return (DualQuaternionf){
+    .real = rotation,
+    .dual = Quaternionf_multiply(t, rotation),
+  };
+}
+DualQuaternionf DualQuaternionf_multiply(DualQuaternionf a, DualQuaternionf b) {
+  DualQuaternionf result = { .real = Quaternionf_multiply(a.real, b.real) };
+#if LINEAR_SSE
+  const __m128 real = load(a.real);
+  const __m128 dual = load(a.dual);
+  _mm_storeu_ps(
+    result.dual.components,
+    _mm_add_ps(
+      multiply(real, load(b.dual)),
+      multiply(dual, load(b.real))));
+#else
+  const Quaternionf first = Quaternionf_multiply(a.real, b.dual);
+  const Quaternionf second = Quaternionf_multiply(a.dual, b.real);
+  for (size_t n = 0; 4 > n; n++) {
+    result.dual.components[n] = first.components[n] + second.components[n];
+  }
+#endif
+  return result;
+}
+Vector3f DualQuaternionf_transform(DualQuaternionf d, Vector3f point) {
+#if LINEAR_SSE
+  const __m128 real = load(d.real);
+  const __m128 moved = _mm_add_ps(
+    rotate(real, load3(point)), displacement(real, load(d.dual)));
+  return store3(moved);
+#else
+  Vector3f result = rotate(d.real, point);
+  const Vector3f t = displacement(d);
+  for (size_t n = 0; 3 > n; n++) {
+    result.components[n] += t.components[n];
+  }
+  return result;
+#endif
+}
+DualQuaternionf DualQuaternionf_blend(
+  size_t count,
+  const DualQuaternionf transforms[static count],
+  const float weights[static count]) {
+  DualQuaternionf result = { 0 };
+  if (!count) {
+    result.real = Quaternionf_identity();
+    return result;
+  }
+  const Quaternionf pivot = transforms[0].real;
+#if LINEAR_SSE
+  const __m128 first = load(pivot);
+  __m128 real = _mm_setzero_ps();
+  __m128 dual = _mm_setzero_ps();
+  for (size_t i = 0; count > i; i++) {
+    const __m128 r = load(transforms[i].real);
+    // the sign bit of the inner product flips the weight
+    const __m128 sign = _mm_and_ps(inner(first, r), _mm_set1_ps(-0.0f));
+    const __m128 weight = _mm_xor_ps(_mm_set1_ps(weights[i]), sign);
+    real = linear_madd(weight, r, real);
+    dual = linear_madd(weight, load(transforms[i].dual), dual);
+  }
+  const __m128 reciprocal = _mm_div_ps(_mm_set1_ps(1.0f), _mm_sqrt_ps(inner(real, real)));
+  _mm_storeu_ps(result.real.components, _mm_mul_ps(real, reciprocal));
+  _mm_storeu_ps(result.dual.components, _mm_mul_ps(dual, reciprocal));
+#else
+  for (size_t i = 0; count > i; i++) {
+    const float weight =
+      0 > Quaternionf_inner(pivot, transforms[i].real) ? -weights[i] : weights[i];
+    for (size_t n = 0; 4 > n; n++) {
+      result.real.components[n] += weight * transforms[i].real.components[n];
+      result.dual.components[n] += weight * transforms[i].dual.components[n];
+    }
+  }
+  const float reciprocal = 1.0f / sqrt(Quaternionf_inner(result.real, result.real));
+  for (size_t n = 0; 4 > n; n++) {
+    result.real.components[n] *= reciprocal;
+    result.dual.components[n] *= reciprocal;
+  }
+#endif
+  return result;
+}
+Matrix4f DualQuaternionf_toMatrix(DualQuaternionf d) {
+  Matrix4f result = Quaternionf_toMatrix(d.real);
+#if LINEAR_SSE
+  const __m128 real = load(d.real);
+  const Vector3f t = store3(displacement(real, load(d.dual)));
+#else
+  const Vector3f t = displacement(d);
+#endif
+  for (size_t n = 0; 3 > n; n++) {
+    result.elements[4 * n + 3] = t.components[n];
+  }
+  return result;
+}
+
+// the columns of the rotation scaled and the translation in the last one
+Matrix4f Transformf_compose(Transformf transform) {
+  Matrix4f result = Quaternionf_toMatrix(transform.rotation);
+  const float* s = transform.scale.components;
+  const float* t = transform.translation.components;
+#if LINEAR_SSE
+  const __m128 scale = _mm_setr_ps(s[0], s[1], s[2], 0.0f);
+  for (size_t n = 0; 3 > n; n++) {
+    const __m128 row = _mm_mul_ps(_mm_loadu_ps(&result.elements[4 * n]), scale);
+    _mm_storeu_ps(&result.elements[4 * n], _mm_add_ps(row, _mm_setr_ps(0, 0, 0, t[n])));
+  }
+#else
+  for (size_t n = 0; 3 > n; n++) {
+    for (size_t m = 0; 3 > m; m++) {
+      result.elements[4 * n + m] *= s[m];
+    }
+    result.elements[4 * n + 3] = t[n];
+  }
+#endif
+  return result;
+}
+// the scales are the lengths of the columns, the rotation what remains once they are
+// divided out, an axis scaled to nothing is the cross product of the other two and the
+// rotation the identity when fewer than two are left
+Transformf Matrix4f_decompose(Matrix4f matrix) {
+  const float* m = matrix.elements;
+  Transformf result = {
+    .translation = { .components = { m[3], m[7], m[11] } },
+  };
+  const float determinant = m[0] * (m[5] * m[10] - m[6] * m[9])
+                            - m[1] * (m[4] * m[10] - m[6] * m[8])
+                            + m[2] * (m[4] * m[9] - m[5] * m[8]);
+  float largest = 0.0f;
+  for (size_t c = 0; 3 > c; c++) {
+    result.scale.components[c] =
+      sqrt(m[c] * m[c] + m[4 + c] * m[4 + c] + m[8 + c] * m[8 + c]);
+    largest = fmax(largest, result.scale.components[c]);
+  }
+  bool flat[3];
+  size_t flats = 0;
+  for (size_t c = 0; 3 > c; c++) {
+    flat[c] = FLT_EPSILON * largest >= result.scale.components[c];
+    flats += flat[c];
+  }
+  if (!flats && 0 > determinant) {
+    result.scale.components[0] = -result.scale.components[0];
+  }
+  Matrix4f rotation = Matrix4f_diagonal(1.0f);
+  if (1 >= flats) {
+    for (size_t n = 0; 3 > n; n++) {
+      for (size_t c = 0; 3 > c; c++) {
+        if (!flat[c]) {
+          rotation.elements[4 * n + c] = m[4 * n + c] / result.scale.components[c];
+        }
+      }
+    }
+    for (size_t c = 0; 3 > c; c++) {
+      if (flat[c]) {
+        const float* r = rotation.elements;
+        const size_t a = (c + 1) % 3;
+        const size_t b = (c + 2) % 3;
+        for (size_t n = 0; 3 > n; n++) {
+          const size_t next = (n + 1) % 3;
+          const size_t last = (n + 2) % 3;
+          rotation.elements[4 * n + c] =
+            r[4 * next + a] * r[4 * last + b] - r[4 * last + a] * r[4 * next + b];
+        }
+      }
+    }
+  }
+  result.rotation = Quaternionf_fromMatrix(rotation);
+  return result;
+}
+// the cofactors of the rows r over the determinant, r1 x r2, r2 x r0 and r0 x r1
+Matrix4f Matrix4f_normal(Matrix4f model) {
+  Matrix4f result = { 0 };
+#if LINEAR_SSE
+  const __m128 r0 = _mm_loadu_ps(&model.elements[0]);
+  const __m128 r1 = _mm_loadu_ps(&model.elements[4]);
+  const __m128 r2 = _mm_loadu_ps(&model.elements[8]);
+  const __m128 c0 = cross(r1, r2);
+  const __m128 c1 = cross(r2, r0);
+  const __m128 c2 = cross(r0, r1);
+  const __m128 reciprocal = _mm_div_ps(_mm_set1_ps(1.0f), inner(r0, c0));
+  _mm_storeu_ps(&result.elements[0], _mm_mul_ps(c0, reciprocal));
+  _mm_storeu_ps(&result.elements[4], _mm_mul_ps(c1, reciprocal));
+  _mm_storeu_ps(&result.elements[8], _mm_mul_ps(c2, reciprocal));
+#else
+  const float* r = model.elements;
+  for (size_t n = 0; 3 > n; n++) {
+    cross(&r[4 * ((n + 1) % 3)], &r[4 * ((n + 2) % 3)], &result.elements[4 * n]);
+  }
+  const float* c = result.elements;
+  const float reciprocal = 1.0f / (r[0] * c[0] + r[1] * c[1] + r[2] * c[2]);
+  for (size_t n = 0; 3 > n; n++) {
+    for (size_t m = 0; 3 > m; m++) {
+      result.elements[4 * n + m] *= reciprocal;
+    }
+  }
+#endif
+  result.elements[15] = 1.0f;
+  return result;
+}
@@ -0,0 +1,170 @@
+#ifndef linear_simd_H_
+#define linear_simd_H_
+
+// The 4 wide float kernels are chosen at compile time from the target: SSE on x86 (fused
+// multiply adds when -mfma is given), NEON on ARM and plain loops otherwise or when
+// LINEAR_SCALAR is defined. A 4x4 float matrix is four 128 bit rows, 256 bit registers
+// holding two of them measured slower than the 128 bit kernels, the batches of
+// structures of arrays use the full width of -mavx instead.
+#if !defined(LINEAR_SCALAR) && (defined(__SSE2__) || defined(_M_X64))
+  #define LINEAR_SSE 1
+  #include <immintrin.h>
+#elif !defined(LINEAR_SCALAR) && defined(__ARM_NEON)
+  #define LINEAR_NEON 1
+  #include <arm_neon.h>
+#endif
+
+#if LINEAR_SSE
+  #define LINEAR_SHUFFLE(a, b, x, y, z, w) \
+    _mm_shuffle_ps((a), (b), (x) | ((y) << 2) | ((z) << 4) | ((w) << 6))
+  #define LINEAR_SWIZZLE(a, x, y, z, w) LINEAR_SHUFFLE((a), (a), (x), (y), (z), (w))
+// a * b + c
+static inline __m128 linear_madd(__m128 a, __m128 b, __m128 c) {
+  #ifdef __FMA__
+  return _mm_fmadd_ps(a, b, c);
+  #else
+  return _mm_add_ps(_mm_mul_ps(a, b), c);
+  #endif
+}
+#endif
+
+// lanes of the batched kernels, a single float when there is no vector unit
+#if LINEAR_SSE && defined(__AVX__)
+  #define LINEAR_LANES 8
+typedef __m256 linear_lanes;
+  #define linear_load(pointer)         _mm256_load_ps(pointer)
+  #define linear_store(pointer, value) _mm256_store_ps((pointer), (value))
+  #define linear_fill(value)           _mm256_set1_ps(value)
+  #define linear_add(a, b)             _mm256_add_ps((a), (b))
+  #define linear_multiply(a, b)        _mm256_mul_ps((a), (b))
+  #ifdef __FMA__
+    #define linear_maddLanes(a, b, c) _mm256_fmadd_ps((a), (b), (c))
+  #else
+    #define linear_maddLanes(a, b, c) _mm256_add_ps(_mm256_mul_ps((a), (b)), (c))
+  #endif
+#elif LINEAR_SSE
+  #define LINEAR_LANES 4
+typedef __m128 linear_lanes;
+  #define linear_load(pointer)         _mm_load_ps(pointer)
+  #define linear_store(pointer, value) _mm_store_ps((pointer), (value))
+  #define linear_fill(value)           _mm_set1_ps(value)
+  #define linear_add(a, b)             _mm_add_ps((a), (b))
+  #define linear_multiply(a, b)        _mm_mul_ps((a), (b))
+  #define linear_maddLanes(a, b, c)    linear_madd((a), (b), (c))
+#elif LINEAR_NEON
+  #define LINEAR_LANES 4
+typedef float32x4_t linear_lanes;
+  #define linear_load(pointer)         vld1q_f32(pointer)
+  #define linear_store(pointer, value) vst1q_f32((pointer), (value))
+  #define linear_fill(value)           vdupq_n_f32(value)
+  #define linear_add(a, b)             vaddq_f32((a), (b))
+  #define linear_multiply(a, b)        vmulq_f32((a), (b))
+  #define linear_maddLanes(a, b, c)    vfmaq_f32((c), (a), (b))
+#else
+  #define LINEAR_LANES 1
+typedef float linear_lanes;
+  #define linear_load(pointer)         (*(pointer))
+  #define linear_store(pointer, value) (*(pointer) = (value))
+  #define linear_fill(value)           (value)
+  #define linear_add(a, b)             ((a) + (b))
+  #define linear_multiply(a, b)        ((a) * (b))
+  #define linear_maddLanes(a, b, c)    ((a) * (b) + (c))
+#endif
+
+// the same for doubles, the lanes of the dense Matrix kernels
+#if LINEAR_SSE && defined(__AVX__)
+  #define LINEAR_DOUBLES 4
+typedef __m256d linear_doubles;
+  #define linear_loadDoubles(pointer)         _mm256_loadu_pd(pointer)
+  #define linear_storeDoubles(pointer, value) _mm256_storeu_pd((pointer), (value))
+  #define linear_fillDoubles(value)           _mm256_set1_pd(value)
+  #define linear_addDoubles(a, b)             _mm256_add_pd((a), (b))
+  #define linear_subtractDoubles(a, b)        _mm256_sub_pd((a), (b))
+  #ifdef __FMA__
+    #define linear_maddDoubles(a, b, c) _mm256_fmadd_pd((a), (b), (c))
+  #else
+    #define linear_maddDoubles(a, b, c) _mm256_add_pd(_mm256_mul_pd((a), (b)), (c))
+  #endif
+#elif LINEAR_SSE
+  #define LINEAR_DOUBLES 2
+typedef __m128d linear_doubles;
+  #define linear_loadDoubles(pointer)         _mm_loadu_pd(pointer)
+  #define linear_storeDoubles(pointer, value) _mm_storeu_pd((pointer), (value))
+  #define linear_fillDoubles(value)           _mm_set1_pd(value)
+  #define linear_addDoubles(a, b)             _mm_add_pd((a), (b))
+  #define linear_subtractDoubles(a, b)        _mm_sub_pd((a), (b))
+  #ifdef __FMA__
+    #define linear_maddDoubles(a, b, c) _mm_fmadd_pd((a), (b), (c))
+  #else
+    #define linear_maddDoubles(a, b, c) _mm_add_pd(_mm_mul_pd((a), (b)), (c))
+  #endif
+#elif LINEAR_NEON && defined(__aarch64__)
+  #define LINEAR_DOUBLES 2
+typedef float64x2_t linear_doubles;
+  #define linear_loadDoubles(pointer)         vld1q_f64(pointer)
+  #define linear_storeDoubles(pointer, value) vst1q_f64((pointer), (value))
+  #define linear_fillDoubles(value)           vdupq_n_f64(value)
+  #define linear_addDoubles(a, b)             vaddq_f64((a), (b))
+  #define linear_subtractDoubles(a, b)        vsubq_f64((a), (b))
+  #define linear_maddDoubles(a, b, c)         vfmaq_f64((c), (a), (b))
+#else
+  #define LINEAR_DOUBLES 1
+typedef double linear_doubles;
+  #define linear_loadDoubles(pointer)         (*(pointer))
+  #define linear_storeDoubles(pointer, value) (*(pointer) = (value))
+  #define linear_fillDoubles(value)           (value)
+  #define linear_addDoubles(a, b)             ((a) + (b))
+  #define linear_subtractDoubles(a, b)        ((a) - (b))
+  #define linear_maddDoubles(a, b, c)         ((a) * (b) + (c))
+#endif
+
+// complete unrolling of the loops over the dimensions of the fixed size kernels
+#ifdef __GNUC__
+  #define LINEAR_UNROLL _Pragma("GCC unroll 16")
+#else
+  #define LINEAR_UNROLL
+#endif
+
+// cofactors by the 2x2 minors of the top and bottom rows, the 4x4 inverse of the plain
+// loops in both precisions
+#define linear_inverse4(T)                                                               \
+  static inline void linear_inverse4_##T(const T m[static 16], T r[static 16]) {         \
+    const T s[6] = {                                                                     \
+      m[0] * m[5] - m[1] * m[4],                                                         \
+      m[0] * m[6] - m[2] * m[4],                                                         \
+      m[0] * m[7] - m[3] * m[4],                                                         \
+      m[1] * m[6] - m[2] * m[5],                                                         \
+      m[1] * m[7] - m[3] * m[5],                                                         \
+      m[2] * m[7] - m[3] * m[6],                                                         \
+    };                                                                                   \
+    const T c[6] = {                                                                     \
+      m[8] * m[13] - m[9] * m[12],                                                       \
+      m[8] * m[14] - m[10] * m[12],                                                      \
+      m[8] * m[15] - m[11] * m[12],                                                      \
+      m[9] * m[14] - m[10] * m[13],                                                      \
+      m[9] * m[15] - m[11] * m[13],                                                      \
+      m[10] * m[15] - m[11] * m[14],                                                     \
+    };                                                                                   \
+    const T reciprocal =                                                                 \
+      1 / (s[0] * c[5] - s[1] * c[4] + s[2] * c[3] + s[3] * c[2] - s[4] * c[1]           \
+           + s[5] * c[0]);                                                               \
+    r[0] = (m[5] * c[5] - m[6] * c[4] + m[7] * c[3]) * reciprocal;                       \
+    r[1] = (-m[1] * c[5] + m[2] * c[4] - m[3] * c[3]) * reciprocal;                      \
+    r[2] = (m[13] * s[5] - m[14] * s[4] + m[15] * s[3]) * reciprocal;                    \
+    r[3] = (-m[9] * s[5] + m[10] * s[4] - m[11] * s[3]) * reciprocal;                    \
+    r[4] = (-m[4] * c[5] + m[6] * c[2] - m[7] * c[1]) * reciprocal;                      \
+    r[5] = (m[0] * c[5] - m[2] * c[2] + m[3] * c[1]) * reciprocal;                       \
+    r[6] = (-m[12] * s[5] + m[14] * s[2] - m[15] * s[1]) * reciprocal;                   \
+    r[7] = (m[8] * s[5] - m[10] * s[2] + m[11] * s[1]) * reciprocal;                     \
+    r[8] = (m[4] * c[4] - m[5] * c[2] + m[7] * c[0]) * reciprocal;                       \
+    r[9] = (-m[0] * c[4] + m[1] * c[2] - m[3] * c[0]) * reciprocal;                      \
+    r[10] = (m[12] * s[4] - m[13] * s[2] + m[15] * s[0]) * reciprocal;                   \
+    r[11] = (-m[8] * s[4] + m[9] * s[2] - m[11] * s[0]) * reciprocal;                    \
+    r[12] = (-m[4] * c[3] + m[5] * c[1] - m[6] * c[0]) * reciprocal;                     \
+    r[13] = (m[0] * c[3] - m[1] * c[1] + m[2] * c[0]) * reciprocal;                      \
+    r[14] = (-m[12] * s[3] + m[13] * s[1] - m[14] * s[0]) * reciprocal;                  \
+    r[15] = (m[8] * s[3] - m[9] * s[1] + m[10] * s[0]) * reciprocal;                     \
+  }
+linear_inverse4(float) linear_inverse4(double)
+
+#endif // linear_simd_H_
@@ -3,6 +3,8 @@
 #include <tgmath.h>
 #include <stdbool.h>
 #include <float.h>
+#include <stdint.h>
+#include <string.h>
 #include "algebra.h"
 
 static inline bool areEqual(const double a, const double b) {
@@ -113,12 +115,742 @@ void crossProductProperties() {
   }
 }
 
+// the 4x4 float kernels against loops in double, with a tolerance relative to the
+// magnitude of the terms since the vectorized sums are ordered differently
+static bool areClose(const double a, const double b, const double magnitude) {
+  return fabs(a - b) <= 1e-5 * fmax(1.0, magnitude);
+}
+static Matrix4f sample(unsigned seed) {
+  Matrix4f result = { 0 };
+  for (size_t n = 0; 16 > n; n++) {
+    seed = seed * 1103515245u + 12345u;
+    result.elements[n] = (float)((seed >> 8) % 2001) / 100.0f - 10.0f;
+  }
+  return result;
+}
+bool matrixKernelsEquivalence() {
+  bool error = false;
+  for (unsigned i = 0; 64 > i; i++) {
+    const Matrix4f a = sample(2 * i + 1);
+    const Matrix4f b = sample(2 * i + 2);
+    const Matrix4f product = Matrix4f_multiply(a, b);
+    const Matrix4f transpose = Matrix4f_transpose(a);
+    for (size_t n = 0; 4 > n; n++) {
+      for (size_t m = 0; 4 > m; m++) {
+        double expected = 0;
+        double magnitude = 0;
+        for (size_t k = 0; 4 > k; k++) {
+          expected += (double)a.elements[4 * n + k] * b.elements[4 * k + m];
+          magnitude += fabs((double)a.elements[4 * n + k] * b.elements[4 * k + m]);
+        }
+        if (!areClose(product.elements[4 * n + m], expected, magnitude)) {
+          printf("Matrix4f_multiply differs at %zu, %zu.\n", n, m);
+          error = true;
+        }
+        if (transpose.elements[4 * n + m] != a.elements[4 * m + n]) {
+          printf("Matrix4f_transpose differs at %zu, %zu.\n", n, m);
+          error = true;
+        }
+      }
+    }
+    Vector4f v = { .components = { a.elements[0], b.elements[1], -2.5f, 1.0f } };
+    const Vector4f transformed = Vector4f_transform(a, v);
+    for (size_t n = 0; 4 > n; n++) {
+      double expected = 0;
+      double magnitude = 0;
+      for (size_t m = 0; 4 > m; m++) {
+        expected += (double)a.elements[4 * n + m] * v.components[m];
+        magnitude += fabs((double)a.elements[4 * n + m] * v.components[m]);
+      }
+      if (!areClose(transformed.components[n], expected, magnitude)) {
+        printf("Vector4f_transform differs at %zu.\n", n);
+        error = true;
+      }
+    }
+    // well conditioned by a dominant diagonal
+    Matrix4f c = a;
+    for (size_t n = 0; 4 > n; n++) {
+      c.elements[5 * n] += 50.0f;
+    }
+    const Matrix4f identity = Matrix4f_multiply(Matrix4f_inverse(c), c);
+    for (size_t n = 0; 16 > n; n++) {
+      if (!areClose(identity.elements[n], n % 5 ? 0.0 : 1.0, 10.0)) {
+        printf("Matrix4f_inverse times the matrix differs from identity at %zu.\n", n);
+        error = true;
+      }
+    }
+  }
+  const Vector3f position = { .components = { 1.0f, 2.0f, 3.0f } };
+  const Vector3f target = { .components = { -4.0f, 0.5f, 2.0f } };
+  const Vector3f up = { .components = { 0.0f, 1.0f, 0.0f } };
+  const Vector4f eye = Vector4f_transform(
+    Matrix4f_lookAt(position, target, up),
+    (Vector4f){ .components = { 1.0f, 2.0f, 3.0f, 1.0f } });
+  const Vector4f ahead = Vector4f_transform(
+    Matrix4f_lookAt(position, target, up),
+    (Vector4f){ .components = { -4.0f, 0.5f, 2.0f, 1.0f } });
+  const double distance = sqrt(25.0 + 2.25 + 1.0);
+  if (!areClose(eye.components[0], 0, 1) || !areClose(eye.components[1], 0, 1)
+      || !areClose(eye.components[2], 0, 1) || !areClose(ahead.components[0], 0, 1)
+      || !areClose(ahead.components[1], 0, 1)
+      || !areClose(ahead.components[2], -distance, distance)) {
+    printf("Matrix4f_lookAt does not put the eye at the origin looking down -z.\n");
+    error = true;
+  }
+  if (!error) {
+    printf("All Matrix4f kernels match the reference.\n");
+  }
+  return error;
+}
+// the batches against the one at a time functions, with a pool so that the grains are
+// split, a count that leaves a partial lane and parents in no particular level order
+bool batchesEquivalence() {
+  bool error = false;
+  const size_t count = 3 * 1024 + 7;
+  Batch_pool* pool = Batch_pool_create(3);
+  Matrix4fBatch* a = Matrix4fBatch_create(count);
+  Matrix4fBatch* b = Matrix4fBatch_create(count);
+  Matrix4fBatch* product = Matrix4fBatch_create(count);
+  Vector3fBatch* points = Vector3fBatch_create(count);
+  Vector3fBatch* transformed = Vector3fBatch_create(count);
+  size_t* parents = malloc(count * sizeof(*parents));
+  for (size_t i = 0; count > i; i++) {
+    Matrix4f local = sample(3 * i + 1);
+    // scaled so that the products along the hierarchy stay bounded
+    for (size_t n = 0; 16 > n; n++) {
+      local.elements[n] *= 0.1f;
+    }
+    Matrix4fBatch_set(a, i, local);
+    Matrix4fBatch_set(b, i, sample(3 * i + 2));
+    for (size_t n = 0; 3 > n; n++) {
+      points->components[n][i] = local.elements[n] * 10.0f;
+    }
+    parents[i] = i % 97 ? (i * 7919) % i : BATCH_ROOT;
+  }
+  Matrix4f_multiplyBatch(pool, a, b, product);
+  const Matrix4f matrix = sample(7);
+  Vector3f_transformBatch(pool, matrix, points, transformed);
+  for (size_t i = 0; count > i; i++) {
+    const Matrix4f expected =
+      Matrix4f_multiply(Matrix4fBatch_get(a, i), Matrix4fBatch_get(b, i));
+    const Matrix4f actual = Matrix4fBatch_get(product, i);
+    for (size_t n = 0; 16 > n; n++) {
+      if (!areClose(actual.elements[n], expected.elements[n], 100.0)) {
+        printf("Matrix4f_multiplyBatch differs at %zu.\n", i);
+        error = true;
+        break;
+      }
+    }
+    const Vector4f point = Vector4f_transform(
+      matrix,
+      (Vector4f){ .components = { points->components[0][i],
+                                  points->components[1][i],
+                                  points->components[2][i],
+                                  1.0f } });
+    for (size_t n = 0; 3 > n; n++) {
+      if (!areClose(transformed->components[n][i], point.components[n], 100.0)) {
+        printf("Vector3f_transformBatch differs at %zu.\n", i);
+        error = true;
+        break;
+      }
+    }
+  }
+  Matrix4f_composeBatch(pool, a, parents, product);
+  Matrix4f* world = malloc(count * sizeof(*world));
+  for (size_t i = 0; count > i; i++) {
+    world[i] = parents[i] == BATCH_ROOT
+               ? Matrix4fBatch_get(a, i)
+               : Matrix4f_multiply(world[parents[i]], Matrix4fBatch_get(a, i));
+    const Matrix4f actual = Matrix4fBatch_get(product, i);
+    for (size_t n = 0; 16 > n; n++) {
+      if (!areClose(actual.elements[n], world[i].elements[n], 1.0)) {
+        printf("Matrix4f_composeBatch differs at %zu.\n", i);
+        error = true;
+        break;
+      }
+    }
+  }
+  free(world);
+  free(parents);
+  Vector3fBatch_destroy(transformed);
+  Vector3fBatch_destroy(points);
+  Matrix4fBatch_destroy(product);
+  Matrix4fBatch_destroy(b);
+  Matrix4fBatch_destroy(a);
+  Batch_pool_destroy(pool);
+  if (!error) {
+    printf("All batches match the single matrix functions.\n");
+  }
+  return error;
+}
+// shapes around the block and tile sizes against the plain triple loop, the products of
+// integers below 2^26 are exact in doubles whatever the order of the sums
+bool matrixMultiplyShapes() {
+  bool error = false;
+  const size_t shapes[][3] = {
+    { 1, 1, 1 },     { 3, 5, 2 },      { 2, 1, 7 },     { 17, 33, 9 },
+    { 67, 131, 45 }, { 130, 257, 190 }, { 5, 600, 3 },  { 300, 7, 2100 },
+  };
+  Batch_pool* pool = Batch_pool_create(3);
+  for (size_t s = 0; sizeof(shapes) / sizeof(*shapes) > s; s++) {
+    const size_t rows = shapes[s][0], inner = shapes[s][1], columns = shapes[s][2];
+    Matrix* a = Matrix_create(rows, inner);
+    Matrix* b = Matrix_create(inner, columns);
+    Matrix* result = Matrix_create(rows, columns);
+    for (size_t n = 0; rows * inner > n; n++) {
+      a->elements[n] = (double)((n * 7 + s) % 23) - 11;
+    }
+    for (size_t n = 0; inner * columns > n; n++) {
+      b->elements[n] = (double)((n * 13 + s) % 19) - 9;
+    }
+    Matrix_fill(result, 1.0);
+    Matrix_multiplyParallel(s % 2 ? pool : 0, a, b, result);
+    for (size_t n = 0; rows > n && !error; n++) {
+      for (size_t m = 0; columns > m; m++) {
+        double expected = 0;
+        for (size_t k = 0; inner > k; k++) {
+          expected += a->elements[n * inner + k] * b->elements[k * columns + m];
+        }
+        if (result->elements[n * columns + m] != expected) {
+          printf("Matrix_multiply of %zux%zu by %zux%zu differs at %zu, %zu.\n",
+                 rows, inner, inner, columns, n, m);
+          error = true;
+          break;
+        }
+      }
+    }
+    Matrix_destroy(result);
+    Matrix_destroy(b);
+    Matrix_destroy(a);
+  }
+  Batch_pool_destroy(pool);
+  if (!error) {
+    printf("All Matrix_multiply shapes match the reference.\n");
+  }
+  return error;
+}
+// single aligned allocations for the dynamic types, and the arena reusing its memory
+// after a rewind
+bool arenaAllocations() {
+  bool error = false;
+  const size_t before = Linear_allocations();
+  Matrix* matrix = Matrix_create(3, 5);
+  Vector* vector = Vector_create(7);
+  if (Linear_allocations() - before != 2) {
+    printf("Matrix_create and Vector_create are not a single allocation each.\n");
+    error = true;
+  }
+  if (
+    (uintptr_t)matrix->elements % LINEAR_ALIGN
+    || (uintptr_t)vector->components % LINEAR_ALIGN) {
+    printf("The elements of Matrix and Vector are not aligned.\n");
+    error = true;
+  }
+  Vector_destroy(vector);
+  Matrix_destroy(matrix);
+  Arena* arena = Arena_create(4096);
+  const size_t created = Linear_allocations();
+  const Arena_Mark mark = Arena_mark(arena);
+  Matrix* first = Matrix_createIn(arena, 4, 4);
+  Matrix_fill(first, 2.0);
+  // past the capacity of the first block
+  Vector* large = Vector_createIn(arena, 1000);
+  Arena_rewind(arena, mark);
+  Matrix* again = Matrix_createIn(arena, 4, 4);
+  if (again != first || again->elements[5] != 0.0) {
+    printf("Arena_rewind does not reuse the memory zeroed.\n");
+    error = true;
+  }
+  Vector* reused = Vector_createIn(arena, 1000);
+  if (reused != large || (uintptr_t)reused->components % LINEAR_ALIGN) {
+    printf("Arena_rewind does not reuse the following blocks.\n");
+    error = true;
+  }
+  if (Linear_allocations() - created != 1) {
+    printf("The arena allocated %zu blocks, not 1.\n", Linear_allocations() - created);
+    error = true;
+  }
+  Arena_destroy(arena);
+  if (!error) {
+    printf("All allocations are aligned and the arena reuses its blocks.\n");
+  }
+  return error;
+}
+// trigonometric polynomials below the Nyquist frequency are differentiated exactly by
+// both the dense and the spectral paths, for lengths with radices 2, 4, 3, 5, 7 and 103
+bool differentiationAccuracy() {
+  bool error = false;
+  const size_t lengths[] = { 8, 31, 32, 34, 36, 96, 100, 210, 1024, 1030, 4096 };
+  for (size_t l = 0; sizeof(lengths) / sizeof(*lengths) > l; l++) {
+    const size_t length = lengths[l];
+    const size_t frequencies = (length - 1) / 2 < 12 ? (length - 1) / 2 : 12;
+    Vector* u = Vector_create(length);
+    Vector* derivative = Vector_create(length);
+    double* expected = calloc(length, sizeof(*expected));
+    double magnitude = 1;
+    for (size_t n = 0; length > n; n++) {
+      const double x = 2 * M_PI * (double)n / (double)length;
+      u->components[n] = 0.5;
+      for (size_t k = 1; frequencies >= k; k++) {
+        const double a = 1.0 / (double)k, b = (double)(k % 3) - 1.0;
+        u->components[n] += a * cos((double)k * x) + b * sin((double)k * x);
+        expected[n] += (double)k * (b * cos((double)k * x) - a * sin((double)k * x));
+      }
+      magnitude = fmax(magnitude, fabs(expected[n]));
+    }
+    Vector_differentiate(u, derivative);
+    for (size_t n = 0; length > n; n++) {
+      if (fabs(derivative->components[n] - expected[n]) > 1e-9 * magnitude) {
+        printf("Vector_differentiate of length %zu differs at %zu by %g.\n",
+               length, n, derivative->components[n] - expected[n]);
+        error = true;
+        break;
+      }
+    }
+    free(expected);
+    Vector_destroy(derivative);
+    Vector_destroy(u);
+  }
+  // any samples against the dense operator
+  const size_t length = 96;
+  Vector* u = Vector_create(length);
+  Vector* spectral = Vector_create(length);
+  Vector* dense = Vector_create(length);
+  Matrix* operator = Matrix_create(length, length);
+  for (size_t n = 0; length > n; n++) {
+    u->components[n] = (double)((n * 37) % 11) - 5.0;
+  }
+  Vector_differentiate(u, spectral);
+  Matrix_differentiate(operator);
+  (Vector_transform)(operator, u, dense);
+  for (size_t n = 0; length > n; n++) {
+    if (fabs(spectral->components[n] - dense->components[n]) > 1e-9 * length) {
+      printf("Vector_differentiate differs from the dense operator at %zu.\n", n);
+      error = true;
+      break;
+    }
+  }
+  Matrix_destroy(operator);
+  Vector_destroy(dense);
+  Vector_destroy(spectral);
+  Vector_destroy(u);
+  if (!error) {
+    printf("All derivatives of trigonometric polynomials are exact.\n");
+  }
+  return error;
+}
+// the operator against the sums of its definition for any row, and the derivative
+// against the dense matrix, which is transformed into twice to show it is overwritten
+bool circulantApplication() {
+  bool error = false;
+  Batch_pool* pool = Batch_pool_create(3);
+  const size_t lengths[] = { 1, 5, 16, 37, 64, 130 };
+  const size_t count = 21;
+  for (size_t l = 0; sizeof(lengths) / sizeof(*lengths) > l; l++) {
+    const size_t length = lengths[l];
+    Matrix* inputs = Matrix_create(count, length);
+    Matrix* results = Matrix_create(count, length);
+    double* row = calloc(length, sizeof(*row));
+    for (size_t n = 0; length > n; n++) {
+      row[n] = (double)((n * 37 + length) % 11) - 5.0;
+    }
+    for (size_t i = 0; count * length > i; i++) {
+      inputs->elements[i] = (double)((i * 53) % 17) - 8.0;
+    }
+    Circulant* general = Circulant_create(length, row);
+    Circulant_apply(pool, general, inputs, results);
+    for (size_t v = 0; count > v && !error; v++) {
+      for (size_t n = 0; length > n; n++) {
+        double expected = 0;
+        for (size_t m = 0; length > m; m++) {
+          expected += row[(length + m - n) % length] * inputs->elements[v * length + m];
+        }
+        if (!areClose(results->elements[v * length + n], expected, (double)length)) {
+          printf("Circulant_apply of length %zu differs at %zu of %zu.\n", length, n, v);
+          error = true;
+          break;
+        }
+      }
+    }
+    Circulant* derivative = Circulant_differentiation(length);
+    Matrix* operator = Matrix_create(length, length);
+    Vector* dense = Vector_create(length);
+    if (!derivative->antisymmetric) {
+      printf("Circulant_differentiation of length %zu is not antisymmetric.\n", length);
+      error = true;
+    }
+    if (Circulant_differentiation(length) != derivative) {
+      printf("Circulant_differentiation of length %zu is not kept.\n", length);
+      error = true;
+    }
+    Circulant_apply(pool, derivative, inputs, results);
+    Matrix_differentiate(operator);
+    for (size_t v = 0; count > v && !error; v++) {
+      Vector u = { .components = &inputs->elements[v * length], .length = length };
+      (Vector_transform)(operator, &u, dense);
+      (Vector_transform)(operator, &u, dense);
+      for (size_t n = 0; length > n; n++) {
+        const double expected = dense->components[n];
+        if (!areClose(results->elements[v * length + n], expected, (double)length)) {
+          printf("The derivative of length %zu differs at %zu of %zu.\n", length, n, v);
+          error = true;
+          break;
+        }
+      }
+    }
+    Vector_destroy(dense);
+    Matrix_destroy(operator);
+    Circulant_destroy(derivative);
+    Circulant_destroy(general);
+    free(row);
+    Matrix_destroy(results);
+    Matrix_destroy(inputs);
+  }
+  Batch_pool_destroy(pool);
+  // the kept operators and plans, so that a leak checker reports none
+  Linear_clear();
+  if (!error) {
+    printf("All circulant products match their definition.\n");
+  }
+  return error;
+}
+// a fixed size product against the dynamic one of the same elements
+static bool matchesDynamic(
+  size_t n,
+  size_t m,
+  size_t p,
+  const double a[static n * m],
+  const double b[static m * p],
+  const double product[static n * p]) {
+  Matrix* dynamicA = Matrix_create(n, m);
+  Matrix* dynamicB = Matrix_create(m, p);
+  Matrix* result = Matrix_create(n, p);
+  memcpy(dynamicA->elements, a, n * m * sizeof(*a));
+  memcpy(dynamicB->elements, b, m * p * sizeof(*b));
+  Matrix_multiply(dynamicA, dynamicB, result);
+  bool matches = true;
+  for (size_t i = 0; n * p > i; i++) {
+    matches = matches && areClose(product[i], result->elements[i], 100.0);
+  }
+  Matrix_destroy(result);
+  Matrix_destroy(dynamicB);
+  Matrix_destroy(dynamicA);
+  return matches;
+}
+#define FIXED_PRODUCT(N, M, P)                                                        \
+  do {                                                                                \
+    Matrix##N##x##M a = { 0 };                                                        \
+    Matrix##M##x##P b = { 0 };                                                        \
+    Matrix##N##x##M##f af = { 0 };                                                    \
+    for (size_t i = 0; N * M > i; i++) {                                              \
+      af.elements[i] = (float)(a.elements[i] = (double)((i * 7 + N) % 11) - 5.0);     \
+    }                                                                                 \
+    for (size_t i = 0; M * P > i; i++) {                                              \
+      b.elements[i] = (double)((i * 5 + P) % 13) - 6.0;                               \
+    }                                                                                 \
+    const Matrix##N##x##P product = Matrix_product(a, b);                             \
+    const Matrix##M##x##N transposed = Matrix_transpose(a);                           \
+    const Vector##N column = Matrix_transform(a, Vector##M##_fill(1.0));              \
+    if (!matchesDynamic(N, M, P, a.elements, b.elements, product.elements)) {         \
+      printf("Matrix_product of %dx%d and %dx%d differs.\n", N, M, M, P);             \
+      error = true;                                                                   \
+    }                                                                                 \
+    for (size_t n = 0; N > n; n++) {                                                  \
+      double sum = 0;                                                                 \
+      for (size_t m = 0; M > m; m++) {                                                \
+        sum += a.elements[M * n + m];                                                 \
+        error |= transposed.elements[N * m + n] != a.elements[M * n + m];             \
+        error |= Matrix_transpose(af).elements[N * m + n] != af.elements[M * n + m];  \
+      }                                                                               \
+      error |= !areClose(column.components[n], sum, 10.0);                            \
+      error |= !areClose(Matrix_transform(af, Vector##M##f_fill(1.0f)).components[n], \
+                         sum, 10.0);                                                  \
+    }                                                                                 \
+  } while (false)
+// every shape of product against the dynamic matrices, the inverses against the
+// identity
+bool fixedSizeKernels() {
+  bool error = false;
+  FIXED_PRODUCT(2, 2, 2);
+  FIXED_PRODUCT(2, 2, 3);
+  FIXED_PRODUCT(2, 2, 4);
+  FIXED_PRODUCT(2, 3, 2);
+  FIXED_PRODUCT(2, 3, 3);
+  FIXED_PRODUCT(2, 3, 4);
+  FIXED_PRODUCT(2, 4, 2);
+  FIXED_PRODUCT(2, 4, 3);
+  FIXED_PRODUCT(2, 4, 4);
+  FIXED_PRODUCT(3, 2, 2);
+  FIXED_PRODUCT(3, 2, 3);
+  FIXED_PRODUCT(3, 2, 4);
+  FIXED_PRODUCT(3, 3, 2);
+  FIXED_PRODUCT(3, 3, 3);
+  FIXED_PRODUCT(3, 3, 4);
+  FIXED_PRODUCT(3, 4, 2);
+  FIXED_PRODUCT(3, 4, 3);
+  FIXED_PRODUCT(3, 4, 4);
+  FIXED_PRODUCT(4, 2, 2);
+  FIXED_PRODUCT(4, 2, 3);
+  FIXED_PRODUCT(4, 2, 4);
+  FIXED_PRODUCT(4, 3, 2);
+  FIXED_PRODUCT(4, 3, 3);
+  FIXED_PRODUCT(4, 3, 4);
+  FIXED_PRODUCT(4, 4, 2);
+  FIXED_PRODUCT(4, 4, 3);
+  FIXED_PRODUCT(4, 4, 4);
+  // the float products of each shape against the double ones
+  const Matrix3x4f a = { .elements = { 1, 2, 0, -1, 3, 1, 2, 0, 0, -2, 1, 4 } };
+  const Matrix4x2f b = { .elements = { 2, 1, 0, -1, 3, 3, 1, 0 } };
+  const Matrix3x2f product = Matrix_product(a, b);
+  const float expected[6] = { 1, -1, 12, 8, 7, 5 };
+  for (size_t i = 0; 6 > i; i++) {
+    error |= product.elements[i] != expected[i];
+  }
+  const Matrix2x2 a2 = { .elements = { 4, 7, 2, 6 } };
+  const Matrix3x3 a3 = { .elements = { 2, 0, 1, 1, 3, 2, 1, 1, 2 } };
+  const Matrix4x4 a4 = { .elements = { 4, 0, 0, 1, 0, 3, 1, 0, 0, 1, 2, 0, 1, 0, 0, 5 } };
+  const Matrix2x2 i2 = Matrix_product(a2, Matrix_inverse(a2));
+  const Matrix3x3 i3 = Matrix_product(a3, Matrix_inverse(a3));
+  const Matrix4x4 i4 = Matrix_product(a4, Matrix_inverse(a4));
+  const Matrix3x3f a3f = { .elements = { 2, 0, 1, 1, 3, 2, 1, 1, 2 } };
+  const Matrix3x3f i3f = Matrix_product(a3f, Matrix_inverse(a3f));
+  for (size_t n = 0; 16 > n; n++) {
+    const double identity = n % 5 ? 0.0 : 1.0;
+    error |= 4 > n && !areClose(i2.elements[n], n % 3 ? 0.0 : 1.0, 1.0);
+    error |= 9 > n && !areClose(i3.elements[n], n % 4 ? 0.0 : 1.0, 1.0);
+    error |= 9 > n && !areClose(i3f.elements[n], n % 4 ? 0.0 : 1.0, 1.0);
+    error |= !areClose(i4.elements[n], identity, 1.0);
+  }
+  if (error) {
+    printf("The fixed size kernels differ from their definitions.\n");
+  }
+  else {
+    printf("All fixed size kernels match the dynamic matrices.\n");
+  }
+  return error;
+}
+static Quaternionf rotation(unsigned seed) {
+  const Matrix4f elements = sample(seed);
+  Quaternionf result = { 0 };
+  for (size_t n = 0; 4 > n; n++) {
+    result.components[n] = elements.elements[n];
+  }
+  return Quaternionf_normalize(result);
+}
+// the point with w = 1, or the direction with w = 0
+static Vector3f apply(Matrix4f matrix, Vector3f v, float w) {
+  const Vector4f result = Vector4f_transform(
+    matrix, Vector4f_make(v.components[0], v.components[1], v.components[2], w));
+  return Vector3f_make(result.components[0], result.components[1], result.components[2]);
+}
+static bool matricesClose(Matrix4f a, Matrix4f b, double magnitude) {
+  bool result = true;
+  for (size_t n = 0; 16 > n; n++) {
+    result &= areClose(a.elements[n], b.elements[n], magnitude);
+  }
+  return result;
+}
+// the quaternions and transforms against the matrices they stand for
+bool transformProperties() {
+  bool error = false;
+  for (unsigned i = 0; 64 > i; i++) {
+    const Quaternionf a = rotation(4 * i + 1);
+    const Quaternionf b = rotation(4 * i + 2);
+    const float* values = sample(4 * i + 3).elements;
+    const Vector3f v = Vector3f_make(values[0], values[1], values[2]);
+    const Vector3f t = Vector3f_make(values[3], values[4], values[5]);
+    // scales away from zero, the first one negative every other sample
+    const Vector3f s = Vector3f_make(
+      (i % 2 ? -1.0f : 1.0f) * (1.0f + fabs(values[6])),
+      0.5f + fabs(values[7]),
+      0.1f + fabs(values[8]));
+    const Quaternionf unit = Quaternionf_multiply(a, Quaternionf_conjugate(a));
+    for (size_t n = 0; 4 > n; n++) {
+      error |= !areClose(unit.components[n], 3 > n ? 0.0 : 1.0, 1.0);
+    }
+    const Vector3f rotated = Quaternionf_rotate(a, v);
+    const Vector3f expected = apply(Quaternionf_toMatrix(a), v, 0.0f);
+    error |= !areClose(Vector3f_norm(rotated), Vector3f_norm(v), 10.0);
+    for (size_t n = 0; 3 > n; n++) {
+      error |= !areClose(rotated.components[n], expected.components[n], 10.0);
+    }
+    error |= !matricesClose(
+      Quaternionf_toMatrix(Quaternionf_multiply(a, b)),
+      Matrix4f_multiply(Quaternionf_toMatrix(a), Quaternionf_toMatrix(b)),
+      1.0);
+    // q and -q are the same rotation
+    const Quaternionf back = Quaternionf_fromMatrix(Quaternionf_toMatrix(a));
+    error |= !areClose(fabs(Quaternionf_inner(back, a)), 1.0, 1.0);
+    // halfway along the shorter arc, cos(angle / 2) from both ends
+    const Quaternionf halfway = Quaternionf_slerp(a, b, 0.5f);
+    const double cosine = sqrt(0.5 * (1.0 + fabs(Quaternionf_inner(a, b))));
+    error |= !areClose(fabs(Quaternionf_inner(halfway, a)), cosine, 10.0);
+    error |= !areClose(fabs(Quaternionf_inner(halfway, b)), cosine, 10.0);
+    // translation rotation scale and back
+    Matrix4f translation = Matrix4f_diagonal(1.0f);
+    Matrix4f scaling = Matrix4f_diagonal(1.0f);
+    for (size_t n = 0; 3 > n; n++) {
+      translation.elements[4 * n + 3] = t.components[n];
+      scaling.elements[5 * n] = s.components[n];
+    }
+    const Transformf transform = { .translation = t, .rotation = a, .scale = s };
+    const Matrix4f model = Transformf_compose(transform);
+    error |= !matricesClose(
+      model,
+      Matrix4f_multiply(Matrix4f_multiply(translation, Quaternionf_toMatrix(a)), scaling),
+      10.0);
+    const Transformf decomposed = Matrix4f_decompose(model);
+    error |= !matricesClose(Transformf_compose(decomposed), model, 10.0);
+    for (size_t n = 0; 3 > n; n++) {
+      error |= !areClose(decomposed.scale.components[n], s.components[n], 10.0);
+    }
+    // an axis scaled to nothing keeps the rotation of the other two, the mirrored ones
+    // come back rotated by half a turn
+    Transformf flat = transform;
+    flat.scale.components[i % 3] = 0.0f;
+    const Matrix4f flattened = Transformf_compose(flat);
+    const Transformf unflattened = Matrix4f_decompose(flattened);
+    error |= !matricesClose(Transformf_compose(unflattened), flattened, 10.0);
+    if (0 < s.components[0] || 0 == i % 3) {
+      error |= !areClose(fabs(Quaternionf_inner(unflattened.rotation, a)), 1.0, 1.0);
+    }
+    const Transformf nothing = Matrix4f_decompose(Matrix4f_fill(0.0f));
+    for (size_t n = 0; !i && 4 > n; n++) {
+      error |= !areClose(nothing.rotation.components[n], 3 > n ? 0.0 : 1.0, 1.0);
+    }
+    // the normals stay perpendicular to the transformed tangents
+    const Matrix4f normal = Matrix4f_normal(model);
+    const Vector3f tangent = Vector3f_cross(v, t);
+    const Vector3f direction = apply(model, tangent, 0.0f);
+    const Vector3f mapped = apply(normal, v, 0.0f);
+    error |= !areClose(
+      Vector3f_inner(mapped, direction),
+      0.0,
+      Vector3f_norm(mapped) * Vector3f_norm(direction) * 10.0);
+    const float* m = model.elements;
+    const Matrix3x3f upper = {
+      .elements = { m[0], m[1], m[2], m[4], m[5], m[6], m[8], m[9], m[10] },
+    };
+    const Matrix3x3f inverseTranspose = Matrix_transpose(Matrix_inverse(upper));
+    for (size_t n = 0; 3 > n; n++) {
+      for (size_t k = 0; 3 > k; k++) {
+        error |= !areClose(
+          normal.elements[4 * n + k], inverseTranspose.elements[3 * n + k], 10.0);
+      }
+      error |= normal.elements[4 * n + 3] != 0.0f || normal.elements[12 + n] != 0.0f;
+    }
+    // the dual quaternions against the composed rigid transforms
+    const DualQuaternionf first = DualQuaternionf_make(a, t);
+    const DualQuaternionf second = DualQuaternionf_make(b, v);
+    const Matrix4f rigid = Matrix4f_multiply(translation, Quaternionf_toMatrix(a));
+    const Vector3f moved = DualQuaternionf_transform(first, v);
+    const Vector3f reference = apply(rigid, v, 1.0f);
+    for (size_t n = 0; 3 > n; n++) {
+      error |= !areClose(moved.components[n], reference.components[n], 100.0);
+    }
+    error |= !matricesClose(DualQuaternionf_toMatrix(first), rigid, 10.0);
+    error |= !matricesClose(
+      DualQuaternionf_toMatrix(DualQuaternionf_multiply(first, second)),
+      Matrix4f_multiply(rigid, DualQuaternionf_toMatrix(second)),
+      100.0);
+    // -d is the same transform as d, the blend flips it back
+    const float weights[2] = { 0.25f, 0.75f };
+    DualQuaternionf pair[2] = { first, first };
+    DualQuaternionf flipped[2] = { first, second };
+    for (size_t n = 0; 4 > n; n++) {
+      pair[1].real.components[n] = -first.real.components[n];
+      pair[1].dual.components[n] = -first.dual.components[n];
+      flipped[1].real.components[n] = -second.real.components[n];
+      flipped[1].dual.components[n] = -second.dual.components[n];
+    }
+    error |= !matricesClose(
+      DualQuaternionf_toMatrix(DualQuaternionf_blend(2, pair, weights)), rigid, 10.0);
+    const DualQuaternionf blended[2] = { first, second };
+    error |= !matricesClose(
+      DualQuaternionf_toMatrix(DualQuaternionf_blend(2, flipped, weights)),
+      DualQuaternionf_toMatrix(DualQuaternionf_blend(2, blended, weights)),
+      100.0);
+  }
+  if (error) {
+    printf("The quaternions and transforms differ from their matrices.\n");
+  }
+  else {
+    printf("All quaternions and transforms match their matrices.\n");
+  }
+  return error;
+}
+
+// scene graphs in breadth first order: a chain, a run per node, then wide levels whose
+// runs split into grains and end inside a lane, rotations keep the products bounded
+bool hierarchyComposition() {
+  bool error = false;
+  const size_t chain = 300;
+  const size_t levels = 24;
+  size_t count = chain;
+  for (size_t level = 0; levels > level; level++) {
+    count += 1000 + 37 * level;
+  }
+  Batch_pool* pool = Batch_pool_create(3);
+  Matrix4fBatch* local = Matrix4fBatch_create(count);
+  Matrix4fBatch* world = Matrix4fBatch_create(count);
+  size_t* parents = malloc(count * sizeof(*parents));
+  Matrix4f* expected = malloc(count * sizeof(*expected));
+  size_t previous = 0; // first node of the level above
+  size_t index = 0;
+  for (; chain > index; index++) {
+    parents[index] = index ? index - 1 : BATCH_ROOT;
+  }
+  for (size_t level = 0; levels > level; level++) {
+    const size_t width = 1000 + 37 * level;
+    const size_t above = level ? index - previous : 0;
+    const size_t first = index;
+    for (; first + width > index; index++) {
+      parents[index] = level ? previous + (index - first) * 7919 % above : BATCH_ROOT;
+    }
+    previous = first;
+  }
+  for (size_t i = 0; count > i; i++) {
+    Matrix4f matrix = Quaternionf_toMatrix(rotation((unsigned)i + 1));
+    const float* offsets = sample((unsigned)i + 7).elements;
+    for (size_t n = 0; 3 > n; n++) {
+      matrix.elements[4 * n + 3] = offsets[n] / 10.0f;
+    }
+    Matrix4fBatch_set(local, i, matrix);
+    expected[i] = parents[i] == BATCH_ROOT
+                  ? matrix
+                  : Matrix4f_multiply(expected[parents[i]], matrix);
+  }
+  Matrix4f_composeBatch(pool, local, parents, world);
+  for (size_t i = 0; !error && count > i; i++) {
+    if (!matricesClose(Matrix4fBatch_get(world, i), expected[i], 100.0)) {
+      printf("Matrix4f_composeBatch differs at %zu of the hierarchy.\n", i);
+      error = true;
+    }
+  }
+  free(expected);
+  free(parents);
+  Matrix4fBatch_destroy(world);
+  Matrix4fBatch_destroy(local);
+  Batch_pool_destroy(pool);
+  if (!error) {
+    printf("Deep hierarchies compose as one matrix at a time.\n");
+  }
+  return error;
+}
 int main() {
   printf("normalize([2, 2, 0]) = ");
   Vector_print(Vector_normalize(Vector3_make(2, 2, 0)));
   vectorSpaceDefinitions();
   innerProductSpaceProperties();
   crossProductProperties();
+  if (
+    matrixKernelsEquivalence() | batchesEquivalence() | matrixMultiplyShapes()
+    | arenaAllocations() | differentiationAccuracy() | circulantApplication()
+    | fixedSizeKernels() | transformProperties() | hierarchyComposition()) {
+    return EXIT_FAILURE;
+  }
   return EXIT_SUCCESS;
 }
-// gcc-13 -std=gnu2x tests.c VectorN.c Vector.c MatrixN.c Matrix.c -lm
+// cmake -S . -B build && cmake --build build && ctest --test-dir build
+// with -DLINEAR_SCALAR=ON for the plain loops or -DLINEAR_NATIVE=ON for the instructions
+// of the machine, such as the fused multiply adds
@@ -1,6 +1,7 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <stdbool.h>
+#include <string.h>
 #include <getopt.h>
 #include "./Application/Application.h"
 
@@ -10,10 +11,46 @@ int main(int argc, char* argv[static argc + 1]) {
   int index = 0;
   int option = 0;
   int flag = 0;
+  Application_Options applicationOptions = {
+    .inspect = true,
+    .profile = 0,
+    .trace = 0,
+    .memory = 0,
+    .budget = 0,
+    .cache = "cache",
+    .cacheLimit = 64 << 20,
+    .watch = false,
+    .lights = 256,
+    .threads = 0,
+    .encoders = 0,
+    .frames = 2,
+    .presentMode = WGPUPresentMode_Fifo,
+    .frameLimit = 0,
+    .lowLatency = false,
+    .script = 0,
+    .storm = false,
+  };
   const struct option options[] = {
-    {"input", required_argument,     0, 'i'},
-    { "flag",       no_argument, &flag,   1},
-    {      0,                 0,     0,   0}
+    {      "input", required_argument,     0, 'i'},
+    {    "profile", optional_argument,     0, 'p'},
+    {      "trace", optional_argument,     0, 't'},
+    {     "memory", optional_argument,     0, 'm'},
+    {     "budget", required_argument,     0, 'b'},
+    {      "cache", required_argument,     0, 'c'},
+    {"cache-limit", required_argument,     0, 'l'},
+    {   "no-cache",       no_argument,     0, 'n'},
+    {      "watch",       no_argument,     0, 'w'},
+    {     "lights", required_argument,     0, 'L'},
+    {    "threads", required_argument,     0, 'T'},
+    {   "encoders", required_argument,     0, 'E'},
+    {     "frames", required_argument,     0, 'F'},
+    {    "present", required_argument,     0, 'P'},
+    {      "limit", required_argument,     0, 'R'},
+    {"low-latency",       no_argument,     0, 'Y'},
+    {     "script", required_argument,     0, 'S'},
+    {      "storm",       no_argument,     0, 'Z'},
+    {       "flag",       no_argument, &flag,   1},
+    {            0,                 0,     0,   0}
   };
   while (option != EOF) {
     option = getopt_long(argc, argv, "", options, &index);
@@ -25,12 +62,86 @@ int main(int argc, char* argv[static argc + 1]) {
         break;
       case 'i':
         printf("input: %s\n", optarg);
+        break;
+      case 'p':
+        applicationOptions.profile = optarg ? optarg : "profile.json";
+        break;
+      case 't':
+#ifdef APPLICATION_TRACE
+        applicationOptions.trace = optarg ? optarg : "trace.json";
+#else
+        // neither the exit nor F2 would write anything
+        fprintf(stderr, "--trace is ignored, rebuild with -DTRACE=ON to record traces.\n");
+#endif
+        break;
+      case 'm':
+        applicationOptions.memory = optarg ? optarg : "memory.json";
+        break;
+      case 'b':
+        // in MiB
+        applicationOptions.budget = strtoull(optarg, 0, 10) << 20;
+        break;
+      case 'c':
+        applicationOptions.cache = optarg;
+        break;
+      case 'l':
+        // in MiB
+        applicationOptions.cacheLimit = strtoull(optarg, 0, 10) << 20;
+        break;
+      case 'n':
+        applicationOptions.cache = 0;
+        break;
+      case 'w':
+        applicationOptions.watch = true;
+        break;
+      case 'L':
+        applicationOptions.lights = strtoull(optarg, 0, 10);
+        break;
+      case 'T':
+        applicationOptions.threads = strtoull(optarg, 0, 10);
+        break;
+      case 'E':
+        applicationOptions.encoders = strtoull(optarg, 0, 10);
+        break;
+      case 'F':
+        applicationOptions.frames = strtoull(optarg, 0, 10);
+        break;
+      case 'P':
+        if (!strcmp(optarg, "mailbox")) {
+          applicationOptions.presentMode = WGPUPresentMode_Mailbox;
+        }
+        else if (!strcmp(optarg, "immediate")) {
+          applicationOptions.presentMode = WGPUPresentMode_Immediate;
+        }
+        else if (strcmp(optarg, "fifo")) {
+          printf("Unknown present mode %s, fifo is used.\n", optarg);
+        }
+        break;
+      case 'R':
+        // in frames per second
+        applicationOptions.frameLimit = strtod(optarg, 0);
+        break;
+      case 'Y':
+        applicationOptions.lowLatency = true;
+        break;
+      case 'S':
+        // in frames
+        applicationOptions.script = strtoull(optarg, 0, 10);
+        break;
+      case 'Z':
+        // resizes during the scripted run
+        applicationOptions.storm = true;
+        applicationOptions.script =
+          applicationOptions.script ? applicationOptions.script : 1000;
+        break;
     }
   }
-  Application* application = Application_create(1280, 960, true);
-  while (!Application_shouldClose(application)) {
-    Application_render(application);
+  Application* application = Application_create(1280, 960, applicationOptions);
+  if (application) {
+    while (!Application_shouldClose(application)) {
+      Application_render(application);
+    }
+    Application_destroy(application);
   }
-  Application_destroy(application);
   return result;
 }
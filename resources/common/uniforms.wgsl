@@ -0,0 +1,45 @@
+// bindings shared by the lit shaders, LIGHT_COUNT comes from Lightning.h
+#ifndef LIGHT_COUNT
+	#define LIGHT_COUNT 2
+#endif
+// the cluster grid of the point lights, CLUSTER_X, CLUSTER_Y, CLUSTER_Z come from cluster.h
+#ifndef CLUSTER_X
+	#define CLUSTER_X 16
+	#define CLUSTER_Y 9
+	#define CLUSTER_Z 24
+#endif
+struct Matrices {
+	projection: mat4x4f,
+	view: mat4x4f,
+	model: mat4x4f,
+	normal: mat4x4f,
+};
+struct Uniforms {
+	matrices: Matrices,
+	color: vec4f,
+	cameraPosition: vec3f,
+	time: f32,
+};
+struct VertexInput {
+	@location(0) position: vec3f,
+	@location(1) normal: vec3f,
+	@location(2) color: vec3f,
+	@location(3) uv: vec2f,
+};
+struct LightingUniforms {
+	directions: array<vec4f, LIGHT_COUNT>,
+	colors: array<vec4f, LIGHT_COUNT>,
+	hardness: f32,
+	diffusivity: f32,
+	specularity: f32,
+	near: f32,
+	far: f32,
+	pointCount: u32,
+	viewport: vec2f,
+}
+struct PointLight {
+	position: vec3f,
+	radius: f32,
+	color: vec3f,
+	intensity: f32,
+}
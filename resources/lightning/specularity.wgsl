@@ -1,20 +1,8 @@
-struct Matrices {
-			projection: mat4x4f,
-    	view: mat4x4f,
-    	model: mat4x4f,
-};
-struct Uniforms {
-    matrices: Matrices,
-    color: vec4f,
-		cameraPosition: vec3f,
-    time: f32,
-};
-struct VertexInput {
-	@location(0) position: vec3f,
-	@location(1) normal: vec3f,
-	@location(2) color: vec3f,
-	@location(3) uv: vec2f,
-};
+#include "../common/uniforms.wgsl"
+// TEXTURED selects the base color from the texture or from the vertices
+#ifndef TEXTURED
+	#define TEXTURED 1
+#endif
 struct VertexOutput {
 	@builtin(position) position: vec4f,
 	@location(0) color: vec3f,
@@ -28,35 +16,65 @@ fn vs_main(in: VertexInput) -> VertexOutput {
 	var out: VertexOutput;
 	let worldPosition = uniforms.matrices.model * vec4f(in.position, 1.0);
 	out.position = uniforms.matrices.projection * uniforms.matrices.view * worldPosition;	
-	out.normal = (uniforms.matrices.model * vec4f(in.normal, 0.0)).xyz;
+	out.normal = (uniforms.matrices.normal * vec4f(in.normal, 0.0)).xyz;
 	out.color = in.color;
 	out.uv = in.uv;
 	out.viewDirection = uniforms.cameraPosition - worldPosition.xyz;
 	return out;
 }
-struct LightingUniforms {
-    directions: array<vec4f, 2>,
-    colors: array<vec4f, 2>,
-		hardness: f32,
-		diffusivity: f32,
-		specularity: f32,
-}
+#if TEXTURED
 @group(0) @binding(1) var colorbaseTexture: texture_2d<f32>;
 @group(0) @binding(2) var textureSampler: sampler;
+#endif
 @group(0) @binding(3) var<uniform> lightning: LightingUniforms;
+@group(0) @binding(4) var<storage, read> points: array<PointLight>;
+// an offset and a count per cluster, then the indices of the point lights
+@group(0) @binding(5) var<storage, read> clusters: array<u32>;
+// set per pipeline without recompiling the module
+override gamma: f32 = 2.2;
 @fragment
 fn fs_main(in: VertexOutput) -> @location(0) vec4f {
+#if TEXTURED
   let colorbase =  textureSample(colorbaseTexture, textureSampler, in.uv).rgb;
+#else
+  let colorbase = in.color;
+#endif
 	let normal = normalize(in.normal);
 	let viewDirection = normalize(in.viewDirection);
 	var color = vec3f(0.0);
-  	for (var i: i32 = 0; 2 > i; i++) {
+  	for (var i: i32 = 0; LIGHT_COUNT > i; i++) {
 			let direction = normalize(lightning.directions[i].xyz);
 			let diffuse = max(0.0, dot(direction, normal)) * lightning.colors[i].rgb;
 			let reflection = reflect(-direction, normal);
 			let specular = pow(max(0.0, dot(reflection, viewDirection)), lightning.hardness);
 			color += colorbase * lightning.diffusivity * diffuse + lightning.specularity * specular;
   	}
-	let colorCorrected = pow(color, vec3f(2.2));
+	// only the point lights binned into the cluster of the fragment are shaded
+	let worldPosition = uniforms.cameraPosition - in.viewDirection;
+	let depth = -(uniforms.matrices.view * vec4f(worldPosition, 1.0)).z;
+	let tile = vec2u(clamp(
+		in.position.xy / lightning.viewport * vec2f(CLUSTER_X, CLUSTER_Y),
+		vec2f(0.0),
+		vec2f(CLUSTER_X - 1, CLUSTER_Y - 1)));
+	let slice = u32(clamp(
+		log(depth / lightning.near) / log(lightning.far / lightning.near) * f32(CLUSTER_Z),
+		0.0,
+		f32(CLUSTER_Z - 1)));
+	let cluster = tile.x + CLUSTER_X * (tile.y + CLUSTER_Y * slice);
+	let offset = clusters[2 * cluster];
+	let count = clusters[2 * cluster + 1];
+	for (var i = 0u; count > i; i++) {
+		let light = points[clusters[offset + i]];
+		let toLight = light.position - worldPosition;
+		let lightDistance = length(toLight);
+		let attenuation = light.intensity * pow(max(0.0, 1.0 - lightDistance / light.radius), 2.0);
+		let direction = toLight / max(lightDistance, 1e-4);
+		let diffuse = max(0.0, dot(direction, normal)) * light.color * attenuation;
+		let reflection = reflect(-direction, normal);
+		let specular = pow(max(0.0, dot(reflection, viewDirection)), lightning.hardness);
+		color += colorbase * lightning.diffusivity * diffuse
+			+ lightning.specularity * specular * attenuation * light.color;
+	}
+	let colorCorrected = pow(color, vec3f(gamma));
 	return vec4f(colorCorrected, uniforms.color.a);
 }